@@ -2,9 +2,9 @@
 
 #include "like-the-art.h"
 
-// Delays (milliseconds) for certain button inputs.
-static constexpr unsigned int EXIT_ADMIN_DEBOUNCE = 1000;
-static constexpr unsigned int REBOOT_DEBOUNCE = 3000;
+// How long (milliseconds) certain buttons must be held.
+static constexpr unsigned int EXIT_ADMIN_HOLD_MILLIS = 1000;
+static constexpr unsigned int REBOOT_HOLD_MILLIS = 3000;
 
 // State machine describing where we are within the admin options.
 static AdminState adminState = AdminState::AS_MAIN_MENU;
@@ -49,7 +49,7 @@ static bool isConfigDirty = false;
 static void initMainMenu() {
   adminState = AdminState::AS_MAIN_MENU;
   attachAdminButtonHandlers();
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   configMaxPwm();
 }
@@ -65,12 +65,12 @@ static void initMainMenu() {
 void performInOrderTest() {
   DBGPRINT("Performing in-order sign test");
   adminState = AdminState::AS_IN_ORDER_TEST;
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   configMaxPwm();
   currentSign = 0;
-  activeAnimation.setParameters(Sentence(0, 1 << currentSign), Effect::EF_APPEAR, 0, 1000);
-  activeAnimation.start();
+  activeAnimation->setParameters(Sentence(0, 1 << currentSign), Effect::EF_APPEAR, 0, 1000);
+  activeAnimation->start();
 }
 
 /**
@@ -96,9 +96,8 @@ static void btnModeTestOneSign(uint8_t btnId, uint8_t btnState) {
   buttons[3].setHandler(btnPrevSign);
   buttons[5].setHandler(btnNextSign);
   buttons[8].setHandler(btnGoToMainMenu);
-  buttons[8].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
 
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   configMaxPwm();
   signs[currentSign].enable();
@@ -120,9 +119,8 @@ static void btnModeChangeEffect(uint8_t btnId, uint8_t btnState) {
   buttons[3].setHandler(btnPrevEffect);
   buttons[5].setHandler(btnNextEffect);
   buttons[8].setHandler(btnGoToMainMenu);
-  buttons[8].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
 
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
 
   DBGPRINT("Testing one effect at a time");
@@ -142,9 +140,8 @@ static void btnModeTestEachSentence(uint8_t btnId, uint8_t btnState) {
   buttons[3].setHandler(btnPrevSentence);
   buttons[5].setHandler(btnNextSentence);
   buttons[8].setHandler(btnGoToMainMenu);
-  buttons[8].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
 
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
 
   DBGPRINT("Testing one sentence at a time");
@@ -156,15 +153,15 @@ static void btnModeTestEachSentence(uint8_t btnId, uint8_t btnState) {
 // Set up the animation that expresses the current brightness level
 // by lighting up 1 to 4 signs.
 static void brightnessSelectAnimation() {
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   configMaxPwm();
   // Turn on 1--4 signs at this pwm.
   // The BRIGHTNESS_xyz enums are actually coded as 1 to 4 full bits, so we can
   // use that value directly as the "sentence" bitmask to display.
-  activeAnimation.setParameters(Sentence(0, fieldConfig.maxBrightness), Effect::EF_BLINK, 0,
+  activeAnimation->setParameters(Sentence(0, fieldConfig.maxBrightness), Effect::EF_BLINK, 0,
       durationForBlinkCount(1));
-  activeAnimation.start();
+  activeAnimation->start();
 }
 
 /**
@@ -186,7 +183,6 @@ static void btnModeChooseBrightnessLevel(uint8_t btnId, uint8_t btnState) {
   buttons[2].setHandler(btnBrightness2);
   buttons[3].setHandler(btnBrightness3);
   buttons[8].setHandler(btnGoToMainMenu);
-  buttons[8].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
 
   brightnessSelectAnimation();
 
@@ -201,7 +197,7 @@ static void btnModeChooseBrightnessLevel(uint8_t btnId, uint8_t btnState) {
 static void btnLightEntireBoard(uint8_t btnId, uint8_t btnState) {
   if (btnState == BTN_OPEN) { return; }
   adminState = AdminState::AS_ALL_SIGNS_ON;
-  activeAnimation.stop();
+  activeAnimation->stop();
   configMaxPwm();
   allSignsOn();
   DBGPRINT("Turning on all signs");
@@ -210,21 +206,20 @@ static void btnLightEntireBoard(uint8_t btnId, uint8_t btnState) {
 /**
  * Button 7: Hold 1 second to exit admin mode.
  * The first 3 signs flash 3 times and then admin mode ends.
- * Trigger on button release.
+ * Long-press handler; triggers once the button has been held for the full second.
  */
 static void btnExitAdminMode(uint8_t btnId, uint8_t btnState) {
-  if (btnState == BTN_PRESSED) { return; }
   adminState = AdminState::AS_EXITING;
 
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   attachEmptyButtonHandlers();
   if (isConfigDirty) {
     saveFieldConfig(&fieldConfig);
   }
-  activeAnimation.setParameters(Sentence(0, 0x7), Effect::EF_BLINK_FAST, 0,
+  activeAnimation->setParameters(Sentence(0, 0x7), Effect::EF_BLINK_FAST, 0,
       durationForFastBlinkCount(3));
-  activeAnimation.start();
+  activeAnimation->start();
   DBGPRINT("Exiting admin menu...");
 }
 
@@ -255,7 +250,7 @@ static void showDarkSensorIndicator() {
  * based on the indicated calibration level.
  */
 static void darkCalibrationAnimation() {
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   configMaxPwm();
 
@@ -268,16 +263,16 @@ static void darkCalibrationAnimation() {
 
   // Put a string of 1 bits between those two ends in a "sentence" to indicate the signs to light up:
   unsigned int signBitsToLight = 0;
-  for (int i = 0; i < NUM_SIGNS; i++) {
+  for (int i = 0; i < (int)NUM_SIGNS; i++) {
     if (i >= lowerSignLimit && i <= upperSignLimit) {
       signBitsToLight |= (1 << i);
     }
   }
 
   // And set those signs to blinking.
-  activeAnimation.setParameters(Sentence(0, signBitsToLight), Effect::EF_BLINK, 0,
+  activeAnimation->setParameters(Sentence(0, signBitsToLight), Effect::EF_BLINK, 0,
       durationForBlinkCount(1));
-  activeAnimation.start();
+  activeAnimation->start();
 
   showDarkSensorIndicator();
 
@@ -299,7 +294,6 @@ static void btnModeDarkCal(uint8_t btnId, uint8_t btnState) {
   buttons[3].setHandler(btnDarkCalDecrease);
   buttons[5].setHandler(btnDarkCalIncrease);
   buttons[8].setHandler(btnGoToMainMenu);
-  buttons[8].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
 
   darkCalibrationAnimation();
 
@@ -311,13 +305,12 @@ static void btnModeDarkCal(uint8_t btnId, uint8_t btnState) {
 /**
  * Button 9 - Hold 3 seconds to completely reset system.
  * The first 3 signs flash 5 times and then the system is rebooted.
- * Trigger on button release.
+ * Long-press handler; triggers once the button has been held for the full 3 seconds.
  */
 static void btnCtrlAltDelete(uint8_t btnId, uint8_t btnState) {
-  if (btnState == BTN_PRESSED) { return; }
   adminState = AdminState::AS_REBOOTING;
 
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   attachEmptyButtonHandlers();
   if (isConfigDirty) {
@@ -325,9 +318,9 @@ static void btnCtrlAltDelete(uint8_t btnId, uint8_t btnState) {
   }
 
   // Set up blinking animation before we reboot.
-  activeAnimation.setParameters(Sentence(0, 0x7), Effect::EF_BLINK_FAST, 0,
+  activeAnimation->setParameters(Sentence(0, 0x7), Effect::EF_BLINK_FAST, 0,
       durationForFastBlinkCount(5));
-  activeAnimation.start();
+  activeAnimation->start();
   DBGPRINT("User requested reboot");
 }
 
@@ -338,12 +331,12 @@ static void attachAdminButtonHandlers() {
   buttons[3].setHandler(btnModeTestEachSentence);
   buttons[4].setHandler(btnModeChooseBrightnessLevel);
   buttons[5].setHandler(btnLightEntireBoard);
-  buttons[6].setHandler(btnExitAdminMode);
+  buttons[6].setHandler(emptyBtnHandler);
   buttons[7].setHandler(btnModeDarkCal);
-  buttons[8].setHandler(btnCtrlAltDelete);
+  buttons[8].setHandler(emptyBtnHandler);
 
-  buttons[6].setPushDebounceInterval(EXIT_ADMIN_DEBOUNCE); // 1 second press required.
-  buttons[8].setPushDebounceInterval(REBOOT_DEBOUNCE); // 3 second press required.
+  buttons[6].setLongPressHandler(btnExitAdminMode, EXIT_ADMIN_HOLD_MILLIS); // 1 second hold.
+  buttons[8].setLongPressHandler(btnCtrlAltDelete, REBOOT_HOLD_MILLIS); // 3 second hold.
 }
 
 /** Button 9 in various sub menus is "return to main menu" */
@@ -388,7 +381,7 @@ static void btnPrevEffect(uint8_t btnId, uint8_t btnState) {
     currentEffect--;
   }
   // Cancel current effect; new effect will be initialized immediately in loop().
-  activeAnimation.stop();
+  activeAnimation->stop();
   DBGPRINTU("Testing effect:", currentEffect);
 }
 
@@ -396,7 +389,7 @@ static void btnNextEffect(uint8_t btnId, uint8_t btnState) {
   if (btnState == BTN_OPEN) { return; }
   currentEffect = (currentEffect + 1) % NUM_EFFECTS;
   // Cancel current effect; new effect will be initialized immediately in loop().
-  activeAnimation.stop();
+  activeAnimation->stop();
   DBGPRINTU("Testing effect:", currentEffect);
   debugPrintEffect((Effect)currentEffect);
 }
@@ -411,7 +404,7 @@ static void btnPrevSentence(uint8_t btnId, uint8_t btnState) {
     currentSentence--;
   }
   // Cancel current sentence/effect; new sentence will be initialized immediately in loop().
-  activeAnimation.stop();
+  activeAnimation->stop();
   DBGPRINTU("Testing sentence:", currentSentence);
   sentences[currentSentence].toDbgPrint();
 }
@@ -420,7 +413,7 @@ static void btnNextSentence(uint8_t btnId, uint8_t btnState) {
   if (btnState == BTN_OPEN) { return; }
   currentSentence = (currentSentence + 1) % sentences.size();
   // Cancel current sentence/effect; new sentence will be initialized immediately in loop().
-  activeAnimation.stop();
+  activeAnimation->stop();
   DBGPRINTU("Testing sentence:", currentSentence);
   sentences[currentSentence].toDbgPrint();
 }
@@ -531,9 +524,12 @@ void loopStateAdmin() {
     showDarkSensorIndicator();
   }
 
-  if (activeAnimation.isRunning()) {
+  // An operator may send a new effect program over USB while in admin mode.
+  pollEffectProgramLoader();
+
+  if (activeAnimation->isRunning()) {
     // We triggered an animation within admin mode; just run that.
-    activeAnimation.next();
+    activeAnimation->next();
     return;
   }
 
@@ -542,14 +538,14 @@ void loopStateAdmin() {
   switch (adminState) {
   case AdminState::AS_MAIN_MENU:
     // First sign should blink slowly.
-    activeAnimation.setParameters(Sentence(0, 1), Effect::EF_BLINK, 0, durationForBlinkCount(1));
-    activeAnimation.start();
+    activeAnimation->setParameters(Sentence(0, 1), Effect::EF_BLINK, 0, durationForBlinkCount(1));
+    activeAnimation->start();
     break;
   case AdminState::AS_IN_ORDER_TEST:
     // Scroll through signs one-by-one for a second each.
     currentSign = (currentSign + 1) % signs.size();
-    activeAnimation.setParameters(Sentence(0, 1 << currentSign), Effect::EF_APPEAR, 0, 1000);
-    activeAnimation.start();
+    activeAnimation->setParameters(Sentence(0, 1 << currentSign), Effect::EF_APPEAR, 0, 1000);
+    activeAnimation->start();
     break;
   case AdminState::AS_TEST_ONE_SIGN:
     // One sign turned on @ configured brightness level on state entry.
@@ -558,8 +554,8 @@ void loopStateAdmin() {
   case AdminState::AS_TEST_EACH_EFFECT:
   case AdminState::AS_TEST_SENTENCE:
     // Show current selected sentence, apply configured effect.
-    activeAnimation.setParameters(sentences[currentSentence], (Effect)currentEffect, 0, 0);
-    activeAnimation.start();
+    activeAnimation->setParameters(sentences[currentSentence], (Effect)currentEffect, 0, 0);
+    activeAnimation->start();
     break;
   case AdminState::AS_CONFIG_BRIGHTNESS:
     // 1--4 signs slowly blink at current brightness level.
@@ -606,7 +602,7 @@ void setMacroStateAdmin() {
   currentSentence = 0;
   isConfigDirty = false; // No modifications to persistent state made yet.
 
-  activeAnimation.stop(); // Cancel any in-flight animation.
+  activeAnimation->stop(); // Cancel any in-flight animation.
 
   initMainMenu(); // Reconfigure button functions for admin mode.
 }
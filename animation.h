@@ -3,6 +3,7 @@
 #ifndef _ANIMATION_H
 #define _ANIMATION_H
 
+// Each Effect is described by an EffectDesc in the Animation::EFFECTS registry.
 enum class Effect: unsigned int {
   EF_APPEAR,         // Just turn on the words and hold them there.
   EF_GLOW,           // Fade up from nothing, hold high, fade back to zero.
@@ -19,10 +20,11 @@ enum class Effect: unsigned int {
   EF_MELT,           // Start with all words on and "melt away" words one-by-one to reveal the
                      // real sentence. The sentence holds, and then individual words turn off
                      // to fade to black for outro.
+  EF_PROGRAM,        // Play the installed effect program. (See effectProgram.h.)
 
   //// Special-purpose effects ////
   // These cannot be returned by randomEffect(), they are triggered under specific conditions:
-  // user button presses; as a secondary chained animation registered "on deck"; etc.
+  // user button presses; as a secondary chained animation queued to follow another; etc.
 
   EF_ALL_BRIGHT,     // Disregard Sentence; entire sign illuminated a la EF_APPEAR.
   EF_ALL_DARK,       // Disregard Sentence; entire sign just remains off.
@@ -34,24 +36,10 @@ enum class Effect: unsigned int {
                      // below this one, as its used for counting purposes.
 };
 
-// The enum value representing the highest-numbered Effect that `randomEffect()` can return.
-constexpr Effect MAX_RANDOM_EFFECT_ID = Effect::EF_MELT;
-
 // The enum value representing the highest-numbered valid Effect.
 constexpr Effect MAX_EFFECT_ID = Effect::EF_NO_EFFECT;
 constexpr unsigned int NUM_EFFECTS = (unsigned int)(MAX_EFFECT_ID) + 1;
 
-// FADE_LOVE_HATE and NO_EFFECT are not "selectable" by buttons and don't count toward
-// consistency checking of effect-based button assignments.
-constexpr unsigned int NUM_NON_ADDRESSABLE_EFFECTS = 2;
-// The number of effects we expect to see in the button handler array.
-constexpr unsigned int NUM_ADDRESSABLE_EFFECTS = NUM_EFFECTS - NUM_NON_ADDRESSABLE_EFFECTS;
-
-/** Return a random Effect. */
-inline Effect randomEffect() {
-  return (Effect)random((uint32_t)MAX_RANDOM_EFFECT_ID + 1);
-};
-
 /** Return random flags appropriate for this effect/sentence. */
 extern uint32_t newAnimationFlags(Effect e, const Sentence &s);
 
@@ -82,11 +70,6 @@ constexpr unsigned int SLIDE_TO_END_PER_WORD_HOLD = 350; // light zip 'holds' on
 constexpr unsigned int SLIDE_TO_END_MINIMUM_SENTENCE_HOLD = 1500;
 constexpr unsigned int SLIDE_TO_END_DEFAULT_SENTENCE_HOLD = 2500;
 
-// In intro-hold-outro mode animations, the 3 phases have specific names:
-constexpr unsigned int PHASE_INTRO = 0;
-constexpr unsigned int PHASE_HOLD = 1;
-constexpr unsigned int PHASE_OUTRO = 2;
-
 // Duration (millis) for which EF_ONE_AT_A_TIME shows each word:
 constexpr unsigned int ONE_AT_A_TIME_WORD_DELAY = 1000;
 // Number of phases (of len OAAT_WORD_DELAY) at the end when we hold a blank screen.
@@ -115,6 +98,29 @@ constexpr unsigned int FADE_LOVE_HATE_MILLIS = 12000;
 constexpr unsigned int FADE_LOVE_HATE_INTRO_MILLIS = 1000;
 constexpr unsigned int FADE_LOVE_HATE_OUTRO_MILLIS = 2000;
 
+// EffectDesc flags:
+constexpr uint8_t EFFECT_FLAG_RANDOM = 0x1;  // randomEffect() may choose this effect.
+constexpr uint8_t EFFECT_FLAG_BUTTON = 0x2;  // A user button may lock in this effect.
+// The effect ends with all words lit, so it can be extended by ANIM_FLAG_FADE_LOVE_HATE.
+// (Technically, blinks could end in all-off state, but we can easily snap it back on
+// again without breaking the flow of the animation.)
+constexpr uint8_t EFFECT_FLAG_ENDS_ALL_ON = 0x4;
+
+class Animation;
+
+/**
+ * Describes an Effect: everything needed to choose it and to plan an Animation with it.
+ */
+struct EffectDesc {
+  Effect effect; // Must match this descriptor's index in Animation::EFFECTS.
+  const char *name;
+  uint8_t flags; // EFFECT_FLAG_*
+  // Return the duration (millis) for the most aesthetically pleasing effect on the sentence.
+  uint32_t (*optimalDuration)(const Sentence &s);
+  // Planner that generates the effect's keyframe timeline; see Animation.
+  bool (Animation::*plan)();
+};
+
 constexpr uint32_t ANIM_FLAG_FLICKER_COUNT_1 = 0x1; // One word should be flickering.
 constexpr uint32_t ANIM_FLAG_FLICKER_COUNT_2 = 0x2; // Two words should be flickering.
 constexpr uint32_t ANIM_FLAG_FLICKER_COUNT_3 = 0x4; // Three words should be flickering.
@@ -148,6 +154,24 @@ constexpr unsigned int FULL_SIGN_GLITCH_FLICKER_DARK_THRESHOLD = 925;
 // ... the same, for the GLITCH_LIGHT flag
 constexpr unsigned int FULL_SIGN_GLITCH_FLICKER_BRIGHT_THRESHOLD = 250;
 
+// Keyframe flag: ramp brightness from this keyframe's level to that of the next keyframe,
+// following the keyframe's fade curve.
+constexpr uint8_t KF_FLAG_RAMP = 0x1;
+// Brightness ramps are even steps in perceived brightness unless the planner says otherwise.
+constexpr FadeCurve KF_DEFAULT_RAMP_CURVE = FADE_GAMMA;
+
+/**
+ * A point in an animation's timeline where the displayed signs or brightness change. The
+ * keyframe holds until the next keyframe's offset is reached.
+ */
+struct Keyframe {
+  uint32_t offset;   // Millis since the start of the animation when this keyframe takes effect.
+  uint16_t signBits; // Signs lit (within the animation's sign scope) from this point on.
+  uint16_t level;    // Brightness, from 0 to KF_LEVEL_FULL.
+  uint8_t flags;     // KF_FLAG_*
+  FadeCurve curve;   // Shape of the brightness ramp, if KF_FLAG_RAMP.
+};
+
 /**
  * An animation makes a sentence appear with a specified effect.
  *
@@ -155,10 +179,19 @@ constexpr unsigned int FULL_SIGN_GLITCH_FLICKER_BRIGHT_THRESHOLD = 250;
  *
  * The planning phase occurs in the setParameters() method. All the information needed
  * to direct the animation is provided at once: the sentence to show, the effect to apply,
- * and the desired duration of effect. Within this method, the planner calculates how many
- * distinct phases must occur and how long each phase lasts. The duration, count, and nature
- * of phases of animation are particular to the chosen effect and may vary with respect to
- * the number of words to display or other aspects of the chosen sentence.
+ * and the desired duration of effect. Within this method, the effect's planner is set up to
+ * generate a timeline of Keyframes, each of which specifies the set of lit signs and the
+ * brightness from a given offset into the animation. Effects that apply on top of the sentence,
+ * like flickering words or the LOVE/HATE fade, are configured as overlay layers in the
+ * animation's Compositor.
+ *
+ * A planner is written as straight-line code that emits keyframes in time order. It is a
+ * stackless generator: each call resumes where the last one left off, runs until it emits the
+ * next keyframe, and returns. Only the next keyframe is generated ahead of time, so the timeline
+ * occupies no memory beyond the running planner's state in _plan. Any random choices the effect
+ * makes (e.g., the order in which EF_BUILD_RANDOM lights words, or which word EF_MELT melts next)
+ * are resolved as the planner reaches them. The planner runs once, so each start() must follow
+ * its own setParameters().
  *
  * At this point both isRunning() and isComplete() will return false.
  *
@@ -166,11 +199,14 @@ constexpr unsigned int FULL_SIGN_GLITCH_FLICKER_BRIGHT_THRESHOLD = 250;
  * performs the first 'key frame' of the animation. It is after this method returns
  * that isRunning() will return true.
  *
- * Each frame of animation lasts for LOOP_MICROS microseconds.
- *
- * Execution continues with successive calls to next(). This shows the next frame of animation.
- * This continues until isComplete() returns true. (At which point isRunning() returns false.)
- * At which point next() will do nothing until a new animation is planned with setParameters().
+ * Execution continues with successive calls to next(), nominally once per LOOP_MICROS
+ * microseconds. Animation time is measured from the micros() clock at start(), not by counting
+ * frames: a late or skipped frame does not stretch the animation, the next frame simply catches
+ * up to the current point in the timeline. Each call advances a cursor through the timeline to
+ * render the base Frame, passes it through the overlay layers, and commits the result to the
+ * signs and PWM. This continues until isComplete() returns true. (At which
+ * point isRunning() returns false.) At which point next() will do nothing until a new
+ * animation is planned with setParameters().
  *
  * If at any point during execution the `stop()` method is called, the animation is
  * short-circuited and isComplete() will return true.
@@ -183,7 +219,7 @@ public:
   uint32_t getOptimalDuration(const Sentence &s, const Effect e, const uint32_t flags);
 
   bool isRunning() const { return _isRunning; }
-  bool isComplete() const { return !_isRunning && _phaseCountRemaining == 0; };
+  bool isComplete() const { return !_isRunning && _elapsedMillis >= _duration; };
   const Sentence &getSentence() const { return _sentence; };
   Effect getEffect() const { return _effect; };
 
@@ -191,92 +227,275 @@ public:
   void next(); // Perform the next step of animation.
   void stop(); // Halt the animation sequence even if there's part remaining.
 
+  // Return the number of micros until next() has something new to show.
+  uint32_t getMicrosToNextChange() const;
+
+  // The effect registry: the descriptor of each Effect, indexed by its enum value.
+  static const EffectDesc EFFECTS[NUM_EFFECTS];
+
 private:
   //// Core parameters for the animation ////
   Sentence _sentence;
   Effect _effect;
   uint32_t _flags;
 
-  void _setParamsAppear(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsGlow(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsBlink(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsBlinkFast(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsOneAtATime(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsBuild(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsBuildRandom(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsSnake(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsSlide(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsMelt(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsAllBright(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsAllDark(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsFadeLoveHate(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-  void _setParamsNoEffect(const Sentence &s, const Effect e, uint32_t flags, uint32_t milliseconds);
-
-  void _nextAppear();
-  void _nextGlow();
-  void _nextBlink();
-  void _nextBlinkFast();
-  void _nextOneAtATime();
-  void _nextBuild();
-  void _nextBuildRandom();
-  void _nextSnake();
-  void _nextSlide();
-  void _nextMelt();
-  void _nextAllBright();
-  void _nextAllDark();
-  void _nextFadeLoveHate();
-  void _nextNoEffect();
-
-  //// State to manage advancing frames & phases of the animation ////
-  unsigned int _remainingTime; // millis.
+  //// Planners ////
+  // Each emits the next keyframe of its effect and returns true, or returns false once done.
+  // The first call also sets _signScope and _duration.
+  bool _planAppear();
+  bool _planGlow();
+  bool _planBlink();
+  bool _planBlinkFast();
+  bool _planBlinkPhases(uint32_t phaseMillis);
+  bool _planOneAtATime();
+  bool _planBuild();
+  bool _planBuildRandom();
+  bool _planSnake();
+  bool _planSlide();
+  bool _planMelt();
+  bool _planProgram();
+  bool _planAllBright();
+  bool _planAllDark();
+  bool _planFadeLoveHate();
+  bool _planNoEffect();
+
+  // Append a fade across between LOVE and HATE to the timeline, starting at 'startMillis'.
+  void _addLoveHateFade(const Sentence &s, uint32_t startMillis, uint32_t milliseconds);
+
+  // Emit the next keyframe of the timeline from the running planner.
+  void _emitKeyframe(uint32_t offset, uint32_t signBits, uint16_t level = KF_LEVEL_FULL,
+      uint8_t flags = 0, FadeCurve curve = KF_DEFAULT_RAMP_CURVE);
+  void _pullKeyframe(); // Resume the planner to generate _nextKeyframe.
+  bool _startDmaRamp(); // Hand the rest of the current ramp to the PWM's DMA.
+  void _stopDmaRamp();
+
+  //// Timeline ////
+  uint32_t _signScope; // Signs controlled by the keyframes; others are left as-is.
+  uint32_t _duration; // Total length of the animation in millis.
+  uint32_t _planMillis; // The duration requested of the planner.
+  unsigned int _planLine; // Where the planner resumes; 0 to start from the top.
+  bool _isPlanDone; // The planner has returned its last keyframe.
+  // State that the running planner keeps between keyframes. Only one planner runs at a time.
+  union {
+    struct {
+      uint32_t phase;
+    } blink;
+    struct {
+      uint32_t remaining; // Words yet to go.
+      uint32_t litSigns;
+      uint32_t t;
+    } words; // EF_ONE_AT_A_TIME, EF_BUILD, EF_SNAKE
+    struct {
+      uint64_t order; // Sign ids in the order they light, 4 bits each.
+      uint32_t i;
+      uint32_t litSigns;
+    } buildRandom;
+    struct {
+      int32_t target;
+      int32_t pos;
+      uint32_t litSigns;
+      uint32_t t;
+      uint32_t setupTime;
+      uint32_t holdPhaseTime;
+    } slide;
+    struct {
+      uint32_t meltSet; // Words yet to melt.
+      uint32_t litSigns;
+      uint32_t t;
+      uint32_t introTime;
+      uint32_t holdPhaseTime;
+    } melt;
+    struct {
+      uint32_t t;
+      uint16_t pc;
+      uint16_t litSigns;
+      uint16_t pick; // The word chosen by the last OP_PICK.
+      uint16_t pool; // Words that OP_PICK may choose.
+      uint16_t level;
+      uint8_t depth; // Number of loops entered.
+      uint8_t loopCount[VM_MAX_LOOP_DEPTH]; // Iterations left in each loop.
+      uint16_t loopPc[VM_MAX_LOOP_DEPTH]; // Where each loop body begins.
+    } program;
+  } _plan;
+  // A keyframe to follow the planner's last one, if _hasTailKeyframe.
+  Keyframe _tailKeyframe;
+  bool _hasTailKeyframe;
+
+  //// Overlay layers ////
+  Compositor _compositor;
+  FlickerOverlay _flicker;    // Words chosen by ANIM_FLAG_FLICKER_COUNT_*.
+  FlickerOverlay _glitch;     // The whole sign, for ANIM_FLAG_FULL_SIGN_GLITCH_*.
+  WordSwapOverlay _wordSwap;  // The LOVE/HATE fade.
+  // Dropouts between frames for the signs flickered by _flicker and _glitch (_subFrameSigns),
+  // until _subFrameEndMillis.
+  SubFrameFlickerPlan _subFramePlan;
+  uint32_t _subFrameSigns;
+  uint32_t _subFrameEndMillis;
+
+  //// State to manage advancing frames of the animation ////
   bool _isRunning;
-  bool _isFirstPhaseTic; // True during the first frame of a phase.
-
-  unsigned int _phaseDuration; // millis per phase
-  unsigned int _phaseRemainingMillis; // millis remaining in current phase
-  unsigned int _phaseCountRemaining; // number of phases to go.
-  unsigned int _curPhaseNum; // sequentially incrementing counter thru phases.
-
-  bool _isIntroHoldOutro; // intro-hold-outro mode is 3 phases which may not
-                          // have the same length. Each phase duration is initialized
-                          // from the variables below.
-
-  unsigned int _ihoIntroDuration;
-  unsigned int _ihoHoldDuration;
-  unsigned int _ihoOutroDuration;
-
-  // Helper method to setup an intro-hold-outro style animation pattern.
-  void _setupIntroHoldOutro(unsigned int introTime, unsigned int holdTime, unsigned int outroTime);
-
-  //// Effect-specific state ////
-
-  // EF_GLOW
-  uint32_t _glowStepSize;
-  unsigned int _glowCurrentBrightness;
-
-  // EF_SLIDE_TO_END
-  uint32_t _slideCurZipPosition;  // The sign id where the 'zipping light' currently is.
-  uint32_t _slideCurTargetSignId; // The sign id where the 'zipping light' will rest.
-  unsigned int _nextZipTime;  // Next phaseRemainingMillis when the zip should advance.
-  bool _slidePickNextZipTarget();
-
-  // EF_MELT
-  unsigned int _nextMeltTime; // the phaseRemainingMillis value when we should next melt a word.
-  unsigned int _availableMeltSet;  // the bitmask of words we are allowed to melt in this phase.
-  unsigned int _numWordsLeftToMelt; // number of words in available melt set
-  void _meltWord();
-
-  // EF_BUILD_RANDOM
-  uint8_t _buildRandomOrder[NUM_SIGNS]; // Order we light up signs in this animation.
-
-  // EF_FADE_LOVE_HATE
-  int _loveHateFadeLoveOnThreshold; // Prob. of rand chance (out of THRESHOLD_MAX) that 'LOVE' is lit.
-  int _loveHateFadeLoveOnDeltaPerTic; // Amount that threshold changes each frame.
-  int _loveHateFrozenFramesRemaining;
-  static constexpr int LOVE_HATE_FADE_THRESHOLD_MAX = 1000000;
+  uint32_t _startMicros; // micros() when the animation started.
+  uint32_t _elapsedMillis; // Time since start() at the current frame.
+  Keyframe _keyframe; // The keyframe that applies at the current frame, if _hasKeyframe.
+  Keyframe _nextKeyframe; // The next keyframe to apply, if _hasNextKeyframe.
+  bool _hasKeyframe;
+  bool _hasNextKeyframe;
+  Fade _fade; // The brightness ramp from _keyframe to _nextKeyframe, if _keyframe is a ramp.
+  bool _isDmaRamp; // The PWM is following _fade by DMA, rather than frame by frame.
+  Frame _baseFrame; // What the timeline shows at the current frame, before overlays.
+};
+
+inline constexpr EffectDesc Animation::EFFECTS[NUM_EFFECTS] = {
+  { Effect::EF_APPEAR, "EF_APPEAR",
+    EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON | EFFECT_FLAG_ENDS_ALL_ON,
+    [](const Sentence &s) -> uint32_t {
+      return 5000;  // Show the sentence for 5 seconds.
+    },
+    &Animation::_planAppear },
+  { Effect::EF_GLOW, "EF_GLOW", EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t {
+      return 5000;  // 1250 ms glow-up, 2500ms hold, 1250 ms glow-down
+    },
+    &Animation::_planGlow },
+  { Effect::EF_BLINK, "EF_BLINK",
+    EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON | EFFECT_FLAG_ENDS_ALL_ON,
+    [](const Sentence &s) -> uint32_t {
+      // approx 6 seconds total (1s on / 1s off x 3 blinks)
+      return durationForBlinkCount(3);
+    },
+    &Animation::_planBlink },
+  { Effect::EF_BLINK_FAST, "EF_BLINK_FAST",
+    EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON | EFFECT_FLAG_ENDS_ALL_ON,
+    [](const Sentence &s) -> uint32_t {
+      // approx 4 seconds total (250ms on / 250 ms off x 8 blinks)
+      return durationForFastBlinkCount(8);
+    },
+    &Animation::_planBlinkFast },
+  { Effect::EF_ONE_AT_A_TIME, "EF_ONE_AT_A_TIME", EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t {
+      // Show each word in sentence by itself for 1 second, followed by 'N' seconds of blank.
+      return (s.getNumWords() + ONE_AT_A_TIME_BLANK_PHASES) * ONE_AT_A_TIME_WORD_DELAY;
+    },
+    &Animation::_planOneAtATime },
+  { Effect::EF_BUILD, "EF_BUILD",
+    EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON | EFFECT_FLAG_ENDS_ALL_ON,
+    [](const Sentence &s) -> uint32_t {
+      // words in sentence light up 1/2 sec apart, and it has a full-sentence hold phase at the end.
+      return s.getNumWords() * BUILD_WORD_DELAY + BUILD_HOLD_DURATION;
+    },
+    &Animation::_planBuild },
+  { Effect::EF_BUILD_RANDOM, "EF_BUILD_RANDOM",
+    EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON | EFFECT_FLAG_ENDS_ALL_ON,
+    [](const Sentence &s) -> uint32_t {
+      return s.getNumWords() * BUILD_RANDOM_WORD_DELAY + BUILD_RANDOM_HOLD_DURATION;
+    },
+    &Animation::_planBuildRandom },
+  { Effect::EF_SNAKE, "EF_SNAKE", EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t {
+      // words in sentence light up and tear down 3/4 sec apart.
+      return 2 * s.getNumWords() * SNAKE_WORD_DELAY;
+    },
+    &Animation::_planSnake },
+  { Effect::EF_SLIDE_TO_END, "EF_SLIDE_TO_END", EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t {
+      // Each word lights up by zipping through all preceeding words. (O(n^2) behavior.)
+      // So the ids/positions of the words in the sentence give the proportion of time required
+      // for each word -- plus a 'hold time' once we arrive at the word.
+      uint32_t positionSum = 0;
+      uint32_t sentenceBits = s.getSignBits();
+      for (uint32_t i = 0; i < NUM_SIGNS; i++) {
+        if (sentenceBits & (1 << i)) {
+          positionSum += i;
+        }
+      }
+
+      // (zip-in times + per-word holds) + (2s whole-sentence hold) + (zip-out times + per-word holds)
+      return (positionSum * SLIDE_TO_END_PER_WORD_ZIP + s.getNumWords() * SLIDE_TO_END_PER_WORD_HOLD)
+          + SLIDE_TO_END_DEFAULT_SENTENCE_HOLD
+          + (positionSum * SLIDE_TO_END_PER_WORD_ZIP + s.getNumWords() * SLIDE_TO_END_PER_WORD_HOLD);
+    },
+    &Animation::_planSlide },
+  { Effect::EF_MELT, "EF_MELT", EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t {
+      // time for all words to melt plus full-sign hold time plus blank outro hold time.
+      return MELT_ONE_WORD_MILLIS * NUM_SIGNS + MELT_OPTIMAL_HOLD_TIME + MELT_BLANK_TIME;
+    },
+    &Animation::_planMelt },
+  { Effect::EF_PROGRAM, "EF_PROGRAM", EFFECT_FLAG_RANDOM | EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t {
+      return getEffectProgram().duration; // Programs have fixed timing.
+    },
+    &Animation::_planProgram },
+
+  //// Special-purpose effects ////
+  { Effect::EF_ALL_BRIGHT, "EF_ALL_BRIGHT", EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t { return ALL_BRIGHT_MILLIS; },
+    &Animation::_planAllBright },
+  { Effect::EF_ALL_DARK, "EF_ALL_DARK", EFFECT_FLAG_BUTTON,
+    [](const Sentence &s) -> uint32_t { return ALL_DARK_MILLIS; },
+    &Animation::_planAllDark },
+  { Effect::EF_FADE_LOVE_HATE, "EF_FADE_LOVE_HATE", 0,
+    [](const Sentence &s) -> uint32_t { return FADE_LOVE_HATE_MILLIS; },
+    &Animation::_planFadeLoveHate },
+  { Effect::EF_NO_EFFECT, "EF_NO_EFFECT", 0,
+    [](const Sentence &s) -> uint32_t {
+      return 0; // No-effect animation should not occupy any duration.
+    },
+    &Animation::_planNoEffect },
+};
+
+/** Return true if every descriptor in the registry sits at the index of the effect it describes. */
+constexpr bool isEffectRegistryOrdered() {
+  for (unsigned int i = 0; i < NUM_EFFECTS; i++) {
+    if ((unsigned int)Animation::EFFECTS[i].effect != i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(isEffectRegistryOrdered(), "Animation::EFFECTS must be listed in Effect enum order");
+
+/** Return the number of effects whose descriptors have all the specified EFFECT_FLAG_* flags. */
+constexpr unsigned int countEffectsWith(uint8_t flags) {
+  unsigned int count = 0;
+  for (const EffectDesc &desc : Animation::EFFECTS) {
+    if ((desc.flags & flags) == flags) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/** Return the effects whose descriptors have all the specified EFFECT_FLAG_* flags, in enum order. */
+template<uint8_t flags>
+constexpr array<Effect, countEffectsWith(flags)> effectsWith() {
+  array<Effect, countEffectsWith(flags)> effects{};
+  unsigned int count = 0;
+  for (const EffectDesc &desc : Animation::EFFECTS) {
+    if ((desc.flags & flags) == flags) {
+      effects[count++] = desc.effect;
+    }
+  }
+  return effects;
+}
+
+// The effects that randomEffect() chooses among.
+constexpr auto RANDOM_EFFECTS = effectsWith<EFFECT_FLAG_RANDOM>();
+// The effects that user buttons can lock in; each has a button handler.
+constexpr auto BUTTON_EFFECTS = effectsWith<EFFECT_FLAG_BUTTON>();
+
+static_assert(RANDOM_EFFECTS.size() > 0, "At least one effect must be available to randomEffect()");
+
+/** Return a random Effect. */
+inline Effect randomEffect() {
+  return RANDOM_EFFECTS[random(RANDOM_EFFECTS.size())];
 };
 
-extern Animation activeAnimation;
+// The Animation shown on the signs.
+extern Animation *activeAnimation;
+// The Animation planned to run after the active one. (See like-the-art.cpp.)
+extern Animation *nextAnimation;
 
 #endif // _ANIMATION_H
 
@@ -7,14 +7,49 @@ static constexpr uint8_t SELF_TEST_BTN_PIN = 4; // The admin self-test button is
 
 // PCF8574N on channel 0x23 reads buttons 1--8.
 static I2CParallel buttonBank;
+// The button bank's open-drain INT output is on D12. The PCF8574 pulls it low when an input
+// changes, until the bank is next read.
+static constexpr uint8_t BTN_INT_PIN = 12;
+
+// Each pin-change interrupt (through the EIC) records the edge it saw in the button event queue.
+// The EIC interrupts all run at the same priority, so they never preempt one another and
+// together are the queue's single producer; pollButtons() is its consumer.
+static constexpr uint8_t BTN_EVENT_BTN0 = 0;
+static constexpr uint8_t BTN_EVENT_BANK = 1; // The bank's INT line fell; the bank must be read.
+static constexpr uint8_t BTN_EVENT_SELF_TEST = 2;
+
+struct ButtonEvent {
+  uint32_t micros; // When the interrupt saw the edge.
+  uint8_t source;  // BTN_EVENT_*
+  uint8_t level;   // The input level after the edge. (Not for BTN_EVENT_BANK.)
+};
 
-// Keep a rolling history buffer of button presses
-static constexpr uint8_t CODE_LENGTH = 10;
-static constexpr uint8_t MAX_PRESS_HISTORY = CODE_LENGTH + 1;
-static const uint8_t adminCodeSequence[CODE_LENGTH] = { 1, 0, 4, 8, 5, 1, 5, 6, 6, 3 };
-static uint8_t buttonHistory[MAX_PRESS_HISTORY]; // Circular rolling history buffer
-static uint8_t firstPressIdx;
-static uint8_t nextPressIdx;
+static constexpr unsigned int BUTTON_EVENT_QUEUE_LEN = 32;
+static SpscRing<ButtonEvent, BUTTON_EVENT_QUEUE_LEN> buttonEvents;
+static uint32_t reportedEventOverflows = 0;
+
+// When the buttons are next read regardless of any recorded edge.
+static unsigned long nextSafetyPollMicros = 0;
+
+// Service codes keyed in on the main buttons, and the action each one triggers. The others
+// share the admin code's first 9 keys.
+static constexpr uint8_t CODE_ADMIN_MENU = 0;     // Enter admin mode.
+static constexpr uint8_t CODE_IN_ORDER_TEST = 1;  // Enter admin mode and test each sign in order.
+static constexpr uint8_t CODE_REBOOT = 2;         // Reboot at once.
+static constexpr uint8_t CODE_STATUS_REPORT = 3;  // Print the system status on the debug console.
+
+static constexpr unsigned int MAX_CODE_LENGTH = 10;
+static constexpr array<KeyCode<MAX_CODE_LENGTH>, 4> serviceCodes = {{
+  { CODE_ADMIN_MENU,    10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 3 } },
+  { CODE_IN_ORDER_TEST, 10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 0 } },
+  { CODE_REBOOT,        10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 8 } },
+  { CODE_STATUS_REPORT, 10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 2 } },
+}};
+
+// Each button press advances the service code matcher by one state.
+static constexpr auto serviceCodeMatcher = makeCodeMatcher<NUM_MAIN_BUTTONS,
+    codeMatcherStates(serviceCodes)>(serviceCodes);
+static uint8_t codeMatchState;
 
 // Record timestamps of recent button presses in rolling-history form.
 static constexpr uint8_t TIME_HISTORY_LENGTH = 5; // number of timestamps to track
@@ -30,19 +65,25 @@ static constexpr unsigned long TOO_FAST_LOCKOUT_MILLIS = 25000;
 static constexpr uint8_t BUTTON_ROTATION_THRESHOLD = 25;
 static uint8_t numButtonPresses = 0;
 
+// Debounce state of every button, as words with bit n for button id n.
+static ButtonDebouncer buttonDebouncer;
+static constexpr uint16_t BANK_BUTTONS_MASK = 0x1FE; // Buttons 1..8.
+static constexpr uint16_t MAIN_BUTTONS_MASK = (1 << NUM_MAIN_BUTTONS) - 1;
+// When each button's input last changed (per millis()): at the recorded edge, if there was one.
+static uint32_t inputChangeMillis[16];
+
 // All 9 standard UI Button instances.
 vector<Button> buttons;
 
+// Called when a button is pressed while others are held, if set.
+static chordHandler_t chordHandlerFn = NULL;
+
 static void adminSelfTestButtonHandler(uint8_t btnId, uint8_t btnState); // fwd-declare method.
 // Another button wired internally to the enclosure enters admin self-test mode.
 static Button adminSelfTestButton(ADMIN_BTN_ID, adminSelfTestButtonHandler);
 
 static void wipePasswordHistory() {
-  firstPressIdx = 0;
-  nextPressIdx = 0;
-  for (uint8_t i = 0; i < MAX_PRESS_HISTORY; i++) {
-    buttonHistory[i] = 0;
-  }
+  codeMatchState = serviceCodeMatcher.START_STATE;
 
   firstTimestampIdx = 0;
   nextTimestampIdx = 0;
@@ -51,6 +92,19 @@ static void wipePasswordHistory() {
   }
 }
 
+static void onBtn0Edge() {
+  buttonEvents.push({ (uint32_t)micros(), BTN_EVENT_BTN0, (uint8_t)digitalRead(BTN0_PIN) });
+}
+
+static void onButtonBankInt() {
+  buttonEvents.push({ (uint32_t)micros(), BTN_EVENT_BANK, 0 });
+}
+
+static void onSelfTestBtnEdge() {
+  buttonEvents.push({ (uint32_t)micros(), BTN_EVENT_SELF_TEST,
+      (uint8_t)digitalRead(SELF_TEST_BTN_PIN) });
+}
+
 /** Initial setup of buttons invoked by the setup() method. */
 void setupButtons() {
   buttonBank.init(3 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
@@ -58,6 +112,14 @@ void setupButtons() {
 
   pinMode(BTN0_PIN, INPUT_PULLUP);
   pinMode(SELF_TEST_BTN_PIN, INPUT_PULLUP);
+  pinMode(BTN_INT_PIN, INPUT_PULLUP);
+
+  if constexpr (BUTTON_INTERRUPTS_ENABLED) {
+    attachInterrupt(digitalPinToInterrupt(BTN0_PIN), onBtn0Edge, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(BTN_INT_PIN), onButtonBankInt, FALLING);
+    attachInterrupt(digitalPinToInterrupt(SELF_TEST_BTN_PIN), onSelfTestBtnEdge, CHANGE);
+  }
+  nextSafetyPollMicros = micros(); // The first poll reads everything.
 
   // Allocate the button state and dispatch handlers.
   buttons.clear();
@@ -80,20 +142,123 @@ void setupButtons() {
  * (Technically, the buttons have pull-down resistors and switch to 3V3 when pressed;
  * but they then pass through a 74LVC14A Schmitt-trigger inverter before passing
  * onto the communications net described above.)
+ *
+ * Buttons change a few times an hour, so the pin-change interrupts (and the PCF8574's INT line,
+ * for buttons 1..8) record each edge, with its time, in the button event queue. Each input is
+ * otherwise only read while its button is debouncing and every BUTTON_SAFETY_POLL_MICROS.
+ * That keeps the I2C bus free for the sign banks nearly all of the time.
+ *
+ * Debouncing counts polls (one every BUTTON_POLL_MICROS): an input must hold for the button's
+ * debounce interval's worth of polls to register. A gpio button whose interrupt saw it
+ * bounce between polls starts its count over. Edge times don't shorten the debounce; they
+ * only set when the new state began, as reported by Button::getStateChangeMillis().
  */
 void pollButtons() {
+  unsigned long nowMicros = micros();
+  uint32_t nowMillis = millis();
+
+  // Apply the recorded edges, in order. The gpio buttons' levels were read by the interrupt; a
+  // bank edge only says that the bank changed, and when.
+  uint16_t inputs = buttonDebouncer.getInputs();
+  uint16_t bounced = 0;
+  bool isBankEdge = false;
+  uint32_t bankEdgeMillis = 0;
+  ButtonEvent event;
+  while (buttonEvents.pop(event)) {
+    // Edges recorded after 'nowMicros' count as now.
+    int32_t ageMicros = max((int32_t)(nowMicros - event.micros), (int32_t)0);
+    uint32_t eventMillis = nowMillis - ageMicros / 1000;
+    uint8_t id = ADMIN_BTN_ID;
+    switch (event.source) {
+    case BTN_EVENT_BTN0:
+      id = 0;
+      break;
+    case BTN_EVENT_BANK:
+      if (!isBankEdge) {
+        isBankEdge = true;
+        bankEdgeMillis = eventMillis;
+      }
+      continue;
+    case BTN_EVENT_SELF_TEST:
+      id = ADMIN_BTN_ID;
+      break;
+    }
+    inputs = (inputs & ~(1 << id)) | (event.level << id);
+    bounced |= 1 << id;
+    inputChangeMillis[id] = eventMillis;
+  }
+
+  // Read everything at the safety poll, or if edges were lost.
+  bool isReadAll = !BUTTON_INTERRUPTS_ENABLED;
+  uint32_t eventOverflows = buttonEvents.getOverflowCount();
+  if (eventOverflows != reportedEventOverflows) {
+    DBGPRINTU("*** WARNING: Button event queue overflowed; total events dropped:", eventOverflows);
+    reportedEventOverflows = eventOverflows;
+    isReadAll = true;
+  }
+  if ((long)(nowMicros - nextSafetyPollMicros) >= 0) {
+    nextSafetyPollMicros = nowMicros + BUTTON_SAFETY_POLL_MICROS;
+    isReadAll = true;
+  }
+
+  // Debouncing buttons are read on every poll.
+  uint16_t unsettled = buttonDebouncer.getUnsettled() | bounced;
+  uint16_t polledInputs = inputs;
+
   // Button 0 is connected directly to a digital gpio input
-  buttons[0].update(digitalRead(BTN0_PIN));
+  if (isReadAll || (unsettled & (1 << 0))) {
+    polledInputs = (polledInputs & ~(1 << 0)) | (digitalRead(BTN0_PIN) << 0);
+  }
 
-  // Buttons 1..8 are connected thru the PCF8574 and are read as a byte.
-  uint8_t btnBankState = buttonBank.read();
-  for (uint8_t i = 0; i < 8; i++) {
-    uint8_t btnState = (btnBankState >> i) & 0x1;
-    buttons[i + 1].update(btnState);
+  // Buttons 1..8 are connected thru the PCF8574 and are read as a byte. The INT line stays low
+  // until the bank is read, so a change can't hide behind an edge that came during the last read.
+  if (isReadAll || isBankEdge || (unsettled & BANK_BUTTONS_MASK) || digitalRead(BTN_INT_PIN) == LOW) {
+    uint8_t btnBankState = buttonBank.read();
+    polledInputs = (polledInputs & ~BANK_BUTTONS_MASK) | (btnBankState << 1);
+    if (isBankEdge) {
+      // Buttons that changed did so at the edge.
+      for (uint16_t changed = (polledInputs ^ inputs) & BANK_BUTTONS_MASK; changed != 0;
+          changed &= changed - 1) {
+        inputChangeMillis[__builtin_ctz(changed)] = bankEdgeMillis;
+      }
+      inputs = (inputs & ~BANK_BUTTONS_MASK) | (polledInputs & BANK_BUTTONS_MASK);
+    }
   }
 
   // The hard-wired self-test button is also direct gpio.
-  adminSelfTestButton.update(digitalRead(SELF_TEST_BTN_PIN));
+  if (isReadAll || (unsettled & (1 << ADMIN_BTN_ID))) {
+    polledInputs = (polledInputs & ~(1 << ADMIN_BTN_ID))
+        | (digitalRead(SELF_TEST_BTN_PIN) << ADMIN_BTN_ID);
+  }
+
+  // Inputs found changed by a read, not by a recorded edge, changed about now.
+  for (uint16_t changed = polledInputs ^ inputs; changed != 0; changed &= changed - 1) {
+    inputChangeMillis[__builtin_ctz(changed)] = nowMillis;
+  }
+
+  // Debounce every button at once, then dispatch the changes. A gpio button's interrupt read its
+  // level at the edge; if this poll reads the same, that's a second sample of it.
+  uint16_t confirmed = bounced & ~(polledInputs ^ inputs);
+  uint16_t stateChanges = buttonDebouncer.poll(polledInputs, bounced, confirmed);
+  uint16_t state = buttonDebouncer.getState();
+  for (uint16_t changed = stateChanges; changed != 0; changed &= changed - 1) {
+    uint8_t id = __builtin_ctz(changed);
+    Button &btn = (id == ADMIN_BTN_ID) ? adminSelfTestButton : buttons[id];
+    btn._onStateChange((state >> id) & 1, inputChangeMillis[id]);
+  }
+
+  // A press while other main buttons are held makes a chord of all of them.
+  uint16_t heldMask = ~state & MAIN_BUTTONS_MASK;
+  if ((stateChanges & heldMask) != 0 && (heldMask & (heldMask - 1)) != 0
+      && chordHandlerFn != NULL) {
+    (*chordHandlerFn)(heldMask);
+  }
+
+  // Recognize long presses. (A handler above may have released a button's state.)
+  heldMask = ~buttonDebouncer.getState() & MAIN_BUTTONS_MASK;
+  for (; heldMask != 0; heldMask &= heldMask - 1) {
+    buttons[__builtin_ctz(heldMask)]._pollLongPress(nowMillis);
+  }
 }
 
 /**
@@ -103,7 +268,7 @@ void pollButtons() {
  * - stop() the current animation
  * - configure a new Animation of EF_ALL_BRIGHT with flags |= ANIM_FLAG_FULL_SIGN_GLITCH
  * -- which sets all signs to flickerThreshold of 925
- * -- and also sets up a length EF_ALL_DARK animation on-deck.
+ * -- and also queues up a lengthy EF_ALL_DARK animation to follow it.
  * - Disable buttons for 25 seconds
  */
 static void buttonOverSpeedResponse() {
@@ -112,26 +277,60 @@ static void buttonOverSpeedResponse() {
   // A sentence itself isn't shown by this animation, just need a placeholder for the arg.
   const Sentence &dummySentence = sentences[mainMsgId()];
 
-  activeAnimation.stop();
-  activeAnimation.setParameters(dummySentence, Effect::EF_ALL_BRIGHT,
+  activeAnimation->stop();
+  activeAnimation->setParameters(dummySentence, Effect::EF_ALL_BRIGHT,
       ANIM_FLAG_FULL_SIGN_GLITCH_DARK, 0);
-  activeAnimation.start();
+  activeAnimation->start();
 
   // Convert the button handlers to "wait mode" where they'll still count toward
   // password entry but not fire further user-driven effects. The user's in "time
   // out" for a while.
   attachWaitModeButtonHandlers();
 
-  // Also queue up another "animation" of all-signs-off to follow on-deck after
+  // Also queue up another "animation" of all-signs-off to follow after
   // the glitching out finishes.
   // At the end of this complete animation sequence, buttons should be restored.
-  setOnDeckAnimationParams(mainMsgId(), Effect::EF_ALL_DARK, ANIM_FLAG_RESET_BUTTONS_ON_END);
+  queueNextAnimation(mainMsgId(), Effect::EF_ALL_DARK, ANIM_FLAG_RESET_BUTTONS_ON_END);
+}
+
+/** Print the system status to the debug console. */
+static void reportStatus() {
+  DBGPRINT("*** Status report ***");
+  DBGPRINTU("Uptime (ms):", millis());
+  DBGPRINTU("MacroState:", (unsigned int)macroState);
+  printCurrentBrightness();
+  DBGPRINTU("Last DARK sensor reading:", getLastDarkSensorValue());
+  printDarkThreshold();
+  DBGPRINTU("Button events dropped:", buttonEvents.getOverflowCount());
+}
+
+/** Perform the action of the service code that was just keyed in. */
+static void runServiceCode(uint8_t codeId) {
+  switch (codeId) {
+  case CODE_ADMIN_MENU:
+    setMacroStateAdmin();
+    break;
+  case CODE_IN_ORDER_TEST:
+    setMacroStateAdmin();
+    performInOrderTest();
+    break;
+  case CODE_REBOOT:
+    DBGPRINT("*** REBOOTING SYSTEM (service code) ***");
+    NVIC_SystemReset();
+    break;
+  case CODE_STATUS_REPORT:
+    reportStatus();
+    break;
+  default:
+    DBGPRINTU("*** ERROR: Unknown service code id:", codeId);
+    break;
+  }
 }
 
 /**
  * Record a rolling history of the most recent button presses.
- * If the user has entered the sequence that enables admin mode, switch to that
- * macro state.
+ * If the user has entered a service code (e.g. the sequence that enables admin mode),
+ * perform its action.
  */
 static void recordButtonHistory(uint8_t btnId, uint8_t btnState=BTN_PRESSED) {
   if (btnState != BTN_PRESSED) {
@@ -148,39 +347,23 @@ static void recordButtonHistory(uint8_t btnId, uint8_t btnState=BTN_PRESSED) {
     return;
   }
 
-  // Record the timestamp of the button press
-  buttonPressTimeHistory[nextTimestampIdx] = millis();
+  // Record the timestamp of the button press: when it was pressed, not when it was debounced.
+  buttonPressTimeHistory[nextTimestampIdx] =
+      (btnId < buttons.size()) ? buttons[btnId].getStateChangeMillis() : millis();
   nextTimestampIdx = (nextTimestampIdx + 1) % MAX_TIME_HISTORY;
   if (nextTimestampIdx == firstTimestampIdx) {
     firstTimestampIdx = (firstTimestampIdx + 1) % MAX_TIME_HISTORY;
   }
 
-  // Record the latest button press
-  buttonHistory[nextPressIdx] = btnId;
-  nextPressIdx = (nextPressIdx + 1) % MAX_PRESS_HISTORY;
-  if (nextPressIdx == firstPressIdx) {
-    firstPressIdx = (firstPressIdx + 1) % MAX_PRESS_HISTORY;
-  }
-
-  // Check whether last N button presses matched the admin code.
-  bool match = true;
-  unsigned int counted = 0;
-  for (uint8_t i = 0; i < min(CODE_LENGTH, (uint8_t)(nextPressIdx - firstPressIdx)); i++) {
-    counted++;
-    if (buttonHistory[(i + firstPressIdx) % MAX_PRESS_HISTORY] != adminCodeSequence[i]) {
-      match = false;
-    }
-    if (!match) {
-      break; // No need to continue comparison.
-    }
-  }
-
-  if (match && counted == CODE_LENGTH) {
-    // The user has keyed in the admin access code sequence.
-    // Switch to admin macro state.
-    setMacroStateAdmin();
+  // Check whether this press completes a service code.
+  codeMatchState = serviceCodeMatcher.step(codeMatchState, btnId);
+  uint8_t codeId = serviceCodeMatcher.match[codeMatchState];
+  if (codeId != serviceCodeMatcher.NO_MATCH) {
+    // The user has keyed in a service code, e.g. the admin access code sequence.
+    DBGPRINTU("Service code entered:", codeId);
     wipePasswordHistory();
-    return; // Nothing further to do once we transfer to admin mode.
+    runServiceCode(codeId);
+    return; // A code's presses don't count toward scrambling or glitching out.
   }
 
   // Increment the number of buttons that we've seen pressed.
@@ -234,137 +417,183 @@ void adminSelfTestButtonHandler(uint8_t btnId, uint8_t btnState) {
 }
 
 
+ButtonDebouncer::ButtonDebouncer():
+    _inputs(0xFFFF), _state(0xFFFF), _count(), _pushThreshold(), _releaseThreshold() {
+}
+
+void ButtonDebouncer::setThresholds(uint8_t id, unsigned int pushPolls, unsigned int releasePolls) {
+  pushPolls = max(min(pushPolls, MAX_DEBOUNCE_POLLS), 1U);
+  releasePolls = max(min(releasePolls, MAX_DEBOUNCE_POLLS), 1U);
+
+  uint16_t bit = 1 << id;
+  for (unsigned int k = 0; k < DEBOUNCE_COUNTER_BITS; k++) {
+    _pushThreshold[k] = (_pushThreshold[k] & ~bit) | (((pushPolls >> k) & 1) ? bit : 0);
+    _releaseThreshold[k] = (_releaseThreshold[k] & ~bit) | (((releasePolls >> k) & 1) ? bit : 0);
+  }
+}
+
+uint16_t ButtonDebouncer::poll(uint16_t inputs, uint16_t bouncedMask, uint16_t confirmedMask) {
+  // Buttons whose input differs from their state, and has held since the previous poll, count
+  // one more poll. Every other count starts over at 0.
+  uint16_t held = (inputs ^ _state) & ~((inputs ^ _inputs) | bouncedMask);
+  // Open buttons pressed now, and at the previous poll or by the confirming sample.
+  uint16_t pressing = _state & ~inputs;
+  uint16_t stablePresses = pressing
+      & ((~_inputs & ~bouncedMask) | (confirmedMask & ~(_inputs ^ _state)));
+  _inputs = inputs;
+
+  uint16_t carry = held;
+  for (unsigned int k = 0; k < DEBOUNCE_COUNTER_BITS; k++) {
+    uint16_t nextCarry = _count[k] & carry;
+    _count[k] = (_count[k] ^ carry) & held;
+    carry = nextCarry;
+  }
+
+  // Compare each count with its threshold (the push threshold if the button is open, release
+  // if pressed), from the top bit down.
+  uint16_t isGreater = 0;
+  uint16_t isEqual = 0xFFFF;
+  for (int k = DEBOUNCE_COUNTER_BITS - 1; k >= 0; k--) {
+    uint16_t threshold = (_pushThreshold[k] & _state) | (_releaseThreshold[k] & ~_state);
+    isGreater |= isEqual & _count[k] & ~threshold;
+    isEqual &= ~(_count[k] ^ threshold);
+  }
+
+  // Lock in the inputs that have held long enough as the new state.
+  uint16_t changed = held & (isGreater | isEqual);
+  if constexpr (IMMEDIATE_BUTTON_PRESSES) {
+    changed |= stablePresses;
+  }
+  _state ^= changed;
+  for (unsigned int k = 0; k < DEBOUNCE_COUNTER_BITS; k++) {
+    _count[k] &= ~changed;
+  }
+
+  return changed;
+}
+
 Button::Button(uint8_t id, buttonHandler_t handlerFn):
-    _id(id), _curState(BTN_OPEN), _priorPoll(BTN_OPEN), _readStartTime(0),
+    _id(id), _stateChangeMillis(0), _pressMillis(0),
     _pushDebounceInterval(BTN_DEBOUNCE_MILLIS),
     _releaseDebounceInterval(BTN_DEBOUNCE_MILLIS),
-    _handlerFn(handlerFn) {
+    _handlerFn(handlerFn),
+    _longPressHandlerFn(NULL), _longPressMillis(0), _isLongPressPending(false),
+    _doubleTapHandlerFn(NULL), _isDoubleTapArmed(false) {
 
   if (NULL == _handlerFn) {
     _handlerFn = defaultBtnHandler;
   }
+  _setDebounceThresholds();
 }
 
-bool Button::update(uint8_t latestPoll) {
-  latestPoll = (latestPoll != 0); // Collapse input into a 1/0 universe.
+uint8_t Button::getState() const {
+  return (buttonDebouncer.getState() >> _id) & 1;
+}
 
-  if (latestPoll != _priorPoll) {
-    // Input has changed since we last polled. Reset debounce timer.
-    _readStartTime = millis();
-  }
+bool Button::isSettled() const {
+  return !((buttonDebouncer.getUnsettled() >> _id) & 1);
+}
+
+void Button::setPushDebounceInterval(unsigned int debounce) {
+  _pushDebounceInterval = debounce;
+  _setDebounceThresholds();
+}
+
+void Button::setReleaseDebounceInterval(unsigned int debounce) {
+  _releaseDebounceInterval = debounce;
+  _setDebounceThresholds();
+}
+
+// A change registers once the input has held for longer than the debounce interval, as seen by
+// the polls every BUTTON_POLL_MICROS.
+void Button::_setDebounceThresholds() {
+  static constexpr unsigned int BUTTON_POLL_MILLIS = BUTTON_POLL_MICROS / 1000;
+  buttonDebouncer.setThresholds(_id, _pushDebounceInterval / BUTTON_POLL_MILLIS + 1,
+      _releaseDebounceInterval / BUTTON_POLL_MILLIS + 1);
+}
 
-  // Save reading for next interrogation of update().
-  _priorPoll = latestPoll;
+void Button::setLongPressHandler(buttonHandler_t handlerFn, unsigned int holdMillis) {
+  _longPressHandlerFn = handlerFn;
+  _longPressMillis = holdMillis;
+  _isLongPressPending = false; // Only a press after this counts.
+}
+
+void Button::clearGestureHandlers() {
+  _longPressHandlerFn = NULL;
+  _isLongPressPending = false;
+  _doubleTapHandlerFn = NULL;
+}
 
-  // Decide which debounce interval to use, depending on whether we're monitoring
-  // for a next state change of "push" (0 to 1) or "release" (1 to 0).
-  unsigned int debounceInterval = _pushDebounceInterval;
-  if (_curState == BTN_PRESSED) {
-    debounceInterval = _releaseDebounceInterval;
+void Button::_onStateChange(uint8_t btnState, uint32_t changeMillis) {
+  _stateChangeMillis = changeMillis;
+  if (btnState == BTN_OPEN) {
+    _isLongPressPending = false;
+    (*_handlerFn)(_id, btnState); // Invoke callback handler.
+    return;
   }
 
-  if ((millis() - _readStartTime) > debounceInterval) {
-    // The reading has remained consistent for the debounce interval.
-    // It's a legitimate state.
+  // The handlers subscribed to this press, before the press handler can change them.
+  buttonHandler_t doubleTapHandlerFn = NULL;
+  if (_isDoubleTapArmed && changeMillis - _pressMillis <= DOUBLE_TAP_MILLIS) {
+    doubleTapHandlerFn = _doubleTapHandlerFn;
+    _isDoubleTapArmed = false; // A third tap begins the next double tap.
+  } else {
+    _isDoubleTapArmed = true;
+  }
+  _pressMillis = changeMillis;
+  _isLongPressPending = (_longPressHandlerFn != NULL);
 
-    if (latestPoll != _curState) {
-      _curState = latestPoll; // Lock this in as the new state.
-      (*_handlerFn)(_id, _curState); // Invoke callback handler.
-      return true;
-    }
+  (*_handlerFn)(_id, btnState); // Invoke callback handler.
+  if (doubleTapHandlerFn != NULL) {
+    (*doubleTapHandlerFn)(_id, btnState);
   }
+}
 
-  return false; // No state change.
+void Button::_pollLongPress(uint32_t nowMillis) {
+  if (_isLongPressPending && nowMillis - _pressMillis >= _longPressMillis) {
+    _isLongPressPending = false;
+    (*_longPressHandlerFn)(_id, BTN_PRESSED);
+  }
 }
 
 //// Button handler functions that change the active sentence or the active effect ////
 
-// Several buttons fix a particular active animation effect for several seconds:
-#define EFFECT_BTN_NAME(effect_enum) btnHandlerEffect_##effect_enum
-#define EFFECT_BTN_FN(effect_enum) \
-  extern "C" void EFFECT_BTN_NAME(effect_enum) (uint8_t btnId, uint8_t btnState) { \
-    recordButtonHistory(btnId, btnState); \
-    lockEffect(Effect::effect_enum); \
-  }
-
-EFFECT_BTN_FN(EF_APPEAR);
-EFFECT_BTN_FN(EF_GLOW);
-EFFECT_BTN_FN(EF_BLINK);
-EFFECT_BTN_FN(EF_BLINK_FAST);
-EFFECT_BTN_FN(EF_ONE_AT_A_TIME);
-EFFECT_BTN_FN(EF_BUILD);
-EFFECT_BTN_FN(EF_BUILD_RANDOM);
-EFFECT_BTN_FN(EF_SNAKE);
-EFFECT_BTN_FN(EF_SLIDE_TO_END);
-EFFECT_BTN_FN(EF_MELT);
-EFFECT_BTN_FN(EF_ALL_BRIGHT);
-EFFECT_BTN_FN(EF_ALL_DARK);
+// Several buttons fix a particular active animation effect for several seconds. There is one
+// handler for each effect in BUTTON_EFFECTS.
+template<Effect effect>
+static void effectBtnHandler(uint8_t btnId, uint8_t btnState) {
+  recordButtonHistory(btnId, btnState);
+  lockEffect(effect);
+}
 
 // Other buttons fix a particular sentence to be the active sentence for several seconds.
-// There are 18 sentences defined, and we have a separate handler method to invoke each.
-#define SENTENCE_BTN_NAME(sentence_id) btnHandlerSentence_##sentence_id
-#define SENTENCE_BTN_FN(sentence_id) \
-  extern "C" void SENTENCE_BTN_NAME(sentence_id) (uint8_t btnId, uint8_t btnState) { \
-    recordButtonHistory(btnId, btnState); \
-    lockSentence(sentence_id); \
-  }
-
-SENTENCE_BTN_FN(0);
-SENTENCE_BTN_FN(1);
-SENTENCE_BTN_FN(2);
-SENTENCE_BTN_FN(3);
-SENTENCE_BTN_FN(4);
-SENTENCE_BTN_FN(5);
-SENTENCE_BTN_FN(6);
-SENTENCE_BTN_FN(7);
-SENTENCE_BTN_FN(8);
-SENTENCE_BTN_FN(9);
-SENTENCE_BTN_FN(10);
-SENTENCE_BTN_FN(11);
-SENTENCE_BTN_FN(12);
-SENTENCE_BTN_FN(13);
-SENTENCE_BTN_FN(14);
-SENTENCE_BTN_FN(15);
-SENTENCE_BTN_FN(16);
-SENTENCE_BTN_FN(17);
+// There is a separate handler for each of the NUM_SENTENCES sentences.
+template<unsigned int sentenceId>
+static void sentenceBtnHandler(uint8_t btnId, uint8_t btnState) {
+  recordButtonHistory(btnId, btnState);
+  lockSentence(sentenceId);
+}
+
+/** Return the array of handlers for each of BUTTON_EFFECTS, followed by each sentence id. */
+template<size_t... effectIdx, size_t... sentenceIds>
+static constexpr array<buttonHandler_t, sizeof...(effectIdx) + sizeof...(sentenceIds)>
+makeUserButtonFns(std::index_sequence<effectIdx...>, std::index_sequence<sentenceIds...>) {
+  return {{ effectBtnHandler<BUTTON_EFFECTS[effectIdx]>...,
+      sentenceBtnHandler<sentenceIds>... }};
+}
 
 // All the handlers that can be assigned to the 9 buttons in the running MacroState.
-static const buttonHandler_t userButtonFns[] = {
-  EFFECT_BTN_NAME(EF_APPEAR),
-  EFFECT_BTN_NAME(EF_GLOW),
-  EFFECT_BTN_NAME(EF_BLINK),
-  EFFECT_BTN_NAME(EF_BLINK_FAST),
-  EFFECT_BTN_NAME(EF_ONE_AT_A_TIME),
-  EFFECT_BTN_NAME(EF_BUILD),
-  EFFECT_BTN_NAME(EF_BUILD_RANDOM),
-  EFFECT_BTN_NAME(EF_SNAKE),
-  EFFECT_BTN_NAME(EF_SLIDE_TO_END),
-  EFFECT_BTN_NAME(EF_MELT),
-  EFFECT_BTN_NAME(EF_ALL_BRIGHT),
-  EFFECT_BTN_NAME(EF_ALL_DARK),
-
-  SENTENCE_BTN_NAME(0),
-  SENTENCE_BTN_NAME(1),
-  SENTENCE_BTN_NAME(2),
-  SENTENCE_BTN_NAME(3),
-  SENTENCE_BTN_NAME(4),
-  SENTENCE_BTN_NAME(5),
-  SENTENCE_BTN_NAME(6),
-  SENTENCE_BTN_NAME(7),
-  SENTENCE_BTN_NAME(8),
-  SENTENCE_BTN_NAME(9),
-  SENTENCE_BTN_NAME(10),
-  SENTENCE_BTN_NAME(11),
-  SENTENCE_BTN_NAME(12),
-  SENTENCE_BTN_NAME(13),
-  SENTENCE_BTN_NAME(14),
-  SENTENCE_BTN_NAME(15),
-  SENTENCE_BTN_NAME(16),
-  SENTENCE_BTN_NAME(17),
-};
+static constexpr auto userButtonFns = makeUserButtonFns(
+    std::make_index_sequence<BUTTON_EFFECTS.size()>(),
+    std::make_index_sequence<NUM_SENTENCES>());
+
+static_assert(userButtonFns.size() == BUTTON_EFFECTS.size() + NUM_SENTENCES,
+    "Need one button handler for each addressable effect and each sentence");
+static_assert(userButtonFns.size() >= NUM_MAIN_BUTTONS,
+    "Need at least as many button handlers as there are buttons to assign them to");
 
 // The length of the userButtonFns array.
-static constexpr unsigned int NUM_USER_BUTTON_FNS = std::size(userButtonFns);
+static constexpr unsigned int NUM_USER_BUTTON_FNS = userButtonFns.size();
 unsigned int numUserButtonFns() {
   return NUM_USER_BUTTON_FNS;
 }
@@ -379,7 +608,7 @@ static void shuffleButtonHandlers() {
   static constexpr unsigned int NUM_SHUFFLES = NUM_USER_BUTTON_FNS * 20;
 
   // Initialize the shuffled button handler array from the pristine handler array.
-  memcpy(shuffledUserButtonFns, userButtonFns, sizeof(buttonHandler_t) * NUM_USER_BUTTON_FNS);
+  memcpy(shuffledUserButtonFns, userButtonFns.data(), sizeof(buttonHandler_t) * NUM_USER_BUTTON_FNS);
 
   // Perform a number of exchanges between random positions in the array.
   for (unsigned int i = 0; i < NUM_SHUFFLES; i++) {
@@ -403,10 +632,11 @@ void attachStandardButtonHandlers() {
   for (uint8_t i = 0; i < NUM_MAIN_BUTTONS; i++) {
     buttons[i].setHandler(shuffledUserButtonFns[i]);
 
-    buttons[i].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
-    buttons[i].setReleaseDebounceInterval(BTN_DEBOUNCE_MILLIS);
+    buttons[i].clearGestureHandlers();
   }
 
+  chordHandlerFn = NULL;
+
   numButtonPresses = 0; // Reset the counter for when to next scramble the buttons.
 }
 
@@ -417,20 +647,25 @@ void attachWaitModeButtonHandlers() {
 
   for (uint8_t i = 0; i < NUM_MAIN_BUTTONS; i++) {
     buttons[i].setHandler(defaultBtnHandler);
-    buttons[i].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
-    buttons[i].setReleaseDebounceInterval(BTN_DEBOUNCE_MILLIS);
+    buttons[i].clearGestureHandlers();
   }
+  chordHandlerFn = NULL;
 
   numButtonPresses = 0;
 }
 
 /**
- * Attach the empty handler (and default timing) to all buttons.
+ * Attach the empty handler (and no gesture handlers) to all buttons.
  */
 void attachEmptyButtonHandlers() {
   for (uint8_t i = 0; i < NUM_MAIN_BUTTONS; i++) {
     buttons[i].setHandler(emptyBtnHandler);
-    buttons[i].setPushDebounceInterval(BTN_DEBOUNCE_MILLIS);
-    buttons[i].setReleaseDebounceInterval(BTN_DEBOUNCE_MILLIS);
+    buttons[i].clearGestureHandlers();
   }
+  chordHandlerFn = NULL;
+}
+
+/** Set the handler called when a button is pressed while other main buttons are held. */
+void setChordHandler(chordHandler_t handlerFn) {
+  chordHandlerFn = handlerFn;
 }
@@ -17,37 +17,115 @@ constexpr uint8_t BTN_OPEN = 1;
 
 // A function called whenever a button has definitively changed state.
 typedef void (*buttonHandler_t)(uint8_t id, uint8_t btnState);
+// A function called when a button is pressed while others are held, with all the held buttons.
+typedef void (*chordHandler_t)(uint16_t btnMask);
 
-class Button {
+/* A press within 400 ms of the same button's previous press is a double tap. */
+constexpr unsigned int DOUBLE_TAP_MILLIS = 400;
+
+// Debounce counters have this many bits, so a debounce interval can span at most
+// 2^DEBOUNCE_COUNTER_BITS - 1 polls. (Over 5 seconds at BUTTON_POLL_MICROS.)
+constexpr unsigned int DEBOUNCE_COUNTER_BITS = 8;
+constexpr unsigned int MAX_DEBOUNCE_POLLS = (1 << DEBOUNCE_COUNTER_BITS) - 1;
+
+/**
+ * Debounces up to 16 buttons at once, as one word with bit n for button id n (1 if open, 0 if
+ * pressed, like Button::getState()).
+ *
+ * Each button whose input differs from its registered state counts the polls for which the
+ * input has held. The counts are kept as vertical counters: _count[k] holds bit k of every
+ * button's count, so one increment or comparison of all 16 counts is a few bitwise operations
+ * per counter bit. A button's state changes once its count reaches its threshold, which is
+ * also bit-sliced, one set for pushes and one for releases.
+ */
+class ButtonDebouncer {
 public:
-  Button(uint8_t id, buttonHandler_t handlerFn);
+  ButtonDebouncer();
+
+  // Set the number of polls (1..MAX_DEBOUNCE_POLLS) for which a button's input must hold before
+  // it's registered as pushed, or released.
+  void setThresholds(uint8_t id, unsigned int pushPolls, unsigned int releasePolls);
 
   /**
-   * Called to tell the button about the latest polled signal and register
-   * as a press/release if appropriate.
+   * Take one poll of every input. Buttons in bouncedMask are known to have changed since the
+   * previous poll (e.g. twice, back to the same level), so their count starts over. Buttons in
+   * confirmedMask had their input sampled at the same level once already since the previous
+   * poll (e.g. by their pin-change interrupt).
    *
-   * Returns true if the state has decisively changed, false otherwise.
+   * If IMMEDIATE_BUTTON_PRESSES is enabled, a press from the open state registers as soon as two
+   * samples agree on it: this poll and the previous one, with no bounce seen between them; or
+   * this poll and the confirming sample, if the button was settled open at the previous poll.
+   * A one-sample glitch never registers. Releases, and other presses, count their polls as usual.
+   *
+   * Returns the mask of buttons whose registered state changed.
    */
-  bool update(uint8_t latestPoll);
+  uint16_t poll(uint16_t inputs, uint16_t bouncedMask, uint16_t confirmedMask = 0);
+
+  uint16_t getState() const { return _state; };
+  uint16_t getInputs() const { return _inputs; }; // As of the latest poll.
+  // Buttons whose input differs from their registered state, i.e. they're debouncing.
+  uint16_t getUnsettled() const { return _inputs ^ _state; };
+
+private:
+  uint16_t _inputs;
+  uint16_t _state;
+  uint16_t _count[DEBOUNCE_COUNTER_BITS];
+  uint16_t _pushThreshold[DEBOUNCE_COUNTER_BITS];
+  uint16_t _releaseThreshold[DEBOUNCE_COUNTER_BITS];
+};
+
+/**
+ * A Button is a handle on one button's debounced state (in the ButtonDebouncer that
+ * pollButtons() runs for all of them), with its handler and debounce intervals.
+ */
+class Button {
+public:
+  Button(uint8_t id, buttonHandler_t handlerFn);
 
   /** Returns 0 if button pressed, 1 if open. */
-  uint8_t getState() const { return _curState; };
+  uint8_t getState() const;
+  /** False while the input differs from the registered state, i.e. it's debouncing. */
+  bool isSettled() const;
+  /** When (per millis()) the input changed to the registered state. */
+  uint32_t getStateChangeMillis() const { return _stateChangeMillis; };
 
   void setHandler(buttonHandler_t handlerFn) { _handlerFn = handlerFn; };
   const buttonHandler_t getHandler() const { return _handlerFn; };
 
   unsigned int getPushDebounceInterval() const { return _pushDebounceInterval; };
-  void setPushDebounceInterval(unsigned int debounce) { _pushDebounceInterval = debounce; };
-  void setReleaseDebounceInterval(unsigned int debounce) { _releaseDebounceInterval = debounce; };
+  void setPushDebounceInterval(unsigned int debounce);
+  void setReleaseDebounceInterval(unsigned int debounce);
+
+  /**
+   * Call handlerFn (with BTN_PRESSED) once the button has been held for holdMillis, while it's
+   * still held. The press itself has already gone to the ordinary handler.
+   */
+  void setLongPressHandler(buttonHandler_t handlerFn, unsigned int holdMillis);
+  /** Call handlerFn (with BTN_PRESSED) on a press within DOUBLE_TAP_MILLIS of the previous one. */
+  void setDoubleTapHandler(buttonHandler_t handlerFn) { _doubleTapHandlerFn = handlerFn; };
+  /** Unsubscribe from long presses and double taps. */
+  void clearGestureHandlers();
+
+  // Called by pollButtons() when the debouncer registers a new state.
+  void _onStateChange(uint8_t btnState, uint32_t changeMillis);
+  // Called by pollButtons() while the button is pressed, to recognize a long press.
+  void _pollLongPress(uint32_t nowMillis);
 
 private:
+  void _setDebounceThresholds();
+
   uint8_t _id;
-  uint8_t _curState;
-  uint8_t _priorPoll;
-  uint32_t _readStartTime;
+  uint32_t _stateChangeMillis;
+  uint32_t _pressMillis; // When the latest press began.
   unsigned int _pushDebounceInterval;
   unsigned int _releaseDebounceInterval;
   buttonHandler_t _handlerFn;
+
+  buttonHandler_t _longPressHandlerFn;
+  unsigned int _longPressMillis;
+  bool _isLongPressPending; // Held, but not yet long enough for the long-press handler.
+  buttonHandler_t _doubleTapHandlerFn;
+  bool _isDoubleTapArmed; // The latest press can begin a double tap.
 };
 
 extern "C" {
@@ -58,6 +136,7 @@ extern "C" {
   void attachStandardButtonHandlers();
   void attachWaitModeButtonHandlers();
   void attachEmptyButtonHandlers();
+  void setChordHandler(chordHandler_t handlerFn);
 };
 
 extern vector<Button> buttons;
@@ -0,0 +1,262 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// The frame compositor and its overlay layers.
+
+#include "like-the-art.h"
+
+// Return 1/ln(p), the scale factor that turns ln(U) for uniform U in (0, 1] into a
+// geometrically-distributed count of frames that a sign stays in a state it keeps with
+// per-frame probability p. (This is <= 0 for p < 1.) Returns a positive value if the state
+// is kept forever (p == 1).
+static float flickerRunScale(unsigned int stayCount) {
+  if (stayCount >= FLICKER_RANGE_MAX) {
+    return 1.0f; // Never leaves this state.
+  } else if (stayCount == 0) {
+    return 0.0f; // Always leaves this state after one frame.
+  }
+
+  return 1.0f / logf((float)stayCount / (float)FLICKER_RANGE_MAX);
+}
+
+FlickerOverlay::FlickerOverlay(const char *name): Overlay(name) {
+  clear();
+}
+
+void FlickerOverlay::setThreshold(unsigned int signId, unsigned int threshold) {
+  uint32_t signBit = 1 << signId;
+  _threshold[signId] = threshold;
+  _primed &= ~signBit; // Redraw the flicker state with the new odds.
+  if (threshold == FLICKER_ALWAYS_ON) {
+    _flickering &= ~signBit;
+    _flickeredOff &= ~signBit;
+  } else {
+    _flickering |= signBit;
+    threshold = min(threshold, FLICKER_RANGE_MAX);
+    _runScale[signId][0] = flickerRunScale(threshold); // P(off -> off)
+    _runScale[signId][1] = flickerRunScale(FLICKER_RANGE_MAX - threshold); // P(on -> on)
+  }
+}
+
+void FlickerOverlay::clear() {
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    _threshold[i] = FLICKER_ALWAYS_ON;
+  }
+  _flickering = 0;
+  _flickeredOff = 0;
+  _lastLit = 0;
+  _primed = 0;
+  _nextToggleFrame = UINT32_MAX;
+}
+
+// Resolution of the uniform random draw used to sample flicker run lengths.
+static constexpr long FLICKER_RUN_RANDOM_RANGE = 1 << 24;
+
+/**
+ * Sample the number of frames (>= 1) that a sign stays in its current on/off state,
+ * starting with the current frame.
+ *
+ * If a sign is on in each frame independently with probability p, the length of a run of
+ * 'on' frames is geometric: P(len = k) = p^(k-1) * (1 - p). (Likewise for 'off' with 1 - p.)
+ * We sample that by inverting the CDF: len = 1 + floor(ln(U) / ln(p)).
+ */
+uint32_t FlickerOverlay::_runLength(unsigned int signId, bool isOn) {
+  float scale = _runScale[signId][isOn];
+  if (scale > 0) {
+    return UINT32_MAX; // This state is permanent.
+  }
+
+  float u = (float)(random(FLICKER_RUN_RANDOM_RANGE) + 1) / (float)FLICKER_RUN_RANDOM_RANGE;
+  float extraFrames = logf(u) * scale;
+  if (extraFrames >= (float)(UINT32_MAX / 2)) {
+    return UINT32_MAX / 2;
+  }
+  return 1 + (uint32_t)extraFrames;
+}
+
+/**
+ * Advance the flickering signs to the current flicker frame and switch off the lit signs that
+ * are flickered off. Each flickering sign only costs a comparison until the end of its current
+ * on/off run; the random number generator is only called when a sign changes state (or first
+ * starts flickering). Each sign draws at most two random numbers per call.
+ */
+void FlickerOverlay::apply(Frame &frame, uint32_t millis) {
+  // Signs that were just switched on start in the 'on' position; their flicker state is
+  // freshly drawn below. Signs that were already on are unaffected.
+  uint32_t newlyLit = frame.signBits & ~_lastLit;
+  _flickeredOff &= ~newlyLit;
+  _primed &= ~newlyLit;
+  _lastLit = frame.signBits;
+
+  uint32_t frameNum = millis / FLICKER_FRAME_MILLIS;
+  uint32_t flickerSet = frame.signBits & _flickering;
+  if ((flickerSet & ~_primed) == 0 && frameNum < _nextToggleFrame) {
+    // No sign changes state in this frame.
+    frame.signBits &= ~_flickeredOff;
+    return;
+  }
+
+  uint32_t nextToggleFrame = UINT32_MAX;
+  while (flickerSet) {
+    unsigned int signId = __builtin_ctz(flickerSet);
+    uint32_t signBit = 1 << signId;
+    flickerSet &= flickerSet - 1; // Clear lowest set bit.
+
+    bool isOn;
+    if (!(_primed & signBit) || _toggleFrame[signId] < frameNum) {
+      // Just started flickering, or frames were skipped past the end of its run. The state in
+      // each frame is independent of the others, so a fresh roll for this frame is exactly what
+      // replaying the missed runs would produce.
+      isOn = (unsigned int)random(FLICKER_RANGE_MAX) >= _threshold[signId];
+      _primed |= signBit;
+    } else if (_toggleFrame[signId] == frameNum) {
+      // Current run is over; switch state.
+      isOn = (_flickeredOff & signBit) != 0;
+    } else {
+      nextToggleFrame = min(nextToggleFrame, _toggleFrame[signId]);
+      continue; // Still mid-run.
+    }
+
+    if (isOn) {
+      _flickeredOff &= ~signBit;
+    } else {
+      _flickeredOff |= signBit;
+    }
+
+    uint32_t runLength = _runLength(signId, isOn);
+    uint32_t toggleFrame = (runLength == UINT32_MAX) ? UINT32_MAX : frameNum + runLength;
+    _toggleFrame[signId] = toggleFrame;
+    nextToggleFrame = min(nextToggleFrame, toggleFrame);
+  }
+
+  _nextToggleFrame = nextToggleFrame;
+  frame.signBits &= ~_flickeredOff;
+}
+
+uint32_t FlickerOverlay::getNextChangeMillis() const {
+  if (_lastLit & _flickering & ~_primed) {
+    return 0;
+  } else if (_nextToggleFrame >= UINT32_MAX / FLICKER_FRAME_MILLIS) {
+    return UINT32_MAX;
+  }
+
+  return _nextToggleFrame * FLICKER_FRAME_MILLIS;
+}
+
+WordSwapOverlay::WordSwapOverlay(const char *name): Overlay(name) {
+  setup(0, 0, 0, 0);
+}
+
+void WordSwapOverlay::setup(uint32_t fromSignBits, uint32_t toSignBits, uint32_t introMillis,
+    uint32_t swapMillis) {
+  _from = fromSignBits;
+  _to = toSignBits;
+  _introMillis = introMillis;
+  _swapMillis = swapMillis;
+  _nextChangeMillis = introMillis;
+}
+
+// Set the sign level of every sign in signBits.
+static void setSignLevels(Frame &frame, uint32_t signBits, uint8_t level) {
+  while (signBits) {
+    unsigned int signId = __builtin_ctz(signBits);
+    signBits &= signBits - 1; // Clear lowest set bit.
+    frame.signLevel[signId] = level;
+  }
+}
+
+void WordSwapOverlay::apply(Frame &frame, uint32_t millis) {
+  if (millis < _introMillis) {
+    return; // Intro: leave the frame as-is.
+  }
+
+  uint32_t swapPos = millis - _introMillis;
+  if (swapPos >= _swapMillis) {
+    // The swap is complete.
+    frame.signBits = (frame.signBits & ~_from) | _to;
+    _nextChangeMillis = UINT32_MAX;
+    return;
+  }
+
+  // The level only changes in SIGN_LEVEL_FULL steps over the swap; note when the next one is.
+  uint32_t toLevel = (swapPos * SIGN_LEVEL_FULL) / _swapMillis;
+  _nextChangeMillis = _introMillis + ((toLevel + 1) * _swapMillis + SIGN_LEVEL_FULL - 1)
+      / SIGN_LEVEL_FULL;
+
+  frame.signBits |= _from | _to;
+  setSignLevels(frame, _from, SIGN_LEVEL_FULL - toLevel);
+  setSignLevels(frame, _to, toLevel);
+}
+
+uint32_t WordSwapOverlay::getNextChangeMillis() const {
+  return _nextChangeMillis;
+}
+
+Compositor::Compositor(): _layers(), _numLayers(0) {
+}
+
+void Compositor::clear() {
+  _numLayers = 0;
+}
+
+void Compositor::addLayer(Overlay *overlay, uint32_t startMillis, uint32_t endMillis) {
+  if (_numLayers == MAX_OVERLAYS) {
+    DBGPRINT("*** WARNING: Too many overlay layers; dropping layer:");
+    DBGPRINT(overlay->name());
+    return;
+  }
+
+  Layer &layer = _layers[_numLayers++];
+  layer.overlay = overlay;
+  layer.startMillis = startMillis;
+  layer.endMillis = endMillis;
+  layer.maxMicros = 0;
+}
+
+/**
+ * Apply every layer whose window covers elapsedMillis to the frame, bottom layer first.
+ */
+void Compositor::apply(Frame &frame, uint32_t elapsedMillis) {
+  for (unsigned int i = 0; i < _numLayers; i++) {
+    Layer &layer = _layers[i];
+    if (elapsedMillis < layer.startMillis || elapsedMillis >= layer.endMillis) {
+      continue;
+    }
+
+    if constexpr (REPORT_OVERLAY_COSTS) {
+      uint32_t startMicros = micros();
+      layer.overlay->apply(frame, elapsedMillis - layer.startMillis);
+      uint32_t layerMicros = micros() - startMicros;
+      if (layerMicros > layer.maxMicros) {
+        layer.maxMicros = layerMicros;
+      }
+    } else {
+      layer.overlay->apply(frame, elapsedMillis - layer.startMillis);
+    }
+  }
+}
+
+uint32_t Compositor::getNextChangeMillis(uint32_t elapsedMillis) const {
+  uint32_t nextChangeMillis = UINT32_MAX;
+  for (unsigned int i = 0; i < _numLayers; i++) {
+    const Layer &layer = _layers[i];
+    if (elapsedMillis < layer.startMillis) {
+      nextChangeMillis = min(nextChangeMillis, layer.startMillis);
+    } else if (elapsedMillis < layer.endMillis) {
+      // The frame may change when the layer ends, or whenever the layer says so.
+      nextChangeMillis = min(nextChangeMillis, layer.endMillis);
+      uint32_t layerChangeMillis = layer.overlay->getNextChangeMillis();
+      if (layerChangeMillis != UINT32_MAX) {
+        nextChangeMillis = min(nextChangeMillis, layer.startMillis + layerChangeMillis);
+      }
+    }
+  }
+
+  return nextChangeMillis;
+}
+
+void Compositor::logLayerCosts() const {
+  for (unsigned int i = 0; i < _numLayers; i++) {
+    DBGPRINT(_layers[i].overlay->name());
+    DBGPRINTU("  Max micros per frame:", _layers[i].maxMicros);
+  }
+}
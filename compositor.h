@@ -0,0 +1,159 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// The frame compositor: a base effect renders a Frame, and overlay layers transform it
+// before it is committed to the signs and PWM.
+
+#ifndef _COMPOSITOR_H
+#define _COMPOSITOR_H
+
+// Brightness levels within a Frame are expressed as a fraction of the configured max
+// brightness, in units of 1 / KF_LEVEL_FULL.
+constexpr unsigned int KF_LEVEL_SHIFT = 15;
+constexpr uint16_t KF_LEVEL_FULL = 1 << KF_LEVEL_SHIFT;
+
+/**
+ * What the sign shows for one frame: the signs that are lit, the brightness of all of them, and
+ * the virtual brightness of each sign within that (see SignBoard).
+ */
+struct Frame {
+  uint32_t signBits; // Lit signs (within the animation's sign scope).
+  uint16_t level;    // Brightness, from 0 to KF_LEVEL_FULL.
+  uint8_t signLevel[NUM_SIGNS]; // Per-sign brightness, from 0 to SIGN_LEVEL_FULL.
+  uint16_t zoneLevel[NUM_PWM_ZONES]; // Brightness of each PWM zone, as a fraction of 'level'.
+};
+
+/**
+ * An overlay transforms the Frame rendered by the base effect (and any overlays beneath it).
+ *
+ * Time is given in millis since the start of the layer's window within the animation. An
+ * overlay's apply() must do a bounded amount of work regardless of how long it has been since
+ * the previous call; frames may be late or skipped.
+ */
+class Overlay {
+public:
+  Overlay(const char *name): _name(name) { };
+
+  virtual void apply(Frame &frame, uint32_t millis) = 0;
+  // Return the earliest time (millis into the window) at which apply() may change its output
+  // for an unchanged input, or UINT32_MAX if it never will.
+  virtual uint32_t getNextChangeMillis() const = 0;
+
+  const char *name() const { return _name; };
+
+private:
+  const char *_name;
+};
+
+// Flickering advances on a fixed clock of 'flicker frames', independent of the main loop rate.
+constexpr unsigned int FLICKER_FRAME_MILLIS = 10;
+
+constexpr unsigned int FLICKER_RANGE_MAX = 1000;
+constexpr unsigned int FLICKER_ALWAYS_ON = 0;
+constexpr unsigned int FLICKER_ALWAYS_OFF = FLICKER_RANGE_MAX;
+
+// Sub-range within (ALWAYS_ON, RANGE_MAX] used when assigning flicker potential
+// to a sign determined to be flickering for the subsequent animation.
+constexpr unsigned int FLICKER_ASSIGN_MIN = 50;
+constexpr unsigned int FLICKER_ASSIGN_MAX = 300;
+
+/**
+ * Randomly switches lit signs off for runs of flicker frames.
+ *
+ * A flickering sign is on in any given flicker frame with probability
+ * (FLICKER_RANGE_MAX - threshold) / FLICKER_RANGE_MAX, independently of other frames.
+ * (As if we generated a random number 'r' between 0 and FLICKER_RANGE_MAX each frame, and
+ * lit the sign if r >= threshold.) A threshold of 0 (FLICKER_ALWAYS_ON) means the sign does
+ * not flicker. Signs that are not lit in the input frame do not flicker.
+ */
+class FlickerOverlay: public Overlay {
+public:
+  FlickerOverlay(const char *name);
+
+  void apply(Frame &frame, uint32_t millis) override;
+  uint32_t getNextChangeMillis() const override;
+
+  void clear(); // Set every sign to FLICKER_ALWAYS_ON.
+  void setThreshold(unsigned int signId, unsigned int threshold);
+  unsigned int getThreshold(unsigned int signId) const { return _threshold[signId]; };
+  uint32_t getFlickering() const { return _flickering; }; // Signs with a non-zero threshold.
+
+private:
+  uint32_t _runLength(unsigned int signId, bool isOn);
+
+  uint32_t _flickering;   // Signs with a flicker threshold other than FLICKER_ALWAYS_ON.
+  uint32_t _flickeredOff; // Signs currently flickered into the 'off' position.
+  uint32_t _lastLit;      // Signs lit in the input of the previous apply().
+  uint16_t _threshold[NUM_SIGNS];
+
+  // Rather than rolling the dice for every flickering sign on every frame, we sample how many
+  // frames each sign stays in its current on/off state and only touch it again when that
+  // run ends.
+  uint32_t _primed;          // Flickering signs whose current run length has been drawn.
+  uint32_t _nextToggleFrame; // Earliest frame number at which any sign toggles.
+  uint32_t _toggleFrame[NUM_SIGNS]; // Frame number where each sign's current run ends.
+  // Per-sign scale factor 1/ln(p) that converts a uniform random draw into a run length,
+  // where p is the per-frame probability of staying off [0] or staying on [1].
+  float _runScale[NUM_SIGNS][2];
+};
+
+/**
+ * Crossfades from one word to another. After an intro in which the frame passes through
+ * unchanged, both words are lit and the sign level of the 'to' word rises linearly from 0 to
+ * SIGN_LEVEL_FULL over the swap phase, while the 'from' word falls to 0. After that, only 'to'
+ * is lit.
+ */
+class WordSwapOverlay: public Overlay {
+public:
+  WordSwapOverlay(const char *name);
+
+  void apply(Frame &frame, uint32_t millis) override;
+  uint32_t getNextChangeMillis() const override;
+
+  void setup(uint32_t fromSignBits, uint32_t toSignBits, uint32_t introMillis,
+      uint32_t swapMillis);
+
+private:
+  uint32_t _from;
+  uint32_t _to;
+  uint32_t _introMillis;
+  uint32_t _swapMillis;
+  uint32_t _nextChangeMillis;
+};
+
+// Max number of overlay layers in a Compositor.
+constexpr unsigned int MAX_OVERLAYS = 4;
+
+/**
+ * Applies a stack of overlays to each frame, bottom layer first. Each layer is active within a
+ * window of the animation's timeline; outside of it, the layer is skipped. Layers may overlap.
+ *
+ * The compositor does not own its overlays; they must outlive it.
+ */
+class Compositor {
+public:
+  Compositor();
+
+  void clear(); // Remove all layers.
+  // Add a layer on top of the stack, active from startMillis (inclusive) to endMillis (exclusive).
+  void addLayer(Overlay *overlay, uint32_t startMillis, uint32_t endMillis);
+
+  void apply(Frame &frame, uint32_t elapsedMillis);
+  // Return the earliest time (in millis since the start of the animation, after elapsedMillis)
+  // at which any layer may change the frame, or UINT32_MAX if none will.
+  uint32_t getNextChangeMillis(uint32_t elapsedMillis) const;
+
+  void logLayerCosts() const; // Log the worst-case time spent in each layer.
+
+private:
+  struct Layer {
+    Overlay *overlay;
+    uint32_t startMillis;
+    uint32_t endMillis;
+    uint32_t maxMicros; // Longest apply() seen, if REPORT_OVERLAY_COSTS.
+  };
+
+  Layer _layers[MAX_OVERLAYS];
+  unsigned int _numLayers;
+};
+
+#endif // _COMPOSITOR_H
@@ -0,0 +1,349 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Verification, storage, and loading of effect programs. The interpreter itself is the
+// EF_PROGRAM planner in animation.cpp.
+
+#include "like-the-art.h"
+
+// Conservative upper bound on the time for the interpreter to execute one instruction,
+// including its share of handing a keyframe over to the animation.
+static constexpr unsigned int VM_STEP_MICROS = 2;
+// The interpreter may use this much of each frame; the rest of LOOP_MICROS is left for the I2C
+// writes and everything else the main loop does.
+static constexpr unsigned int VM_FRAME_BUDGET_MICROS = LOOP_MICROS / 10;
+static constexpr unsigned int VM_MAX_STEPS_PER_FRAME = VM_FRAME_BUDGET_MICROS / VM_STEP_MICROS;
+
+#define LE16(x) (uint8_t)((x) & 0xFF), (uint8_t)((x) >> 8)
+
+// The program EF_PROGRAM plays until one is installed: words of the sentence sparkle on one at a
+// time, in random order; then the whole sentence glows up, holds, and fades out.
+static const uint8_t BUILTIN_EFFECT_PROGRAM[] = {
+  OP_LOOP, 6,
+    OP_PICK,
+    OP_SHOW_PICK,
+    OP_WAIT, LE16(200),
+    OP_HIDE_PICK,
+    OP_WAIT, LE16(100),
+  OP_NEXT,
+  OP_LEVEL, LE16(0),
+  OP_SHOW_WORDS,
+  OP_RAMP, LE16(VM_LEVEL_FULL), LE16(1000),
+  OP_WAIT, LE16(3000),
+  OP_RAMP, LE16(0), LE16(1000),
+  OP_HIDE_WORDS,
+  OP_WAIT, LE16(500),
+  OP_END,
+};
+
+#undef LE16
+
+/**
+ * Counts the instructions that the interpreter executes in each frame while a program plays.
+ *
+ * The EF_PROGRAM planner is resumed when the animation crosses a keyframe, and runs until it
+ * emits the next one; so the instructions between two keyframes run in the frame that shows the
+ * first of them. A frame covers LOOP_MILLIS of the timeline, starting at no particular
+ * millisecond, so it overlaps at most two LOOP_MILLIS-aligned buckets. We require that any two
+ * adjacent buckets fit in the budget together. (A late frame catches up on more of the timeline,
+ * as it does for every effect.)
+ */
+struct FrameBudget {
+  uint32_t bucket = 0;
+  uint32_t bucketSteps = 0;
+  uint32_t prevBucketSteps = 0;
+
+  // Charge 'steps' instructions to the frame that shows 'millis'; return false if over budget.
+  bool charge(uint32_t millis, uint32_t steps) {
+    uint32_t frameBucket = millis / LOOP_MILLIS;
+    if (frameBucket != bucket) {
+      prevBucketSteps = (frameBucket == bucket + 1) ? bucketSteps : 0;
+      bucket = frameBucket;
+      bucketSteps = 0;
+    }
+
+    bucketSteps += steps;
+    return prevBucketSteps + bucketSteps <= VM_MAX_STEPS_PER_FRAME;
+  }
+};
+
+/**
+ * Verify an effect program before it can be played.
+ *
+ * First, every instruction is decoded to check its operands and the loop structure. Then the
+ * program's control flow is run through, which is exact: loop counts are fixed, and the only
+ * random choice (OP_PICK) doesn't affect which instructions run or when. That gives the duration
+ * and the number of instructions executed in each frame.
+ */
+int verifyEffectProgram(const uint8_t *code, size_t size, uint32_t *durationOut) {
+  if (size == 0 || size > MAX_EFFECT_PROGRAM_SIZE) {
+    return VERIFY_BAD_SIZE;
+  }
+
+  unsigned int depth = 0;
+  uint8_t lastOp = OP_END;
+  for (size_t pc = 0; pc < size; pc += effectOpSize(code[pc])) {
+    const uint8_t op = code[pc];
+    const uint8_t *operand = code + pc + 1;
+    if (effectOpSize(op) == 0) {
+      return VERIFY_BAD_OPCODE;
+    } else if (pc + effectOpSize(op) > size) {
+      return VERIFY_TRUNCATED;
+    } else if (lastOp == OP_END && pc > 0) {
+      return VERIFY_NO_END; // Code after OP_END.
+    }
+
+    switch (op) {
+    case OP_SHOW:
+    case OP_HIDE:
+      if (effectOperand16(operand) & ~ALL_SIGNS_MASK) {
+        return VERIFY_BAD_OPERAND;
+      }
+      break;
+    case OP_LEVEL:
+    case OP_RAMP:
+      if (effectOperand16(operand) > VM_LEVEL_FULL) {
+        return VERIFY_BAD_OPERAND;
+      }
+      break;
+    case OP_LOOP:
+      if (operand[0] == 0) {
+        return VERIFY_BAD_OPERAND;
+      } else if (++depth > VM_MAX_LOOP_DEPTH) {
+        return VERIFY_BAD_LOOP;
+      }
+      break;
+    case OP_NEXT:
+      if (depth == 0) {
+        return VERIFY_BAD_LOOP;
+      }
+      depth--;
+      break;
+    }
+
+    lastOp = op;
+  }
+
+  if (lastOp != OP_END) {
+    return VERIFY_NO_END;
+  } else if (depth != 0) {
+    return VERIFY_BAD_LOOP;
+  }
+
+  // Run through the control flow the same way the interpreter does.
+  uint16_t loopPc[VM_MAX_LOOP_DEPTH];
+  uint8_t loopCount[VM_MAX_LOOP_DEPTH];
+  FrameBudget budget;
+  uint32_t t = 0;
+  uint32_t steps = 0;
+  uint32_t segmentSteps = 0; // Instructions since the last keyframe...
+  uint32_t segmentMillis = 0; // ... which run in the frame that shows that keyframe.
+  size_t pc = 0;
+  depth = 0;
+  while (code[pc] != OP_END) {
+    const uint8_t op = code[pc];
+    const uint8_t *operand = code + pc + 1;
+    if (++steps > VM_MAX_PROGRAM_STEPS) {
+      return VERIFY_TOO_MANY_STEPS;
+    }
+    segmentSteps++;
+
+    switch (op) {
+    case OP_WAIT:
+    case OP_RAMP:
+      // Emits a keyframe at 't'.
+      if (!budget.charge(segmentMillis, segmentSteps)) {
+        return VERIFY_OVER_BUDGET;
+      }
+      segmentMillis = t;
+      segmentSteps = 0;
+      t += effectOperand16(op == OP_WAIT ? operand : operand + 2);
+      if (t > VM_MAX_DURATION_MILLIS) {
+        return VERIFY_TOO_LONG;
+      }
+      break;
+    case OP_LOOP:
+      loopPc[depth] = pc + effectOpSize(op);
+      loopCount[depth] = operand[0];
+      depth++;
+      break;
+    case OP_NEXT:
+      if (--loopCount[depth - 1] > 0) {
+        pc = loopPc[depth - 1];
+        continue;
+      }
+      depth--;
+      break;
+    }
+
+    pc += effectOpSize(op);
+  }
+
+  // OP_END emits the final keyframe; one more call finds the program is done.
+  if (!budget.charge(segmentMillis, segmentSteps + 2)) {
+    return VERIFY_OVER_BUDGET;
+  } else if (t == 0) {
+    return VERIFY_TOO_LONG; // Nothing to show.
+  }
+
+  *durationOut = t;
+  return VERIFY_OK;
+}
+
+constexpr uint32_t EFFECT_PROGRAM_SIGNATURE = 0x3E7A5C19;
+
+// An installed program is stored in the SmartEEPROM after the field configuration.
+struct __attribute__((packed, aligned(4))) effect_program_slot_t {
+  uint32_t validitySignature;
+  uint16_t size;
+  uint8_t padding[2];
+  uint8_t code[MAX_EFFECT_PROGRAM_SIZE];
+};
+typedef struct effect_program_slot_t EffectProgramSlot;
+
+static constexpr unsigned int PROGRAM_EEPROM_OFFSET = 16;
+static_assert(sizeof(DeviceFieldConfig) <= PROGRAM_EEPROM_OFFSET,
+    "Effect program slot overlaps the field configuration");
+static_assert(PROGRAM_EEPROM_OFFSET + sizeof(EffectProgramSlot) <= 512,
+    "Effect program slot must fit in the 512 byte SmartEEPROM configured in setup()");
+
+// The installed program, copied from EEPROM.
+static EffectProgramSlot installedProgram;
+static EffectProgram activeProgram = { BUILTIN_EFFECT_PROGRAM, sizeof(BUILTIN_EFFECT_PROGRAM), 0 };
+
+static void useBuiltinEffectProgram() {
+  activeProgram.code = BUILTIN_EFFECT_PROGRAM;
+  activeProgram.size = sizeof(BUILTIN_EFFECT_PROGRAM);
+  int ret = verifyEffectProgram(activeProgram.code, activeProgram.size, &activeProgram.duration);
+  if (ret != VERIFY_OK) {
+    DBGPRINTI("*** ERROR: Built-in effect program failed verification:", ret);
+    activeProgram.duration = 0;
+  }
+}
+
+void setupEffectProgram() {
+  useBuiltinEffectProgram();
+
+  if (readEEPROM(PROGRAM_EEPROM_OFFSET, &installedProgram) != EEPROM_SUCCESS
+      || installedProgram.validitySignature != EFFECT_PROGRAM_SIGNATURE) {
+    DBGPRINT("No effect program installed; using built-in program.");
+    return;
+  }
+
+  uint32_t duration;
+  int ret = verifyEffectProgram(installedProgram.code, installedProgram.size, &duration);
+  if (ret != VERIFY_OK) {
+    DBGPRINTI("*** WARNING: Installed effect program failed verification:", ret);
+    return;
+  }
+
+  activeProgram.code = installedProgram.code;
+  activeProgram.size = installedProgram.size;
+  activeProgram.duration = duration;
+  DBGPRINTU("Loaded effect program; duration:", duration);
+}
+
+const EffectProgram &getEffectProgram() {
+  return activeProgram;
+}
+
+int installEffectProgram(const uint8_t *code, size_t size) {
+  uint32_t duration;
+  int ret = verifyEffectProgram(code, size, &duration);
+  if (ret != VERIFY_OK) {
+    return ret;
+  }
+
+  // The interpreter reads the program as it plays; don't change it out from under it.
+  if (activeAnimation->getEffect() == Effect::EF_PROGRAM) {
+    activeAnimation->stop();
+  }
+
+  installedProgram.validitySignature = EFFECT_PROGRAM_SIGNATURE;
+  installedProgram.size = size;
+  memset(installedProgram.code, OP_END, sizeof(installedProgram.code));
+  memcpy(installedProgram.code, code, size);
+  activeProgram.code = installedProgram.code;
+  activeProgram.size = size;
+  activeProgram.duration = duration;
+
+  if (writeEEPROM(PROGRAM_EEPROM_OFFSET, &installedProgram) != EEPROM_SUCCESS
+      || commitEEPROM() != EEPROM_SUCCESS) {
+    return INSTALL_WRITE_FAILED; // It plays until the next reboot.
+  }
+
+  return VERIFY_OK;
+}
+
+// The loader accepts lines of the form "program <hex bytes>", as written by tools/effectasm.py.
+static constexpr char LOADER_COMMAND[] = "program ";
+static constexpr size_t LOADER_COMMAND_LEN = sizeof(LOADER_COMMAND) - 1;
+static char loaderLine[LOADER_COMMAND_LEN + 2 * MAX_EFFECT_PROGRAM_SIZE + 1];
+static size_t loaderLineLen = 0;
+static bool isLoaderLineTooLong = false;
+
+/** Return the value of a hex digit, or -1 if it isn't one. */
+static int hexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static void loadProgramLine(const char *hex, size_t hexLen) {
+  uint8_t code[MAX_EFFECT_PROGRAM_SIZE];
+  if (hexLen % 2 != 0 || hexLen / 2 > MAX_EFFECT_PROGRAM_SIZE) {
+    DBGPRINT("*** ERROR: Malformed effect program");
+    return;
+  }
+
+  for (size_t i = 0; i < hexLen / 2; i++) {
+    int hi = hexDigit(hex[2 * i]);
+    int lo = hexDigit(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      DBGPRINT("*** ERROR: Malformed effect program");
+      return;
+    }
+    code[i] = (hi << 4) | lo;
+  }
+
+  int ret = installEffectProgram(code, hexLen / 2);
+  if (ret == VERIFY_OK) {
+    DBGPRINTU("Installed effect program; duration:", getEffectProgram().duration);
+  } else {
+    DBGPRINTI("*** ERROR: Effect program rejected:", ret);
+  }
+}
+
+/**
+ * Read any serial input available; once a full line is in, install the program it holds.
+ * Lines that aren't program commands are ignored.
+ */
+void pollEffectProgramLoader() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r') {
+      continue;
+    } else if (c != '\n') {
+      if (loaderLineLen < sizeof(loaderLine)) {
+        loaderLine[loaderLineLen++] = c;
+      } else {
+        isLoaderLineTooLong = true;
+      }
+      continue;
+    }
+
+    if (isLoaderLineTooLong) {
+      DBGPRINT("*** ERROR: Effect program is too long");
+    } else if (loaderLineLen >= LOADER_COMMAND_LEN
+        && strncmp(loaderLine, LOADER_COMMAND, LOADER_COMMAND_LEN) == 0) {
+      loadProgramLine(loaderLine + LOADER_COMMAND_LEN, loaderLineLen - LOADER_COMMAND_LEN);
+    }
+
+    loaderLineLen = 0;
+    isLoaderLineTooLong = false;
+  }
+}
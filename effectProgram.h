@@ -0,0 +1,118 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Effect programs: animations written in a compact bytecode, played by EF_PROGRAM.
+// A program can be installed into SmartEEPROM over the USB serial port in admin mode,
+// so new effects don't require a firmware update.
+
+#ifndef _EFFECT_PROGRAM_H
+#define _EFFECT_PROGRAM_H
+
+// Opcodes. Multi-byte operands follow the opcode, little-endian.
+//
+// The program keeps a set of lit signs and a brightness level, and shows them in the
+// animation's timeline with OP_WAIT and OP_RAMP. Nothing is shown until one of those executes.
+constexpr uint8_t OP_END = 0x00;        // End of program. Must be the last instruction.
+constexpr uint8_t OP_SHOW = 0x01;       // <mask:16> Light the signs in the mask.
+constexpr uint8_t OP_HIDE = 0x02;       // <mask:16> Turn off the signs in the mask.
+constexpr uint8_t OP_SHOW_WORDS = 0x03; // Light the words of the sentence.
+constexpr uint8_t OP_HIDE_WORDS = 0x04; // Turn off the words of the sentence.
+constexpr uint8_t OP_PICK = 0x05;       // Pick a random word of the sentence, not picked before
+                                        // until all have been.
+constexpr uint8_t OP_SHOW_PICK = 0x06;  // Light the picked word.
+constexpr uint8_t OP_HIDE_PICK = 0x07;  // Turn off the picked word.
+constexpr uint8_t OP_LEVEL = 0x08;      // <level:16> Set brightness (0..VM_LEVEL_FULL).
+constexpr uint8_t OP_WAIT = 0x09;       // <millis:16> Show the current state for 'millis'.
+constexpr uint8_t OP_RAMP = 0x0A;       // <level:16> <millis:16> Show the current state while
+                                        // ramping brightness to 'level' over 'millis'.
+constexpr uint8_t OP_LOOP = 0x0B;       // <count:8> Run the block up to the matching OP_NEXT
+                                        // 'count' times (count >= 1).
+constexpr uint8_t OP_NEXT = 0x0C;       // End of an OP_LOOP block.
+
+// Program brightness levels are in units of 1 / VM_LEVEL_FULL; this is coarser than keyframe
+// levels, and is part of the bytecode format.
+constexpr unsigned int VM_LEVEL_SHIFT = 10;
+constexpr uint16_t VM_LEVEL_FULL = 1 << VM_LEVEL_SHIFT;
+
+/** Return the keyframe brightness level for a program brightness level. */
+constexpr uint16_t vmLevelToKeyframeLevel(uint16_t level) {
+  return level << (KF_LEVEL_SHIFT - VM_LEVEL_SHIFT);
+}
+
+/** Return the length in bytes of an instruction with the specified opcode, or 0 if it's invalid. */
+constexpr unsigned int effectOpSize(uint8_t opcode) {
+  switch (opcode) {
+  case OP_END:
+  case OP_SHOW_WORDS:
+  case OP_HIDE_WORDS:
+  case OP_PICK:
+  case OP_SHOW_PICK:
+  case OP_HIDE_PICK:
+  case OP_NEXT:
+    return 1;
+  case OP_LOOP:
+    return 2;
+  case OP_SHOW:
+  case OP_HIDE:
+  case OP_LEVEL:
+  case OP_WAIT:
+    return 3;
+  case OP_RAMP:
+    return 5;
+  default:
+    return 0;
+  }
+}
+
+/** Read the 16-bit operand that starts at 'operand'. */
+inline uint16_t effectOperand16(const uint8_t *operand) {
+  return operand[0] | (operand[1] << 8);
+}
+
+// Limits on the programs that verifyEffectProgram() accepts.
+constexpr unsigned int MAX_EFFECT_PROGRAM_SIZE = 256; // Bytes of code.
+constexpr unsigned int VM_MAX_LOOP_DEPTH = 4;
+constexpr uint32_t VM_MAX_DURATION_MILLIS = 5 * 60 * 1000;
+// Total instructions the program may execute from beginning to end. This bounds the time it
+// takes to verify a program.
+constexpr uint32_t VM_MAX_PROGRAM_STEPS = 100000;
+
+// verifyEffectProgram() return codes:
+constexpr int VERIFY_OK = 0;
+constexpr int VERIFY_BAD_SIZE = 1;       // Empty or longer than MAX_EFFECT_PROGRAM_SIZE.
+constexpr int VERIFY_BAD_OPCODE = 2;
+constexpr int VERIFY_TRUNCATED = 3;      // An operand runs past the end of the program.
+constexpr int VERIFY_BAD_OPERAND = 4;    // Mask outside the board, level > full, or 0 loop count.
+constexpr int VERIFY_BAD_LOOP = 5;       // Unbalanced OP_LOOP/OP_NEXT, or nested too deep.
+constexpr int VERIFY_NO_END = 6;         // The last instruction must be OP_END, and only it.
+constexpr int VERIFY_TOO_LONG = 7;       // Runs longer than VM_MAX_DURATION_MILLIS, or is empty.
+constexpr int VERIFY_TOO_MANY_STEPS = 8; // Exceeds VM_MAX_PROGRAM_STEPS.
+constexpr int VERIFY_OVER_BUDGET = 9;    // Too many instructions within a single frame.
+constexpr int INSTALL_WRITE_FAILED = 10; // installEffectProgram() could not save the program.
+
+/**
+ * A verified effect program.
+ */
+struct EffectProgram {
+  const uint8_t *code;
+  uint16_t size;
+  uint32_t duration; // Total millis of OP_WAIT and OP_RAMP time, as executed.
+};
+
+/**
+ * Check that the program is well-formed and that playing it never takes more than its share of
+ * a frame in the interpreter. On success, sets *durationOut to the program's running time.
+ */
+extern int verifyEffectProgram(const uint8_t *code, size_t size, uint32_t *durationOut);
+
+// Load the installed program from EEPROM, or fall back to the built-in program.
+extern void setupEffectProgram();
+// The program that EF_PROGRAM plays.
+extern const EffectProgram &getEffectProgram();
+// Verify the program, save it in EEPROM, and play it from now on. Returns VERIFY_OK, a
+// VERIFY_* error, or INSTALL_WRITE_FAILED.
+extern int installEffectProgram(const uint8_t *code, size_t size);
+
+// Accept programs sent over the USB serial port. Call from the admin mode loop.
+extern void pollEffectProgramLoader();
+
+#endif // _EFFECT_PROGRAM_H
@@ -0,0 +1,124 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Brightness fades computed from fade curve lookup tables.
+
+#include "like-the-art.h"
+
+static uint16_t gammaTable[FADE_TABLE_LEN];     // Perceived brightness -> duty cycle fraction.
+static uint16_t easeInOutTable[FADE_TABLE_LEN]; // Smoothstep: 3t^2 - 2t^3.
+static uint16_t customTable[FADE_TABLE_LEN];
+
+void setupFadeCurves() {
+  for (unsigned int i = 0; i < FADE_TABLE_LEN; i++) {
+    float t = (float)i / (float)(FADE_TABLE_LEN - 1);
+    gammaTable[i] = lroundf(powf(t, FADE_GAMMA_EXPONENT) * FADE_ONE);
+    easeInOutTable[i] = lroundf(t * t * (3.0f - 2.0f * t) * FADE_ONE);
+    customTable[i] = lroundf(t * FADE_ONE);
+  }
+}
+
+void setCustomFadeCurve(const uint16_t *table) {
+  for (unsigned int i = 0; i < FADE_TABLE_LEN; i++) {
+    customTable[i] = min((uint32_t)table[i], FADE_ONE);
+  }
+}
+
+/** Return the value of the curve at pos (0 to FADE_ONE), interpolated between table entries. */
+static inline int32_t lookupFadeCurve(const uint16_t *table, uint32_t pos) {
+  constexpr unsigned int SEGMENT_SHIFT = FADE_SHIFT - FADE_TABLE_SHIFT;
+  uint32_t i = pos >> SEGMENT_SHIFT;
+  if (i >= FADE_TABLE_LEN - 1) {
+    return table[FADE_TABLE_LEN - 1];
+  }
+
+  int32_t segmentPos = pos & ((1 << SEGMENT_SHIFT) - 1);
+  return table[i] + ((((int32_t)table[i + 1] - (int32_t)table[i]) * segmentPos) >> SEGMENT_SHIFT);
+}
+
+/**
+ * Return the perceived brightness (0 to FADE_ONE) of a duty cycle fraction. This inverts the
+ * gamma table by binary search, so that a fade that starts or ends at this brightness passes
+ * through exactly that level.
+ */
+static uint32_t perceivedBrightness(uint32_t dutyFraction) {
+  uint32_t lo = 0;
+  uint32_t hi = FADE_ONE;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) >> 1;
+    if ((uint32_t)lookupFadeCurve(gammaTable, mid) < dutyFraction) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+Fade::Fade() {
+  start(0, 0, 0, FADE_LINEAR);
+}
+
+void Fade::start(uint16_t fromLevel, uint16_t toLevel, uint32_t durationMillis, FadeCurve curve) {
+  _toLevel = toLevel;
+  _durationMillis = durationMillis;
+  _posPerMilli = (durationMillis == 0) ? 0 : (uint32_t)(((uint64_t)FADE_ONE << 16) / durationMillis);
+
+  switch (curve) {
+  case FADE_LINEAR:
+    _easeTable = nullptr;
+    _isGamma = false;
+    break;
+  case FADE_GAMMA:
+    _easeTable = nullptr;
+    _isGamma = true;
+    break;
+  case FADE_EASE_IN_OUT:
+    _easeTable = easeInOutTable;
+    _isGamma = true;
+    break;
+  case FADE_CUSTOM:
+    _easeTable = customTable;
+    _isGamma = false;
+    break;
+  default:
+    DBGPRINTU("*** WARNING: Unknown fade curve; fading linearly:", (unsigned int)curve);
+    _easeTable = nullptr;
+    _isGamma = false;
+    break;
+  }
+
+  uint32_t from = (uint32_t)fromLevel << (FADE_SHIFT - KF_LEVEL_SHIFT);
+  uint32_t to = (uint32_t)toLevel << (FADE_SHIFT - KF_LEVEL_SHIFT);
+  if (_isGamma) {
+    from = perceivedBrightness(from);
+    to = perceivedBrightness(to);
+  }
+
+  _from = from;
+  _span = (int32_t)to - (int32_t)from;
+}
+
+uint16_t Fade::levelAt(uint32_t millis) const {
+  if (millis >= _durationMillis) {
+    return _toLevel;
+  }
+
+  // millis < _durationMillis, so this is less than FADE_ONE << 16 and can't overflow.
+  return levelAtPosition((millis * _posPerMilli) >> 16);
+}
+
+uint16_t Fade::levelAtPosition(uint32_t pos) const {
+  int32_t progress = (_easeTable == nullptr) ? pos : lookupFadeCurve(_easeTable, pos);
+  int32_t x = _from + ((_span * progress) >> FADE_SHIFT);
+  if (_isGamma) {
+    x = lookupFadeCurve(gammaTable, x);
+  }
+
+  constexpr unsigned int LEVEL_SHIFT = FADE_SHIFT - KF_LEVEL_SHIFT;
+  if constexpr (LEVEL_SHIFT == 0) {
+    return x;
+  } else {
+    return (x + (1 << (LEVEL_SHIFT - 1))) >> LEVEL_SHIFT;
+  }
+}
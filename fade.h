@@ -0,0 +1,63 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Brightness fades: a ramp between two brightness levels that follows a fade curve. Curves
+// are fixed-point lookup tables computed at boot, so a fade in progress costs a few
+// multiplies and shifts per frame, and no division.
+
+#ifndef _FADE_H
+#define _FADE_H
+
+/** The shape of a fade over time. */
+enum FadeCurve: uint8_t {
+  FADE_LINEAR,      // Constant rate of change in PWM duty cycle.
+  FADE_GAMMA,       // Constant rate of change in perceived brightness (gamma 2.2).
+  FADE_EASE_IN_OUT, // Perceived brightness starts and ends the fade slowly.
+  FADE_CUSTOM,      // The table given to setCustomFadeCurve(), applied to the duty cycle.
+};
+
+constexpr unsigned int NUM_FADE_CURVES = 4;
+
+// Fade curves map a position (0 to FADE_ONE) to a fraction (0 to FADE_ONE) by linear
+// interpolation between FADE_TABLE_LEN evenly spaced points.
+constexpr unsigned int FADE_SHIFT = 15;
+constexpr uint32_t FADE_ONE = 1 << FADE_SHIFT;
+constexpr unsigned int FADE_TABLE_SHIFT = 6;
+constexpr unsigned int FADE_TABLE_LEN = (1 << FADE_TABLE_SHIFT) + 1;
+
+// Perceived brightness is (duty cycle) ^ (1 / FADE_GAMMA_EXPONENT).
+constexpr float FADE_GAMMA_EXPONENT = 2.2f;
+
+/**
+ * A fade from one brightness level (0 to KF_LEVEL_FULL) to another over a fixed time.
+ * start() does the setup arithmetic (including the one division); levelAt() is cheap enough to
+ * call every frame.
+ */
+class Fade {
+public:
+  Fade();
+
+  void start(uint16_t fromLevel, uint16_t toLevel, uint32_t durationMillis, FadeCurve curve);
+  // Return the brightness level 'millis' after the start of the fade.
+  uint16_t levelAt(uint32_t millis) const;
+  // Return the brightness level at a position (0 to FADE_ONE) through the fade.
+  uint16_t levelAtPosition(uint32_t pos) const;
+  uint16_t getTargetLevel() const { return _toLevel; };
+  bool isDone(uint32_t millis) const { return millis >= _durationMillis; };
+
+private:
+  const uint16_t *_easeTable; // Maps fade position to progress. nullptr: progress = position.
+  bool _isGamma;              // _from and _span are perceived brightness, not level.
+  int32_t _from;              // Start point, in units of 1 / FADE_ONE.
+  int32_t _span;              // End point minus start point, in units of 1 / FADE_ONE.
+  uint32_t _posPerMilli;      // Fade position per millisecond, in units of 1 / (FADE_ONE << 16).
+  uint32_t _durationMillis;
+  uint16_t _toLevel;
+};
+
+// Compute the fade curve lookup tables. Call once in setup() before any fade is started.
+extern void setupFadeCurves();
+// Replace the FADE_CUSTOM curve: FADE_TABLE_LEN values that rise from 0 to FADE_ONE.
+// (FADE_CUSTOM is FADE_LINEAR until this is called.)
+extern void setCustomFadeCurve(const uint16_t *table);
+
+#endif // _FADE_H
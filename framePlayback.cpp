@@ -0,0 +1,281 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Frame playback ring and timer.
+//
+// The main loop is the only producer of frames and the TC4 interrupt the only consumer. The
+// ring indexes run freely and are reduced mod FRAME_RING_LEN. The main loop disables
+// interrupts briefly while it changes the ring, because a frame committed within the same
+// tick as the previous one replaces it in place.
+//
+// A frame with a DMA ramp has the ramp's first blocks computed as it's queued, so the interrupt
+// only has to start the DMAC on them. Each frame in the ring, the frame being rendered and the
+// ramp being played each own one of the rampStarts, and hand them over by swapping pointers.
+//
+// The timer only ticks while there are frames to show; it stops when the ring runs dry and
+// starts again from zero when the next frame is queued, so that frame still comes
+// FRAME_LEAD_TICKS later. A frame that changes nothing isn't queued at all.
+
+#include "like-the-art.h"
+
+static_assert((FRAME_RING_LEN & (FRAME_RING_LEN - 1)) == 0, "Frame ring length must be a power of 2");
+
+static OutputFrame frameRing[FRAME_RING_LEN];
+static volatile unsigned int frameRingHead = 0; // Next frame to show.
+static volatile unsigned int frameRingTail = 0; // Where the next frame is queued.
+static volatile uint32_t playbackTick = 0;
+static bool isPlaybackRunning = false;
+static volatile bool isPlaybackTicking = false; // TC4 is running.
+static bool isFlushed = false; // Show the next frame as soon as it's committed.
+
+// The frame being rendered.
+static OutputFrame renderFrame = {};
+
+// The first blocks of each DMA ramp: of the frame in each ring slot, of the frame being
+// rendered, and of the ramp being played, which the DMAC may still be reading.
+static PwmRampStart rampStarts[FRAME_RING_LEN + 2];
+static PwmRampStart *frameRampStarts[FRAME_RING_LEN];
+static PwmRampStart *renderRampStart = &rampStarts[FRAME_RING_LEN];
+static PwmRampStart *playingRampStart = &rampStarts[FRAME_RING_LEN + 1];
+
+// The sign bank bytes of the latest frame shown by the interrupt, until the main loop writes them.
+static volatile uint32_t playedBankBits = 0;
+static volatile bool isPlayedFrameUnwritten = false;
+
+// The sign bank bytes of the latest frame shown, by the interrupt or right away.
+static volatile uint32_t shownBankBits = 0;
+
+void setupFramePlayback() {
+  for (unsigned int i = 0; i < FRAME_RING_LEN; i++) {
+    frameRampStarts[i] = &rampStarts[i];
+  }
+
+  isPlaybackRunning = true;
+  int ret = setupPeriodicTc(TC4, LOOP_MICROS, 3);
+  if (ret != PERIODIC_TC_SUCCESS) {
+    DBGPRINTI("*** ERROR: Could not set up frame playback timer:", ret);
+    isPlaybackRunning = false;
+    return;
+  }
+  stopPeriodicTc(TC4); // Until there's a frame to show.
+}
+
+void setFrameDutyCycle(unsigned int zone, uint32_t dutyCycle) {
+  renderFrame.dutyCycle[zone] = dutyCycle;
+  renderFrame.dutyCycleZones |= 1 << zone;
+  if (zone == 0) {
+    renderFrame.flags &= ~OUTPUT_FRAME_DMA_RAMP;
+  }
+}
+
+void setFrameDmaRamp(const DmaRamp &ramp) {
+  renderFrame.dmaRamp = ramp;
+  renderFrame.dutyCycleZones &= ~1;
+  renderFrame.flags |= OUTPUT_FRAME_DMA_RAMP;
+}
+
+void setFrameSubFrameFlicker(const SubFrameFlickerPlan &plan) {
+  renderFrame.flickerPlan = plan;
+  renderFrame.flags |= OUTPUT_FRAME_SUBFRAME_FLICKER;
+}
+
+// The flicker plan a frame arms the interrupt with, or NULL to disarm it.
+static inline const SubFrameFlickerPlan *frameFlickerPlan(const OutputFrame &frame) {
+  return (frame.flags & OUTPUT_FRAME_SUBFRAME_FLICKER) ? &frame.flickerPlan : NULL;
+}
+
+// The DMA ramp being played, which the DMAC interrupt computes each block of the ramp from.
+static DmaRamp playingDmaRamp;
+
+/** Compute duty cycle counts for a block of the ramp in 'context' (a DmaRamp). */
+static void fillDmaRamp(uint32_t *counts, uint32_t index, uint16_t numCounts, void *context) {
+  const DmaRamp &ramp = *(const DmaRamp *)context;
+  for (uint32_t i = 0; i < numCounts; i++) {
+    // Each value applies from the start of the following PWM period.
+    uint64_t period = ramp.firstPeriod + index + i + 1;
+    uint32_t pos = (period << FADE_SHIFT) / ramp.rampPeriods;
+    uint32_t dutyCycle = ((uint64_t)ramp.maxDutyCycle * ramp.fade.levelAtPosition(pos))
+        >> KF_LEVEL_SHIFT;
+    counts[i] = pwmZoneTimers[0]->dutyCycleToCount(dutyCycle);
+  }
+}
+
+// Compute the first blocks of the frame being rendered's DMA ramp.
+static void prepareRenderDmaRamp() {
+  const DmaRamp &ramp = renderFrame.dmaRamp;
+  pwmZoneTimers[0]->prepareDmaRamp(*renderRampStart, ramp.rampPeriods - ramp.firstPeriod,
+      fillDmaRamp, (void *)&ramp);
+}
+
+/**
+ * Apply the PWM settings of a frame as it's shown. If it has a DMA ramp, 'rampStart' holds its
+ * first blocks, and is swapped with playingRampStart as the ramp starts. Takes constant time;
+ * the rest of the ramp is computed from the DMAC interrupt.
+ */
+static void showFramePwm(const OutputFrame &frame, PwmRampStart *&rampStart) {
+  if (frame.flags & OUTPUT_FRAME_DMA_RAMP) {
+    pwmZoneTimers[0]->stopDmaRamp(); // Before its ramp, and the blocks it's playing, are replaced.
+    playingDmaRamp = frame.dmaRamp;
+    PwmRampStart *start = rampStart;
+    rampStart = playingRampStart;
+    playingRampStart = start;
+    pwmZoneTimers[0]->startDmaRamp(*start, fillDmaRamp, &playingDmaRamp, NULL);
+  }
+  for (unsigned int zone = 0; zone < NUM_PWM_ZONES; zone++) {
+    PwmTimer *zoneTimer = pwmZoneTimers[zone];
+    if ((frame.dutyCycleZones & (1 << zone)) && zoneTimer->getDutyCycle() != frame.dutyCycle[zone]) {
+      zoneTimer->setDutyCycleBuffered(frame.dutyCycle[zone]);
+    }
+  }
+  setSubFrameFlicker(frameFlickerPlan(frame));
+}
+
+// Hand the frame being rendered's ramp start to a ring slot, in exchange for the slot's old one.
+static inline void swapRampStart(PwmRampStart *&slotRampStart) {
+  PwmRampStart *start = slotRampStart;
+  slotRampStart = renderRampStart;
+  renderRampStart = start;
+}
+
+/**
+ * True if showing the frame being rendered would change nothing: nothing is waiting to be
+ * shown, and it leaves the signs, the PWM and the flicker interrupt as the last frame did.
+ * Call with interrupts disabled.
+ */
+static bool isRenderFrameUnchanged() {
+  if (frameRingHead != frameRingTail || renderFrame.bankBits != shownBankBits
+      || (renderFrame.flags & OUTPUT_FRAME_DMA_RAMP)
+      || !isSubFrameFlickerArmedWith(frameFlickerPlan(renderFrame))) {
+    return false;
+  }
+
+  for (unsigned int zone = 0; zone < NUM_PWM_ZONES; zone++) {
+    PwmTimer *zoneTimer = pwmZoneTimers[zone];
+    if ((renderFrame.dutyCycleZones & (1 << zone))
+        && (zoneTimer->getDutyCycle() != renderFrame.dutyCycle[zone]
+            || zoneTimer->isDmaRampActive())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void queueOutputFrame(uint32_t bankBits) {
+  renderFrame.bankBits = bankBits;
+  if (renderFrame.flags & OUTPUT_FRAME_DMA_RAMP) {
+    prepareRenderDmaRamp(); // Here, rather than in the interrupt.
+  }
+
+  if (!isPlaybackRunning || isFlushed) {
+    // Show it now. (The ring is empty, so the interrupt won't touch the PWM meanwhile.) A frame
+    // the interrupt played that the loop hasn't written yet is older than this one; drop it, so
+    // showPlayedFrameSigns() doesn't put it back on the signs.
+    isFlushed = false;
+    noInterrupts();
+    isPlayedFrameUnwritten = false;
+    interrupts();
+    showFramePwm(renderFrame, renderRampStart);
+    shownBankBits = bankBits;
+    signBoard.showBankBits(bankBits);
+  } else {
+    noInterrupts();
+    if (!isRenderFrameUnchanged()) { // (If it is, it's not worth waking the timer for.)
+      uint32_t tick = playbackTick + FRAME_LEAD_TICKS;
+      unsigned int numQueued = frameRingTail - frameRingHead;
+      OutputFrame *prev = numQueued ? &frameRing[(frameRingTail - 1) % FRAME_RING_LEN] : NULL;
+      if (prev != NULL && (prev->tick == tick || numQueued == FRAME_RING_LEN)) {
+        // Replace the frame committed earlier in this tick. Its PWM changes still happen, unless
+        // this frame makes its own for the same zone. (Zone duty cycles it set are still the
+        // latest ones in renderFrame.) A DMA ramp of its own replaces prev's, first blocks and all.
+        uint8_t prevZones = prev->dutyCycleZones;
+        if ((prev->flags & OUTPUT_FRAME_DMA_RAMP)
+            && !(renderFrame.flags & OUTPUT_FRAME_DMA_RAMP) && !(renderFrame.dutyCycleZones & 1)) {
+          renderFrame.flags |= OUTPUT_FRAME_DMA_RAMP;
+          renderFrame.dmaRamp = prev->dmaRamp;
+        } else if (renderFrame.flags & OUTPUT_FRAME_DMA_RAMP) {
+          swapRampStart(frameRampStarts[(frameRingTail - 1) % FRAME_RING_LEN]);
+        }
+        if (renderFrame.flags & OUTPUT_FRAME_DMA_RAMP) {
+          prevZones &= ~1;
+        }
+        renderFrame.dutyCycleZones |= prevZones;
+        *prev = renderFrame;
+        prev->tick = tick;
+      } else {
+        OutputFrame &frame = frameRing[frameRingTail % FRAME_RING_LEN];
+        if (renderFrame.flags & OUTPUT_FRAME_DMA_RAMP) {
+          swapRampStart(frameRampStarts[frameRingTail % FRAME_RING_LEN]);
+        }
+        frame = renderFrame;
+        frame.tick = tick;
+        frameRingTail = frameRingTail + 1;
+      }
+      if (!isPlaybackTicking) {
+        restartPeriodicTc(TC4); // The first tick is a full period from now.
+        isPlaybackTicking = true;
+      }
+    }
+    interrupts();
+  }
+
+  // The next frame leaves the PWM as it is, and is disarmed, unless it's told otherwise.
+  renderFrame.dutyCycleZones = 0;
+  renderFrame.flags = 0;
+}
+
+void flushOutputFrames() {
+  if (!isPlaybackRunning) {
+    return;
+  }
+
+  noInterrupts();
+  frameRingTail = frameRingHead;
+  isPlayedFrameUnwritten = false; // It's been overtaken, too.
+  isFlushed = true;
+  interrupts();
+}
+
+void showPlayedFrameSigns() {
+  if (!isPlayedFrameUnwritten) {
+    return;
+  }
+
+  noInterrupts();
+  uint32_t bankBits = playedBankBits;
+  isPlayedFrameUnwritten = false;
+  interrupts();
+
+  signBoard.showBankBits(bankBits);
+}
+
+// Playback tick: show the frames that are due. If the loop fell behind, more than one may be
+// due; their PWM changes are applied in order and the signs show the latest.
+extern "C" void TC4_Handler() {
+  TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+
+  uint32_t tick = playbackTick + 1;
+  playbackTick = tick;
+
+  unsigned int head = frameRingHead;
+  bool isShown = false;
+  uint32_t bankBits = 0;
+  while (head != frameRingTail && (int32_t)(frameRing[head % FRAME_RING_LEN].tick - tick) <= 0) {
+    const OutputFrame &frame = frameRing[head % FRAME_RING_LEN];
+    showFramePwm(frame, frameRampStarts[head % FRAME_RING_LEN]);
+    bankBits = frame.bankBits;
+    isShown = true;
+    head++;
+  }
+  frameRingHead = head;
+
+  if (isShown) {
+    playedBankBits = bankBits;
+    shownBankBits = bankBits;
+    isPlayedFrameUnwritten = true;
+  }
+
+  if (head == frameRingTail) {
+    // Nothing more to show; sleep until there is.
+    stopPeriodicTc(TC4);
+    isPlaybackTicking = false;
+  }
+}
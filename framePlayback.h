@@ -0,0 +1,83 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Frame playback: each frame the main loop renders is queued in a small ring, and a timer
+// interrupt shows one frame every LOOP_MICROS, a fixed number of ticks after it was rendered.
+// What the signs show then keeps time with the timer, not with wherever in loop() the frame
+// happened to be committed.
+
+#ifndef _FRAME_PLAYBACK_H
+#define _FRAME_PLAYBACK_H
+
+// A frame is shown this many playback ticks after the tick in which it was committed.
+constexpr unsigned int FRAME_LEAD_TICKS = 2;
+
+// Number of frames the ring holds. Frames committed within the same tick replace each other,
+// so at most FRAME_LEAD_TICKS frames are waiting at a time.
+constexpr unsigned int FRAME_RING_LEN = 4;
+static_assert(FRAME_RING_LEN > FRAME_LEAD_TICKS, "Frame ring must hold every frame in flight");
+
+// OutputFrame::flags
+constexpr uint8_t OUTPUT_FRAME_DMA_RAMP = 0x1; // Start a DMA ramp on the PWM of zone 0.
+constexpr uint8_t OUTPUT_FRAME_SUBFRAME_FLICKER = 0x2; // Arm the flicker interrupt with flickerPlan.
+
+/**
+ * A brightness ramp for the PWM of zone 0 to follow by DMA, one duty cycle per PWM period: the
+ * fade from 'firstPeriod' (of 'rampPeriods') to its end, scaled to 'maxDutyCycle'. Frames hold
+ * their own copy; the one being played is copied again for the DMAC interrupt to compute it from.
+ */
+struct DmaRamp {
+  Fade fade;
+  uint32_t maxDutyCycle;
+  uint32_t rampPeriods;
+  uint32_t firstPeriod;
+};
+
+/**
+ * Everything the sign shows in one frame: the sign bank output, and what happens to the PWM of
+ * each zone. Unless a frame says otherwise, a zone's PWM carries on as it was.
+ */
+struct OutputFrame {
+  uint32_t tick;      // Playback tick at which the frame is shown.
+  uint32_t bankBits;  // Sign bank bytes (bank 0 in the low byte).
+  uint32_t dutyCycle[NUM_PWM_ZONES]; // Of each zone in dutyCycleZones.
+  DmaRamp dmaRamp; // If OUTPUT_FRAME_DMA_RAMP.
+  uint8_t dutyCycleZones; // Bit n set: set the duty cycle of zone n.
+  uint8_t flags; // OUTPUT_FRAME_*
+  SubFrameFlickerPlan flickerPlan; // If OUTPUT_FRAME_SUBFRAME_FLICKER; else disarmed.
+};
+
+/**
+ * Start the playback timer (TC4). Until then, each frame is shown as soon as it's committed.
+ * Requires the PWM and the sign board to be set up.
+ */
+void setupFramePlayback();
+
+// Set the PWM part of the frame being rendered, per zone. The last call before the frame is
+// committed wins; a DMA ramp takes over zone 0's PWM until a later frame sets its duty cycle.
+void setFrameDutyCycle(unsigned int zone, uint32_t dutyCycle);
+void setFrameDmaRamp(const DmaRamp &ramp);
+// Arm the sub-frame flicker interrupt with (a copy of) 'plan' for this frame. Frames are
+// disarmed unless this is called for them.
+void setFrameSubFrameFlicker(const SubFrameFlickerPlan &plan);
+
+/**
+ * Queue the frame being rendered, with the specified sign bank bytes, to be shown
+ * FRAME_LEAD_TICKS from now. Called by SignBoard::commitFrame().
+ */
+void queueOutputFrame(uint32_t bankBits);
+
+/**
+ * Discard the frames waiting to be shown, e.g. because a button started a new animation. The
+ * next frame is shown as soon as it's committed, so the response isn't delayed; the frames
+ * after it catch up to the usual lead.
+ */
+void flushOutputFrames();
+
+/**
+ * The playback interrupt applies each frame's PWM settings itself, but the sign banks are on
+ * the I2C bus, which only the main loop may use. Write the banks for the latest frame shown
+ * by the interrupt, if that hasn't been done yet. Call this as soon as the loop wakes.
+ */
+void showPlayedFrameSigns();
+
+#endif // _FRAME_PLAYBACK_H
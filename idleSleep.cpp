@@ -0,0 +1,77 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Tickless idle.
+//
+// The Arduino core counts millis() in the SysTick interrupt, once a millisecond; micros() adds
+// the SysTick's count within the millisecond. While asleep, the SysTick keeps counting but its
+// interrupt is masked. On waking, the count of milliseconds that passed is made up from the time
+// the sleep timer ran, to the nearest millisecond, and the SysTick's exact count within the
+// millisecond before and after: the two only have to agree to within half a millisecond. Then
+// millis() is caught up by running the core's SysTick handler once for each of them.
+
+#include "like-the-art.h"
+
+// The Arduino core's SysTick handler body: counts one millisecond.
+extern "C" void SysTick_DefaultHandler(void);
+
+static Tc *const SLEEP_TC = TC5;
+static bool isSleepTimerSetUp = false;
+
+void setupIdleSleep() {
+  int ret = setupOneShotTc(SLEEP_TC, 3);
+  if (ret != PERIODIC_TC_SUCCESS) {
+    DBGPRINTI("*** ERROR: Could not set up sleep timer:", ret);
+    return;
+  }
+  isSleepTimerSetUp = true;
+}
+
+static inline bool isSysTickPending() {
+  return (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+}
+
+void idleSleep(uint32_t maxMicros) {
+  if (!isSleepTimerSetUp) {
+    __WFI();
+    return;
+  }
+
+  uint32_t cyclesPerTick = SysTick->LOAD + 1; // One millisecond.
+  unsigned int ticks = 0;
+
+  __disable_irq();
+  // Mask the SysTick interrupt. The SysTick counts down and wraps around each millisecond: if
+  // the count is near the top, a pending millisecond ended before the count was read;
+  // near zero, after, and then it's among those counted below.
+  uint32_t startVal = SysTick->VAL;
+  SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+  if (isSysTickPending()) {
+    SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+    ticks += startVal >= cyclesPerTick / 2;
+  }
+
+  startOneShotTc(SLEEP_TC, maxMicros);
+  __DSB();
+  __WFI(); // Wakes on any pending interrupt, even though they're disabled.
+  uint32_t sleptMicros = stopOneShotTc(SLEEP_TC);
+
+  // Unmask the SysTick interrupt. Milliseconds that end from here on are counted by it, except
+  // one that's pending before the count is read, which is also among those counted below.
+  SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+  uint32_t endVal = SysTick->VAL;
+  if (isSysTickPending() && endVal >= cyclesPerTick / 2) {
+    SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+  }
+
+  // The milliseconds that ended from startVal to endVal: the sleep timer's count of them, made
+  // exact by the SysTick. (It runs at cyclesPerTick / 1000 per micro.)
+  int64_t tickCycles = (int64_t)sleptMicros * (cyclesPerTick / 1000)
+      - ((int64_t)startVal - (int64_t)endVal);
+  if (tickCycles > 0) {
+    ticks += (tickCycles + cyclesPerTick / 2) / cyclesPerTick;
+  }
+  for (unsigned int i = 0; i < ticks; i++) {
+    SysTick_DefaultHandler();
+  }
+  __enable_irq();
+}
@@ -0,0 +1,20 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Tickless idle: the main loop sleeps without being woken by the 1ms SysTick interrupt. A
+// one-shot timer (TC5) wakes the CPU at the deadline instead, and millis() catches up on the
+// SysTick interrupts it skipped.
+
+#ifndef _IDLE_SLEEP_H
+#define _IDLE_SLEEP_H
+
+// Set up the sleep timer (TC5). Until then, idleSleep() is woken by every SysTick interrupt.
+void setupIdleSleep();
+
+/**
+ * Idle the CPU until the next interrupt, or for at most 'maxMicros'. Interrupts that came due
+ * meanwhile have run when it returns. A sleep longer than the timer can run
+ * (ONE_SHOT_TC_MAX_MICROS) ends early; the caller checks whether its deadline has come.
+ */
+void idleSleep(uint32_t maxMicros);
+
+#endif // _IDLE_SLEEP_H
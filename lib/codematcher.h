@@ -0,0 +1,128 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// codematcher -- Recognize any of a set of key codes in a stream of key presses, one step per
+// press, with an Aho-Corasick automaton built at compile time.
+
+#ifndef _CODE_MATCHER_H
+#define _CODE_MATCHER_H
+
+#include<array>
+#include<stddef.h>
+#include<stdint.h>
+
+/**
+ * A code of up to MAX_LEN keys, each in [0, NUM_KEYS) of the CodeMatcher it's built into.
+ * 'id' is what the matcher reports when the code is entered.
+ */
+template<unsigned int MAX_LEN>
+struct KeyCode {
+  uint8_t id;
+  uint8_t length;
+  uint8_t keys[MAX_LEN];
+};
+
+/**
+ * The number of matcher states that 'codes' need: one per distinct prefix of the codes (the
+ * nodes of their trie), plus the start. Codes that begin alike share states.
+ */
+template<unsigned int MAX_LEN, size_t NUM_CODES>
+constexpr unsigned int codeMatcherStates(const std::array<KeyCode<MAX_LEN>, NUM_CODES> &codes) {
+  unsigned int numStates = 1;
+  for (size_t i = 0; i < NUM_CODES; i++) {
+    // The first 'shared' keys of this code are a prefix of an earlier one, and have states.
+    unsigned int shared = 0;
+    for (size_t j = 0; j < i; j++) {
+      unsigned int k = 0;
+      while (k < codes[i].length && k < codes[j].length && codes[i].keys[k] == codes[j].keys[k]) {
+        k++;
+      }
+      shared = (k > shared) ? k : shared;
+    }
+    numStates += codes[i].length - shared;
+  }
+  return numStates;
+}
+
+/**
+ * The compiled automaton: a transition for every state and key, so each key press is one table
+ * lookup. A state is the longest tail of the presses so far that begins some code; a wrong key
+ * moves to the longest tail that still does, rather than back to the start.
+ *
+ * Build one with makeCodeMatcher(); as a constexpr it lives in flash.
+ */
+template<unsigned int NUM_KEYS, unsigned int NUM_STATES>
+struct CodeMatcher {
+  static_assert(NUM_STATES <= 256, "CodeMatcher states must fit in a uint8_t");
+
+  static constexpr uint8_t START_STATE = 0;
+  static constexpr uint8_t NO_MATCH = 0xFF;
+
+  uint8_t next[NUM_STATES][NUM_KEYS];
+  // The id of the code entered on reaching each state, or NO_MATCH. If one code ends with
+  // another, the longer one is reported.
+  uint8_t match[NUM_STATES];
+
+  /** The state after pressing 'key' in 'state'. Keys out of range start over. */
+  constexpr uint8_t step(uint8_t state, uint8_t key) const {
+    return key < NUM_KEYS ? next[state][key] : START_STATE;
+  };
+};
+
+/**
+ * Build the CodeMatcher for 'codes'. Evaluate it as a constexpr: then a key out of range is a
+ * compile error. (Size NUM_STATES with codeMatcherStates(codes).)
+ */
+template<unsigned int NUM_KEYS, unsigned int NUM_STATES, unsigned int MAX_LEN, size_t NUM_CODES>
+constexpr CodeMatcher<NUM_KEYS, NUM_STATES> makeCodeMatcher(
+    const std::array<KeyCode<MAX_LEN>, NUM_CODES> &codes) {
+
+  typedef CodeMatcher<NUM_KEYS, NUM_STATES> Matcher;
+  Matcher matcher{};
+  for (unsigned int s = 0; s < NUM_STATES; s++) {
+    matcher.match[s] = Matcher::NO_MATCH;
+  }
+
+  // Build the trie of the codes. Nothing leads back to the start state, so a 0 in 'next' is
+  // a missing branch.
+  unsigned int numStates = 1;
+  for (size_t i = 0; i < NUM_CODES; i++) {
+    unsigned int s = Matcher::START_STATE;
+    for (unsigned int k = 0; k < codes[i].length; k++) {
+      uint8_t key = codes[i].keys[k];
+      if (matcher.next[s][key] == 0) {
+        matcher.next[s][key] = numStates++;
+      }
+      s = matcher.next[s][key];
+    }
+    matcher.match[s] = codes[i].id;
+  }
+
+  // Visit the states breadth-first, so each state's fallback (the state of its longest proper
+  // tail) is complete before the state. Fill each missing branch with the fallback's branch.
+  uint8_t fallback[NUM_STATES] = {};
+  uint8_t queue[NUM_STATES] = {};
+  unsigned int queueHead = 0;
+  unsigned int queueTail = 0;
+  queue[queueTail++] = Matcher::START_STATE;
+  while (queueHead < queueTail) {
+    uint8_t s = queue[queueHead++];
+    if (matcher.match[s] == Matcher::NO_MATCH) {
+      matcher.match[s] = matcher.match[fallback[s]]; // A shorter code may end here.
+    }
+
+    for (unsigned int key = 0; key < NUM_KEYS; key++) {
+      uint8_t child = matcher.next[s][key];
+      uint8_t fallbackNext = (s == Matcher::START_STATE) ? 0 : matcher.next[fallback[s]][key];
+      if (child != 0) {
+        fallback[child] = fallbackNext;
+        queue[queueTail++] = child;
+      } else {
+        matcher.next[s][key] = fallbackNext;
+      }
+    }
+  }
+
+  return matcher;
+}
+
+#endif /* _CODE_MATCHER_H */
@@ -55,10 +55,46 @@ PwmTimer::PwmTimer(uint32_t portGroup, uint32_t portPin, uint32_t portFn, Tcc* c
     uint32_t pwmChannel, uint32_t pwmFreq, uint32_t pwmPrescaler):
     _portGroup(portGroup), _portPin(portPin), _portPinBit((uint32_t)(1 << portPin)),
     _portFn(portFn),
-    _pwmChannel(pwmChannel), _pwmFreq(pwmFreq), _pwmPrescaler(pwmPrescaler),
+    _pwmChannel(pwmChannel), _pwmFreq(pwmFreq),
+    _clockSource(PwmClockSource::DFLL_48MHZ), _pwmPrescaler(pwmPrescaler),
+    _ditherBits(PWM_DITHER_NONE),
     _pwmClockHz(TCC_PLL_FREQ / pwmPrescaler),
     _pwmWaveCount((_pwmClockHz / pwmFreq) - 1),
-    _dutyCycle(pwmFreq / 2),
+    _dutyCycleRange(pwmFreq),
+    _countPerDutyCycle((((uint64_t)_pwmWaveCount + 1) << 16) / _dutyCycleRange),
+    _dutyCycle(_dutyCycleRange / 2),
+    _isDmaRampActive(false),
+    _onRampEnd(NULL),
+    _rampFill(NULL),
+    _rampContext(NULL),
+    _rampLength(0),
+    _rampFilled(0),
+    _rampPlayed(0),
+    _rampBlock(0),
+    _TCC(tcc)
+    {
+}
+
+PwmTimer::PwmTimer(uint32_t portGroup, uint32_t portPin, uint32_t portFn, Tcc* const tcc,
+    uint32_t pwmChannel, uint32_t pwmFreq, const PwmClockConfig &clockConfig):
+    _portGroup(portGroup), _portPin(portPin), _portPinBit((uint32_t)(1 << portPin)),
+    _portFn(portFn),
+    _pwmChannel(pwmChannel), _pwmFreq(pwmFreq),
+    _clockSource(clockConfig.clockSource), _pwmPrescaler(clockConfig.prescaler),
+    _ditherBits(clockConfig.ditherBits),
+    _pwmClockHz(pwmClockSourceHz(clockConfig.clockSource) / clockConfig.prescaler),
+    _pwmWaveCount((_pwmClockHz / pwmFreq) - 1),
+    _dutyCycleRange((_pwmWaveCount + 1) << _ditherBits), // One step per compare value.
+    _countPerDutyCycle(1 << 16),
+    _dutyCycle(_dutyCycleRange / 2),
+    _isDmaRampActive(false),
+    _onRampEnd(NULL),
+    _rampFill(NULL),
+    _rampContext(NULL),
+    _rampLength(0),
+    _rampFilled(0),
+    _rampPlayed(0),
+    _rampBlock(0),
     _TCC(tcc)
     {
 }
@@ -83,24 +119,30 @@ void PwmTimer::disable() {
   while (_TCC->SYNCBUSY.bit.ENABLE);       // Wait for synchronization
 }
 
+/**
+ * Convert dutyCycle (between [0, _dutyCycleRange]) to dutyCount -- the actual counter value at
+ * which we switch over. The output is high while the counter is below dutyCount, so 0 is always
+ * off and a count past the end of the period (_pwmWaveCount + 1) is always on. With dithering,
+ * the low _ditherBits of dutyCount are the number of periods in each dither cycle that run one
+ * count longer.
+ */
+uint32_t PwmTimer::dutyCycleToCount(uint32_t dutyCycle) const {
+  return ((uint64_t)dutyCycle * _countPerDutyCycle + (1 << 15)) >> 16;
+}
+
 int PwmTimer::setDutyCycle(unsigned int dutyCycle) {
   if (!isValid()) {
     return ERR_INVALID_PWM;
   }
 
-  // dutyCycle must vary between [0, pwmFreq].
-  // Convert that to dutyCount -- the actual counter value at which we switch over.
-  unsigned int dutyCount;
-  if (dutyCycle > _pwmFreq) {
+  if (dutyCycle > _dutyCycleRange) {
     return ERR_DUTY_CYCLE_TOO_LONG;
-  } else if (dutyCycle == _pwmFreq) {
-    dutyCount = _pwmWaveCount;
-  } else {
-    dutyCount = (((_pwmWaveCount + 1) * dutyCycle) / _pwmFreq) - 1;
   }
 
+  stopDmaRamp();
+
   // Set up the CC (counter compare), channel N register for the selected duty cycle.
-  _TCC->CC[_pwmChannel].reg = dutyCount;
+  _TCC->CC[_pwmChannel].reg = dutyCycleToCount(dutyCycle);
   while (_TCC->SYNCBUSY.reg & (1 << (_pwmChannel + 8)));          // Wait for synchronization
 
   _dutyCycle = dutyCycle;
@@ -108,13 +150,267 @@ int PwmTimer::setDutyCycle(unsigned int dutyCycle) {
   return ERR_SUCCESS;
 }
 
+int PwmTimer::setDutyCycleBuffered(unsigned int dutyCycle) {
+  if (!isValid()) {
+    return ERR_INVALID_PWM;
+  }
+
+  if (dutyCycle > _dutyCycleRange) {
+    return ERR_DUTY_CYCLE_TOO_LONG;
+  }
+
+  stopDmaRamp();
+
+  // The TCC copies CCBUF into CC at the end of the current period, so the period in progress is
+  // never cut short or stretched. CCBUF is not write-synchronized; there's nothing to wait for.
+  _TCC->CCBUF[_pwmChannel].reg = dutyCycleToCount(dutyCycle);
+
+  _dutyCycle = dutyCycle;
+
+  return ERR_SUCCESS;
+}
+
+bool PwmTimer::isUpdatePending() const {
+  if (!isValid()) {
+    return false;
+  }
+
+  // STATUS.CCBUFVn is set while CCBUF[n] holds a value not yet copied into CC[n].
+  return (_TCC->STATUS.reg & (TCC_STATUS_CCBUFV0 << _pwmChannel)) != 0;
+}
+
+// DMAC descriptors for channels 0..PWM_DMA_CHANNEL, and their write-back area, if the DMAC
+// isn't already set up when the first ramp starts.
+static DmacDescriptor dmaDescriptors[PWM_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor dmaWriteback[PWM_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static bool isDmacSetup = false;
+
+// A ramp alternates between two blocks, each with a buffer and a descriptor. The first block's
+// descriptor is the channel's, in the DMAC's descriptor memory; the second is linked from it,
+// and links back to it while the ramp has more to play.
+static DmacDescriptor dmaRampSecondDescriptor __attribute__((aligned(16)));
+static DmacDescriptor *dmaRampDescriptors[2] = { NULL, &dmaRampSecondDescriptor };
+static uint32_t dmaRampBlocks[2][PWM_DMA_BLOCK_LEN];
+static uint16_t dmaRampBlockLen[2];
+
+// The timer whose ramp is on PWM_DMA_CHANNEL.
+static PwmTimer *volatile dmaRampTimer = NULL;
+
+void PwmTimer::_setupDmac() {
+  if (isDmacSetup) {
+    return;
+  }
+
+  // Don't reset the DMAC: another library may have set it up, and be using other channels.
+  // The descriptor memory can only be set while the DMAC is disabled.
+  MCLK->AHBMASK.reg |= MCLK_AHBMASK_DMAC;
+  if (!(DMAC->CTRL.reg & DMAC_CTRL_DMAENABLE)) {
+    DMAC->BASEADDR.reg = (uintptr_t)dmaDescriptors;
+    DMAC->WRBADDR.reg = (uintptr_t)dmaWriteback;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF); // Enable all priority levels.
+  }
+  dmaRampDescriptors[0] = (DmacDescriptor *)DMAC->BASEADDR.reg + PWM_DMA_CHANNEL;
+
+  NVIC_SetPriority(DMAC_0_IRQn, 3);
+  NVIC_EnableIRQ(DMAC_0_IRQn);
+  isDmacSetup = true;
+}
+
+/**
+ * Compute the next values of the ramp into a block, and set up its descriptor. Returns false if
+ * there are none left.
+ */
+bool PwmTimer::_fillDmaRampBlock(unsigned int block) {
+  uint32_t remaining = _rampLength - _rampFilled;
+  if (remaining == 0) {
+    return false;
+  }
+
+  uint16_t numCounts = min(remaining, (uint32_t)PWM_DMA_BLOCK_LEN);
+  _rampFill(dmaRampBlocks[block], _rampFilled, numCounts, _rampContext);
+  _setDmaRampBlock(block, dmaRampBlocks[block], numCounts);
+  return true;
+}
+
+/** Set up a block's descriptor to play the next 'numCounts' values of the ramp from 'counts'. */
+void PwmTimer::_setDmaRampBlock(unsigned int block, const uint32_t *counts, uint16_t numCounts) {
+  _rampFilled += numCounts;
+  dmaRampBlockLen[block] = numCounts;
+
+  // One word per trigger (TCC overflow, i.e. the end of each PWM period) from the buffer into
+  // CCBUF; the TCC applies it at the start of the next period. Interrupt at the end of the block,
+  // to refill it. The DMAC reads the descriptor when the other block ends, so whether it links
+  // back to the other block has to be known now.
+  DmacDescriptor &desc = *dmaRampDescriptors[block];
+  desc.BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_WORD | DMAC_BTCTRL_SRCINC |
+      DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_EVOSEL_DISABLE;
+  desc.BTCNT.reg = numCounts;
+  desc.SRCADDR.reg = (uintptr_t)(counts + numCounts); // With SRCINC, the end.
+  desc.DSTADDR.reg = (uintptr_t)&_TCC->CCBUF[_pwmChannel].reg;
+  desc.DESCADDR.reg = (_rampFilled < _rampLength) ? (uintptr_t)dmaRampDescriptors[block ^ 1] : 0;
+}
+
+// Stop any ramp in progress, and start over with a new one, none of it computed yet.
+void PwmTimer::_resetDmaRamp(uint32_t numCounts, PwmRampFillFn fill, void *context) {
+  if (dmaRampTimer != NULL) {
+    dmaRampTimer->stopDmaRamp();
+  }
+  _setupDmac();
+
+  _rampFill = fill;
+  _rampContext = context;
+  _rampLength = numCounts;
+  _rampFilled = 0;
+  _rampPlayed = 0;
+  _rampBlock = 0;
+}
+
+// Start the DMAC on the ramp's first block, once both blocks are set up.
+void PwmTimer::_enableDmaRamp(void (*onRampEnd)()) {
+  unsigned int trigSrc = TCC0_DMAC_ID_OVF;
+  if (_TCC == TCC1) {
+    trigSrc = TCC1_DMAC_ID_OVF;
+  } else if (_TCC == TCC2) {
+    trigSrc = TCC2_DMAC_ID_OVF;
+  } else if (_TCC == TCC3) {
+    trigSrc = TCC3_DMAC_ID_OVF;
+  } else if (_TCC == TCC4) {
+    trigSrc = TCC4_DMAC_ID_OVF;
+  }
+
+  DmacChannel &channel = DMAC->Channel[PWM_DMA_CHANNEL];
+  channel.CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+  while (channel.CHCTRLA.reg & DMAC_CHCTRLA_SWRST); // Wait for reset
+  channel.CHCTRLA.reg = DMAC_CHCTRLA_TRIGSRC(trigSrc) | DMAC_CHCTRLA_TRIGACT_BURST;
+  channel.CHINTENSET.reg = DMAC_CHINTENSET_TCMPL | DMAC_CHINTENSET_TERR;
+
+  _onRampEnd = onRampEnd;
+  _dutyCycle = PWM_DUTY_CYCLE_RAMPED;
+  _isDmaRampActive = true;
+  dmaRampTimer = this;
+  channel.CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+}
+
+int PwmTimer::startDmaRamp(uint32_t numCounts, PwmRampFillFn fill, void *context,
+    void (*onRampEnd)()) {
+  if (!isValid()) {
+    return ERR_INVALID_PWM;
+  } else if (numCounts == 0) {
+    return ERR_EMPTY_RAMP;
+  }
+
+  _resetDmaRamp(numCounts, fill, context);
+  _fillDmaRampBlock(0);
+  _fillDmaRampBlock(1);
+  _enableDmaRamp(onRampEnd);
+
+  return ERR_SUCCESS;
+}
+
+int PwmTimer::prepareDmaRamp(PwmRampStart &start, uint32_t numCounts, PwmRampFillFn fill,
+    void *context) const {
+  if (!isValid()) {
+    return ERR_INVALID_PWM;
+  } else if (numCounts == 0) {
+    return ERR_EMPTY_RAMP;
+  }
+
+  uint32_t filled = 0;
+  for (unsigned int block = 0; block < 2; block++) {
+    uint16_t blockLen = min(numCounts - filled, (uint32_t)PWM_DMA_BLOCK_LEN);
+    if (blockLen > 0) {
+      fill(start.counts[block], filled, blockLen, context);
+    }
+    start.numCounts[block] = blockLen;
+    filled += blockLen;
+  }
+  start.rampLength = numCounts;
+
+  return ERR_SUCCESS;
+}
+
+int PwmTimer::startDmaRamp(const PwmRampStart &start, PwmRampFillFn fill, void *context,
+    void (*onRampEnd)()) {
+  if (!isValid()) {
+    return ERR_INVALID_PWM;
+  } else if (start.rampLength == 0) {
+    return ERR_EMPTY_RAMP;
+  }
+
+  // The DMAC plays the first two blocks from 'start'; the interrupt refills each block into
+  // dmaRampBlocks as it's played, and the DMAC goes on from there.
+  _resetDmaRamp(start.rampLength, fill, context);
+  for (unsigned int block = 0; block < 2; block++) {
+    if (start.numCounts[block] > 0) {
+      _setDmaRampBlock(block, start.counts[block], start.numCounts[block]);
+    }
+  }
+  _enableDmaRamp(onRampEnd);
+
+  return ERR_SUCCESS;
+}
+
+void PwmTimer::stopDmaRamp() {
+  if (!_isDmaRampActive) {
+    return;
+  }
+
+  DmacChannel &channel = DMAC->Channel[PWM_DMA_CHANNEL];
+  channel.CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  while (channel.CHCTRLA.reg & DMAC_CHCTRLA_ENABLE); // Wait for the channel to stop
+  channel.CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL | DMAC_CHINTFLAG_TERR | DMAC_CHINTFLAG_SUSP;
+
+  _isDmaRampActive = false;
+  dmaRampTimer = NULL;
+}
+
+// A block of the ramp has played. The DMAC has gone on to the other block, if there's more; refill
+// this one to follow it.
+void PwmTimer::_onDmaRampBlockEnd() {
+  unsigned int block = _rampBlock;
+  _rampBlock = block ^ 1;
+  _rampPlayed += dmaRampBlockLen[block];
+  if (_rampPlayed >= _rampLength) {
+    _onDmaRampEnd();
+    return;
+  }
+
+  _fillDmaRampBlock(block);
+}
+
+void PwmTimer::_onDmaRampEnd() {
+  _isDmaRampActive = false;
+  dmaRampTimer = NULL;
+  if (_onRampEnd != NULL) {
+    _onRampEnd();
+  }
+}
+
+// Block transfer complete (or error) on a DMA ramp.
+extern "C" void DMAC_0_Handler() {
+  DmacChannel &channel = DMAC->Channel[PWM_DMA_CHANNEL];
+  uint32_t flags = channel.CHINTFLAG.reg;
+  channel.CHINTFLAG.reg = flags; // Clear them.
+
+  PwmTimer *timer = dmaRampTimer;
+  if (timer == NULL) {
+    return;
+  } else if (flags & DMAC_CHINTFLAG_TERR) {
+    timer->stopDmaRamp();
+    timer->_onDmaRampEnd();
+  } else if (flags & DMAC_CHINTFLAG_TCMPL) {
+    timer->_onDmaRampBlockEnd();
+  }
+}
+
 int PwmTimer::setupTcc() {
   if (!isValid()) {
     return ERR_INVALID_PWM; // Nothing to do.
   }
 
-  // Set as output.
+  // Set as output. It's low whenever the peripheral multiplexer is off.
   PORT->Group[_portGroup].DIRSET.reg |= _portPinBit;
+  PORT->Group[_portGroup].OUTCLR.reg = _portPinBit;
 
   // Enable the peripheral multiplexer on output pin
   PORT->Group[_portGroup].PINCFG[_portPin].bit.PMUXEN = 1;
@@ -144,13 +440,14 @@ int PwmTimer::setupTcc() {
   }
 
   // Set up the generic clock (GCLK7) to be the clock for the selected TCC.
-  GCLK->GENCTRL[7].reg = GCLK_GENCTRL_DIV(1) |       // Divide the 48MHz clock source by divisor 1:
-                                                     // 48MHz/1 = 48MHz
+  unsigned int clockSrc = GCLK_GENCTRL_SRC_DFLL;     // Select 48MHz DFLL clock source
+  if (_clockSource == PwmClockSource::DPLL0_120MHZ) {
+    clockSrc = GCLK_GENCTRL_SRC_DPLL0;               // Select 120MHz DPLL clock source
+  }
+  GCLK->GENCTRL[7].reg = GCLK_GENCTRL_DIV(1) |       // Divide the clock source by divisor 1
                          GCLK_GENCTRL_IDC |          // Set the duty cycle to 50/50 HIGH/LOW
                          GCLK_GENCTRL_GENEN |        // Enable GCLK7
-                         GCLK_GENCTRL_SRC(GCLK_GENCTRL_SRC_DFLL);  // Select 48MHz DFLL clock source
-                         //GCLK_GENCTRL_SRC_DPLL1;     // Select 100MHz DPLL clock source
-                         //GCLK_GENCTRL_SRC_DPLL0;     // Select 120MHz DPLL clock source
+                         GCLK_GENCTRL_SRC(clockSrc);
   while (GCLK->SYNCBUSY.bit.GENCTRL7);               // Wait for synchronization
 
   unsigned int periphId = TCC0_GCLK_ID;
@@ -200,16 +497,32 @@ int PwmTimer::setupTcc() {
     break;
   }
 
+  unsigned int resolution_flag = TCC_CTRLA_RESOLUTION_NONE;
+  switch (_ditherBits) {
+  case PWM_DITHER_4:
+    resolution_flag = TCC_CTRLA_RESOLUTION_DITH4;
+    break;
+  case PWM_DITHER_5:
+    resolution_flag = TCC_CTRLA_RESOLUTION_DITH5;
+    break;
+  case PWM_DITHER_6:
+    resolution_flag = TCC_CTRLA_RESOLUTION_DITH6;
+    break;
+  default:
+    break;
+  }
+
   // Set prescaler (Our default is 8, 48MHz/8 = 6MHz) and set reset/reload to trigger on prescaler
-  // clock.
-  _TCC->CTRLA.reg = prescaler_flag | TC_CTRLA_PRESCSYNC_PRESC;
+  // clock. Enable dithering, if any.
+  _TCC->CTRLA.reg = prescaler_flag | TC_CTRLA_PRESCSYNC_PRESC | resolution_flag;
 
   // Set-up TCCn timer for Normal (single slope) PWM mode (NPWM)
   _TCC->WAVE.reg = TCC_WAVE_WAVEGEN_NPWM;
   while (_TCC->SYNCBUSY.bit.WAVE);         // Wait for synchronization
 
   // Set-up the PER (period) register for specified PWM freq and reset the counter.
-  _TCC->PER.reg = TCC_PER_PER(_pwmWaveCount);
+  // (With dithering, the period's value is above the dither bits, and its dither cycle is 0.)
+  _TCC->PER.reg = _pwmWaveCount << _ditherBits;
   _TCC->COUNT.reg = 0;
   while (_TCC->SYNCBUSY.bit.PER);          // Wait for synchronization
 
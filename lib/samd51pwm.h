@@ -14,20 +14,141 @@ constexpr unsigned int TCC_PLL_FREQ = 48000000; // Use 48MHz base clock.
 constexpr unsigned int DEFAULT_PWM_PRESCALER = 8;
 constexpr unsigned int DEFAULT_PWM_CLOCK_HZ = 6000000; // 48MHz clock div 8 = 6 MHz.
 
+/** The clock that drives the TCC (through GCLK7). */
+enum class PwmClockSource: uint8_t {
+  DFLL_48MHZ,   // The 48 MHz DFLL.
+  DPLL0_120MHZ, // The 120 MHz DPLL that also clocks the CPU.
+};
+
+constexpr uint32_t pwmClockSourceHz(PwmClockSource clockSource) {
+  return (clockSource == PwmClockSource::DPLL0_120MHZ) ? 120000000 : TCC_PLL_FREQ;
+}
+
+// Hardware dithering: the TCC adds one count to the duty cycle in a fraction of each group of
+// 2^N periods, for N extra bits of duty cycle resolution. Available on TCC0..TCC2.
+constexpr unsigned int PWM_DITHER_NONE = 0;
+constexpr unsigned int PWM_DITHER_4 = 4; // Dither cycle of 16 periods.
+constexpr unsigned int PWM_DITHER_5 = 5; // Dither cycle of 32 periods.
+constexpr unsigned int PWM_DITHER_6 = 6; // Dither cycle of 64 periods.
+
+// The TCC counter width: 24 bits for TCC0 and TCC1, 16 bits for TCC2..TCC4. With dithering,
+// the low N bits of the period and compare registers are the dither cycle.
+constexpr unsigned int TCC_COUNTER_BITS = 24;
+constexpr unsigned int TCC_SHORT_COUNTER_BITS = 16;
+
+/** Clock settings for a PwmTimer. */
+struct PwmClockConfig {
+  PwmClockSource clockSource;
+  uint32_t prescaler;  // 1, 2, 4, 8, 16, 64, 256, or 1024.
+  uint32_t ditherBits; // PWM_DITHER_*
+};
+
+/**
+ * Return the clock settings with the most duty cycle resolution at pwmFreq: the clock source
+ * and prescaler with the longest period (in counts) that fits the counter, with the specified
+ * dithering on top.
+ */
+constexpr PwmClockConfig highResolutionPwmClock(uint32_t pwmFreq,
+    unsigned int counterBits = TCC_COUNTER_BITS, unsigned int ditherBits = PWM_DITHER_4) {
+  constexpr uint32_t PRESCALERS[] = { 1, 2, 4, 8, 16, 64, 256, 1024 };
+  constexpr PwmClockSource SOURCES[] = { PwmClockSource::DPLL0_120MHZ, PwmClockSource::DFLL_48MHZ };
+  uint32_t maxPeriodCount = (uint32_t)1 << (counterBits - ditherBits);
+
+  PwmClockConfig best = { PwmClockSource::DFLL_48MHZ, 1024, ditherBits }; // As slow as it gets.
+  uint32_t bestPeriodCount = 0;
+  for (PwmClockSource source : SOURCES) {
+    for (uint32_t prescaler : PRESCALERS) {
+      uint32_t periodCount = pwmClockSourceHz(source) / prescaler / pwmFreq;
+      if (periodCount <= maxPeriodCount && periodCount > bestPeriodCount) {
+        best = { source, prescaler, ditherBits };
+        bestPeriodCount = periodCount;
+      }
+    }
+  }
+
+  return best;
+}
+
+// DMA ramps use this DMAC channel. If the DMAC is already enabled, PwmTimer puts its
+// descriptors in the descriptor memory set up for it; otherwise it sets up its own. It handles
+// the DMAC_0 interrupt, so no other library may use that (e.g. Adafruit_ZeroDMA on channel 0).
+constexpr unsigned int PWM_DMA_CHANNEL = 0;
+
+// A DMA ramp streams from two buffers of this many compare values in turn: while the DMAC
+// reads one, the other is refilled from the DMAC interrupt.
+constexpr unsigned int PWM_DMA_BLOCK_LEN = 256;
+
+/**
+ * Fills 'counts' with the compare values (from dutyCycleToCount()) of a DMA ramp for
+ * 'numCounts' PWM periods, from 'index' periods into the ramp. Called from startDmaRamp(), then
+ * from the DMAC interrupt.
+ */
+typedef void (*PwmRampFillFn)(uint32_t *counts, uint32_t index, uint16_t numCounts,
+    void *context);
+
+/**
+ * The first two blocks of a DMA ramp, computed ahead of time by prepareDmaRamp(), so that the
+ * ramp can be started (e.g. from an interrupt) without computing any values. The DMAC reads
+ * them in place: they must stay intact until the ramp has played them, or has been stopped.
+ */
+struct PwmRampStart {
+  uint32_t counts[2][PWM_DMA_BLOCK_LEN];
+  uint16_t numCounts[2];
+  uint32_t rampLength;
+};
+
+// getDutyCycle() after startDmaRamp(): the duty cycle is whatever the ramp last set.
+constexpr uint32_t PWM_DUTY_CYCLE_RAMPED = UINT32_MAX;
+
 /**
  * Creates a PWM timer
+ *
+ * The duty cycle ranges from 0 (always off) to getDutyCycleRange() (always on). With the
+ * prescaler-only constructor that range is pwmFreq. With a PwmClockConfig, the range is the
+ * timer's full compare resolution, including dithering, so every step is a distinct duty cycle.
  */
 class PwmTimer {
 public:
   PwmTimer(uint32_t portGroup, uint32_t portPin, uint32_t portFn, Tcc* tcc,
       uint32_t pwmChannel, uint32_t pwmFreq, uint32_t pwmPrescaler);
+  PwmTimer(uint32_t portGroup, uint32_t portPin, uint32_t portFn, Tcc* tcc,
+      uint32_t pwmChannel, uint32_t pwmFreq, const PwmClockConfig &clockConfig);
   ~PwmTimer();
 
   void enable();
   void disable();
 
   int setDutyCycle(unsigned int dutyCycle);
+  // Set the duty cycle from the next PWM period on, without waiting. (See isUpdatePending().)
+  int setDutyCycleBuffered(unsigned int dutyCycle);
+  // True if the duty cycle from setDutyCycleBuffered() has not taken effect yet.
+  bool isUpdatePending() const;
   uint32_t getDutyCycle() const { return _dutyCycle; };
+  uint32_t getDutyCycleRange() const { return _dutyCycleRange; };
+  // Return the compare register value for a duty cycle, for use in a DMA ramp.
+  uint32_t dutyCycleToCount(uint32_t dutyCycle) const;
+
+  // Stream 'numCounts' compare values into the PWM, one per PWM period, by DMA. 'fill'
+  // computes them PWM_DMA_BLOCK_LEN at a time: the CPU is only involved once per block, and
+  // when the ramp ends and onRampEnd (if not NULL) is called from the DMAC interrupt. 'context'
+  // must stay intact until then. Only one timer can ramp at a time. Setting the duty cycle, or
+  // starting another ramp, stops the ramp in progress.
+  int startDmaRamp(uint32_t numCounts, PwmRampFillFn fill, void *context, void (*onRampEnd)());
+  // Compute the first two blocks of a ramp of 'numCounts' values into 'start'. Then
+  // startDmaRamp(start, ...) with the same 'fill' and 'context' only has to set up the DMAC;
+  // 'fill' computes the rest of the ramp from the DMAC interrupt, as usual.
+  int prepareDmaRamp(PwmRampStart &start, uint32_t numCounts, PwmRampFillFn fill,
+      void *context) const;
+  int startDmaRamp(const PwmRampStart &start, PwmRampFillFn fill, void *context,
+      void (*onRampEnd)());
+  void stopDmaRamp();
+  bool isDmaRampActive() const { return _isDmaRampActive; };
+
+  // Disconnect the output pin from the TCC and drive it low, or reconnect it. The TCC keeps
+  // running either way. One port register write; safe to call from an interrupt.
+  void setOutputForcedOff(bool isOff) {
+    PORT->Group[_portGroup].PINCFG[_portPin].bit.PMUXEN = !isOff;
+  };
 
   uint32_t getPwmFreq() const { return _pwmFreq; };
   uint32_t getPwmClockFreq() const { return _pwmClockHz; };
@@ -36,7 +157,15 @@ public:
 
   int setupTcc();
 
+  void _onDmaRampBlockEnd();
+  void _onDmaRampEnd();
+
 private:
+  void _setupDmac();
+  void _resetDmaRamp(uint32_t numCounts, PwmRampFillFn fill, void *context);
+  bool _fillDmaRampBlock(unsigned int block);
+  void _setDmaRampBlock(unsigned int block, const uint32_t *counts, uint16_t numCounts);
+  void _enableDmaRamp(void (*onRampEnd)());
 
   const uint32_t _portGroup;
   const uint32_t _portPin;
@@ -44,10 +173,24 @@ private:
   const uint32_t _portFn;
   const uint32_t _pwmChannel;
   const uint32_t _pwmFreq;
+  const PwmClockSource _clockSource;
   const uint32_t _pwmPrescaler;
+  const uint32_t _ditherBits;
   const uint32_t _pwmClockHz;
   const uint32_t _pwmWaveCount;
+  const uint32_t _dutyCycleRange;
+  // Compare register value per unit of duty cycle, in 16.16 fixed point. Precomputed so that
+  // setDutyCycle() doesn't divide.
+  const uint32_t _countPerDutyCycle;
   uint32_t _dutyCycle;
+  volatile bool _isDmaRampActive;
+  void (*_onRampEnd)();
+  PwmRampFillFn _rampFill;
+  void *_rampContext;
+  uint32_t _rampLength;
+  uint32_t _rampFilled; // Values computed so far.
+  uint32_t _rampPlayed; // Values in the blocks the DMAC has finished.
+  unsigned int _rampBlock; // The block the DMAC is reading.
   Tcc *const _TCC;
 };
 
@@ -57,6 +200,7 @@ constexpr int ERR_SUCCESS = 0; // Return code '0' is success, not an error.
 constexpr int ERR_MAKE_PWM_NOT_A_TCC = 1; // This only works with TCC's, not TC's.
 constexpr int ERR_DUTY_CYCLE_TOO_LONG = 2; // setDutyCycle() max val of pwmFreq was exceeded.
 constexpr int ERR_INVALID_PWM = 3; // Invalid TCC timer object.
+constexpr int ERR_EMPTY_RAMP = 4; // startDmaRamp() was given no values.
 
 #endif /* _SAMD51_PWM_H */
 
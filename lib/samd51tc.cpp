@@ -0,0 +1,181 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// samd51tc -- Periodic and one-shot timer interrupts from the ATSAMD51 TC timers.
+
+#include "samd51tc.h"
+
+static constexpr uint32_t TC_PRESCALERS[] = { 1, 2, 4, 8, 16, 64, 256, 1024 };
+static constexpr uint32_t TC_PRESCALER_VALS[] = {
+  TC_CTRLA_PRESCALER_DIV1, TC_CTRLA_PRESCALER_DIV2, TC_CTRLA_PRESCALER_DIV4,
+  TC_CTRLA_PRESCALER_DIV8, TC_CTRLA_PRESCALER_DIV16, TC_CTRLA_PRESCALER_DIV64,
+  TC_CTRLA_PRESCALER_DIV256, TC_CTRLA_PRESCALER_DIV1024,
+};
+
+// One-shot TCs use this prescaler.
+static constexpr uint32_t ONE_SHOT_TC_PRESCALER = 64;
+
+/**
+ * Look up the GCLK channel and IRQ of a TC. Returns false if it's not TC0..TC5.
+ */
+static bool getTcIds(Tc *tc, unsigned int &gclkId, IRQn_Type &irq) {
+  if (tc == TC0) {
+    gclkId = TC0_GCLK_ID;
+    irq = TC0_IRQn;
+  } else if (tc == TC1) {
+    gclkId = TC1_GCLK_ID;
+    irq = TC1_IRQn;
+  } else if (tc == TC2) {
+    gclkId = TC2_GCLK_ID;
+    irq = TC2_IRQn;
+  } else if (tc == TC3) {
+    gclkId = TC3_GCLK_ID;
+    irq = TC3_IRQn;
+  } else if (tc == TC4) {
+    gclkId = TC4_GCLK_ID;
+    irq = TC4_IRQn;
+  } else if (tc == TC5) {
+    gclkId = TC5_GCLK_ID;
+    irq = TC5_IRQn;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Enable the bus clock and GCLK1 for the TC, and reset it. Returns false if it's not TC0..TC5.
+ */
+static bool resetTc(Tc *tc, IRQn_Type &irq) {
+  unsigned int gclkId;
+  if (!getTcIds(tc, gclkId, irq)) {
+    return false;
+  }
+
+  // Enable the TC bus clock.
+  if (tc == TC0) {
+    MCLK->APBAMASK.reg |= MCLK_APBAMASK_TC0;
+  } else if (tc == TC1) {
+    MCLK->APBAMASK.reg |= MCLK_APBAMASK_TC1;
+  } else if (tc == TC2) {
+    MCLK->APBBMASK.reg |= MCLK_APBBMASK_TC2;
+  } else if (tc == TC3) {
+    MCLK->APBBMASK.reg |= MCLK_APBBMASK_TC3;
+  } else if (tc == TC4) {
+    MCLK->APBCMASK.reg |= MCLK_APBCMASK_TC4;
+  } else {
+    MCLK->APBCMASK.reg |= MCLK_APBCMASK_TC5;
+  }
+
+  GCLK->PCHCTRL[gclkId].reg = GCLK_PCHCTRL_GEN_GCLK1 | GCLK_PCHCTRL_CHEN;
+  while (!(GCLK->PCHCTRL[gclkId].reg & GCLK_PCHCTRL_CHEN)); // Wait for the clock
+
+  tc->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+  while (tc->COUNT16.SYNCBUSY.bit.SWRST);           // Wait for reset
+  return true;
+}
+
+// Issue a CTRLB command (TC_CTRLBSET_CMD_*) and wait for it to take.
+static inline void tcCommand(Tc *tc, uint32_t cmd) {
+  tc->COUNT16.CTRLBSET.reg = cmd;
+  while (tc->COUNT16.SYNCBUSY.bit.CTRLB);           // Wait for synchronization
+}
+
+// Clear the TC's interrupt flag and any interrupt it has pending in the NVIC.
+static void clearTcInterrupt(Tc *tc) {
+  unsigned int gclkId;
+  IRQn_Type irq;
+  tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+  if (getTcIds(tc, gclkId, irq)) {
+    NVIC_ClearPendingIRQ(irq);
+  }
+}
+
+int setupPeriodicTc(Tc *tc, uint32_t periodMicros, uint32_t irqPriority) {
+  IRQn_Type irq;
+  if (!resetTc(tc, irq)) {
+    return ERR_PERIODIC_TC_INVALID;
+  }
+
+  // Find the smallest prescaler whose period count fits in 16 bits.
+  unsigned int prescalerIdx = 0;
+  uint64_t periodCount = 0;
+  for (; prescalerIdx < sizeof(TC_PRESCALERS) / sizeof(TC_PRESCALERS[0]); prescalerIdx++) {
+    periodCount = ((uint64_t)PERIODIC_TC_CLOCK_HZ * periodMicros)
+        / (1000000ULL * TC_PRESCALERS[prescalerIdx]);
+    if (periodCount <= 0x10000) {
+      break;
+    }
+  }
+  if (periodCount == 0 || periodCount > 0x10000) {
+    return ERR_PERIODIC_TC_PERIOD;
+  }
+
+  // Count up to CC0 and start over (match frequency mode); interrupt on each match.
+  tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCSYNC_PRESC
+      | TC_PRESCALER_VALS[prescalerIdx];
+  tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_MFRQ;
+  tc->COUNT16.CC[0].reg = periodCount - 1;
+  while (tc->COUNT16.SYNCBUSY.bit.CC0);             // Wait for synchronization
+  tc->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+  NVIC_SetPriority(irq, irqPriority);
+  NVIC_EnableIRQ(irq);
+
+  tc->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+  while (tc->COUNT16.SYNCBUSY.bit.ENABLE);          // Wait for synchronization
+
+  return PERIODIC_TC_SUCCESS;
+}
+
+void stopPeriodicTc(Tc *tc) {
+  tcCommand(tc, TC_CTRLBSET_CMD_STOP);
+  clearTcInterrupt(tc);
+}
+
+void restartPeriodicTc(Tc *tc) {
+  tcCommand(tc, TC_CTRLBSET_CMD_RETRIGGER);
+}
+
+int setupOneShotTc(Tc *tc, uint32_t irqPriority) {
+  IRQn_Type irq;
+  if (!resetTc(tc, irq)) {
+    return ERR_PERIODIC_TC_INVALID;
+  }
+
+  // Count up to CC0, interrupt, and stop there.
+  tc->COUNT16.CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCSYNC_PRESC
+      | TC_CTRLA_PRESCALER_DIV64;
+  tc->COUNT16.WAVE.reg = TC_WAVE_WAVEGEN_MFRQ;
+  tcCommand(tc, TC_CTRLBSET_ONESHOT);
+  tc->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+
+  NVIC_SetPriority(irq, irqPriority);
+  NVIC_EnableIRQ(irq);
+
+  tc->COUNT16.CTRLA.reg |= TC_CTRLA_ENABLE;
+  while (tc->COUNT16.SYNCBUSY.bit.ENABLE);          // Wait for synchronization
+  tcCommand(tc, TC_CTRLBSET_CMD_STOP);              // Enabling it started it.
+
+  return PERIODIC_TC_SUCCESS;
+}
+
+void startOneShotTc(Tc *tc, uint32_t micros) {
+  uint32_t count = ((uint64_t)PERIODIC_TC_CLOCK_HZ * min(micros, ONE_SHOT_TC_MAX_MICROS))
+      / (1000000ULL * ONE_SHOT_TC_PRESCALER);
+  tc->COUNT16.CC[0].reg = max(count, (uint32_t)1);
+  while (tc->COUNT16.SYNCBUSY.bit.CC0);             // Wait for synchronization
+  clearTcInterrupt(tc);
+  tcCommand(tc, TC_CTRLBSET_CMD_RETRIGGER);         // Count from zero.
+}
+
+uint32_t stopOneShotTc(Tc *tc) {
+  tcCommand(tc, TC_CTRLBSET_CMD_READSYNC);
+  uint32_t count = tc->COUNT16.COUNT.reg;
+  if (tc->COUNT16.INTFLAG.reg & TC_INTFLAG_MC0) {
+    count = tc->COUNT16.CC[0].reg; // Time was up. (It stopped and went back to zero.)
+  }
+  tcCommand(tc, TC_CTRLBSET_CMD_STOP);
+  clearTcInterrupt(tc);
+
+  return ((uint64_t)count * 1000000ULL * ONE_SHOT_TC_PRESCALER) / PERIODIC_TC_CLOCK_HZ;
+}
@@ -0,0 +1,55 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// samd51tc -- Periodic and one-shot timer interrupts from the ATSAMD51 TC timers.
+
+#ifndef _SAMD51_TC_H
+#define _SAMD51_TC_H
+
+#include<Arduino.h>
+#include<samd.h>
+
+// The TCs are clocked from GCLK1, which the Arduino core runs from the 48 MHz DFLL.
+constexpr uint32_t PERIODIC_TC_CLOCK_HZ = 48000000;
+
+constexpr int PERIODIC_TC_SUCCESS = 0;
+constexpr int ERR_PERIODIC_TC_INVALID = 1; // Not TC0..TC5.
+constexpr int ERR_PERIODIC_TC_PERIOD = 2; // The period doesn't fit the 16-bit counter.
+
+/**
+ * Set up a TC as a 16-bit counter that restarts, and interrupts, every periodMicros. The
+ * interrupt is handled by TCn_Handler() and must clear TC_INTFLAG_MC0. The smallest prescaler
+ * that fits the period is used, so the period is as exact as it can be.
+ */
+int setupPeriodicTc(Tc *tc, uint32_t periodMicros, uint32_t irqPriority);
+
+/**
+ * Stop a periodic TC, discarding any interrupt it has pending. It can be called from an
+ * interrupt handler.
+ */
+void stopPeriodicTc(Tc *tc);
+
+/**
+ * Start a periodic TC (again) from zero: its next interrupt is a full period from now. It can
+ * be called from an interrupt handler.
+ */
+void restartPeriodicTc(Tc *tc);
+
+// One-shot TCs count at PERIODIC_TC_CLOCK_HZ / 64, so they can run for at most this long.
+constexpr uint32_t ONE_SHOT_TC_MAX_MICROS = 0xFFFFULL * 64 * 1000000 / PERIODIC_TC_CLOCK_HZ;
+
+/**
+ * Set up a TC as a stopped 16-bit one-shot timer. Each startOneShotTc() then interrupts once,
+ * when its time is up; the interrupt is handled by TCn_Handler() and must clear TC_INTFLAG_MC0.
+ */
+int setupOneShotTc(Tc *tc, uint32_t irqPriority);
+
+/** Start the one-shot TC to interrupt in 'micros' (at most ONE_SHOT_TC_MAX_MICROS). */
+void startOneShotTc(Tc *tc, uint32_t micros);
+
+/**
+ * Stop the one-shot TC, discarding its interrupt if it's pending. Returns the micros it ran
+ * since startOneShotTc(): all of them, if its time was up.
+ */
+uint32_t stopOneShotTc(Tc *tc);
+
+#endif /* _SAMD51_TC_H */
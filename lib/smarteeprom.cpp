@@ -140,7 +140,7 @@ int readEEPROM(unsigned int offset, void *dataOut, size_t size) {
   // Wait for hardware to be ready...
   while (NVMCTRL->SEESTAT.bit.BUSY);
 
-  const volatile uint32_t *readCursor = ptrEEPROM;
+  const volatile uint32_t *readCursor = ptrEEPROM + offset / sizeof(uint32_t);
   uint32_t *writeCursor = (uint32_t *)dataOut;
   size_t copied = 0;
   while (copied < size) {
@@ -176,7 +176,7 @@ int writeEEPROM(unsigned int offset, const void *data, size_t size) {
   while (NVMCTRL->SEESTAT.bit.BUSY);
 
   // Copy data to EEPROM.
-  volatile uint32_t *writeCursor = ptrEEPROM;
+  volatile uint32_t *writeCursor = ptrEEPROM + offset / sizeof(uint32_t);
   const uint32_t *readCursor = (const uint32_t *)data;
   size_t copied = 0;
   while (copied < size) {
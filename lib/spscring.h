@@ -0,0 +1,66 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// spscring -- A lock-free single-producer, single-consumer ring buffer, for passing events
+// from an interrupt handler to the main loop.
+
+#ifndef _SPSC_RING_H
+#define _SPSC_RING_H
+
+#include<atomic>
+#include<stdint.h>
+
+/**
+ * A ring of up to N items (N a power of 2). Exactly one context may push() (e.g. an interrupt
+ * handler, or several that can't preempt one another) and exactly one other may pop() (e.g.
+ * the main loop). Neither side ever waits for or disables the other.
+ *
+ * The head and tail indexes run freely and are reduced mod N. Each is only written by its own
+ * side; the release store that publishes it orders the item access before it, so an item is
+ * never read before it's written, nor overwritten before it's read.
+ *
+ * A push() to a full ring drops the item and counts it in getOverflowCount().
+ */
+template<typename T, unsigned int N>
+class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing length must be a power of 2");
+
+public:
+  SpscRing(): _head(0), _tail(0), _overflowCount(0) { };
+
+  // Producer: add an item. Returns false, and counts an overflow, if the ring is full.
+  bool push(const T &item) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == N) {
+      _overflowCount.store(_overflowCount.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+      return false;
+    }
+
+    _items[tail % N] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  };
+
+  // Consumer: take the oldest item into 'item'. Returns false if the ring is empty.
+  bool pop(T &item) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    item = _items[head % N];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  };
+
+  // The number of items dropped because the ring was full, ever. (Wraps around.)
+  uint32_t getOverflowCount() const { return _overflowCount.load(std::memory_order_relaxed); };
+
+private:
+  T _items[N];
+  std::atomic<uint32_t> _head; // Next item to pop.
+  std::atomic<uint32_t> _tail; // Where the next item is pushed.
+  std::atomic<uint32_t> _overflowCount;
+};
+
+#endif /* _SPSC_RING_H */
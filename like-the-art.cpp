@@ -13,9 +13,18 @@ static constexpr unsigned int PWM_PORT_FN = 0x6; // 0=A, 1=B, ... 0x5=F, 0x6=G,
 static Tcc* const TCC = TCC0;
 static constexpr unsigned int PWM_CHANNEL = 0;
 static constexpr unsigned int PWM_FREQ = 6000; // 6 KHz
+// 120MHz with no prescaler, plus 4 bits of dithering: 320,000 duty cycle steps at 6 KHz.
+static constexpr PwmClockConfig PWM_CLOCK = highResolutionPwmClock(PWM_FREQ);
 
 PwmTimer pwmTimer(PWM_PORT_GROUP, PWM_PORT_PIN, PWM_PORT_FN, TCC,
-    PWM_CHANNEL, PWM_FREQ, DEFAULT_PWM_PRESCALER);
+    PWM_CHANNEL, PWM_FREQ, PWM_CLOCK);
+
+// Each PWM zone's output. Zones may be channels of one TCC (which then share its frequency and
+// clock) or separate TCCs; each needs its own pin. All TCCs are clocked through GCLK7, so every
+// zone must use the same PwmClockSource.
+PwmTimer *const pwmZoneTimers[NUM_PWM_ZONES] = {
+  &pwmTimer,
+};
 
 // Integrated neopixel on D8.
 Adafruit_NeoPixel neoPixel(1, 8, NEO_GRB | NEO_KHZ800);
@@ -33,9 +42,11 @@ MacroState macroState = MacroState::MS_RUNNING;
 static Effect lockedEffect;
 static unsigned int lockedSentenceId;
 
-// How much longer are the current choices locked choices valid for?
-static unsigned int remainingLockedEffectMillis;
-static unsigned int remainingLockedSentenceMillis;
+// Are the effect and sentence choices currently locked, and since when (per millis())?
+static bool isEffectLocked = false;
+static bool isSentenceLocked = false;
+static unsigned int effectLockStartMillis;
+static unsigned int sentenceLockStartMillis;
 
 // When a button press "locks" an effect or sentence, how long is it initially locked for?
 static constexpr unsigned int EFFECT_LOCK_MILLIS = 20000;
@@ -44,63 +55,108 @@ static constexpr unsigned int SENTENCE_LOCK_MILLIS = 20000;
 // What are the % odds that the loop chooses the main sentence as the next sentence to display?
 static unsigned int mainSentenceTemperature = MAIN_SENTENCE_BASE_TEMPERATURE;
 
-// The id of the previous sentence shown.
+// The id of the sentence most recently added to the animation queue.
 static unsigned int lastSentenceId = INVALID_SENTENCE_ID;
 
-// The next Animation state to use after the current one is finished.
-// If onDeckSentenceId is INVALID_SENTENCE_ID or onDeckEffect is EF_NO_EFFECT,
-// these variables are disregarded.
-static unsigned int onDeckSentenceId = INVALID_SENTENCE_ID;
-static Effect onDeckEffect = Effect::EF_NO_EFFECT;
-static uint32_t onDeckFlags = 0;
-
-void setOnDeckAnimationParams(unsigned int sentenceId, Effect ef, uint32_t flags) {
-  onDeckSentenceId = sentenceId;
-  onDeckEffect = ef;
-  onDeckFlags = flags;
+/**
+ * The upcoming animations. In the slack time between frames of the active animation, the main
+ * loop chooses what comes next and adds it to this queue; the animation at the head of the queue
+ * is also planned ahead in nextAnimation. When the active animation ends, starting the next one
+ * is just a swap.
+ *
+ * Animations queued explicitly with queueNextAnimation() are 'pinned': they stay at the front
+ * of the queue when a lock discards the animations chosen ahead of time.
+ */
+struct QueuedAnimation {
+  unsigned int sentenceId;
+  Effect effect;
+  uint32_t flags;
+  bool isPinned;
+};
+
+static constexpr unsigned int ANIMATION_QUEUE_LEN = 3;
+static QueuedAnimation animationQueue[ANIMATION_QUEUE_LEN];
+static unsigned int animationQueueHead = 0; // Index of the next animation to run.
+static unsigned int animationQueueCount = 0;
+static bool isNextAnimationPlanned = false; // nextAnimation is set up for the head of the queue.
+
+// A step of planning is only taken if the active animation's next change is at least this far
+// off. (No single step takes this long.)
+static constexpr unsigned int PLANNING_STEP_MICROS = LOOP_MICROS / 2;
+
+static void enqueueAnimation(unsigned int sentenceId, Effect ef, uint32_t flags, bool isPinned) {
+  QueuedAnimation &queued =
+      animationQueue[(animationQueueHead + animationQueueCount) % ANIMATION_QUEUE_LEN];
+  queued.sentenceId = sentenceId;
+  queued.effect = ef;
+  queued.flags = flags;
+  queued.isPinned = isPinned;
+  animationQueueCount++;
+  lastSentenceId = sentenceId;
 }
 
-void clearOnDeckAnimationParams() {
-  setOnDeckAnimationParams(INVALID_SENTENCE_ID, Effect::EF_NO_EFFECT, 0);
+void queueNextAnimation(unsigned int sentenceId, Effect ef, uint32_t flags) {
+  clearAnimationQueue();
+  enqueueAnimation(sentenceId, ef, flags, true);
 }
 
-// Neopixel intensity is increasing each tick if true.
-static bool isNeoPixelIncreasing = true;
-static constexpr float NEO_PIXEL_INCREMENT = 1.0f / 256.0f;
+void clearAnimationQueue() {
+  animationQueueCount = 0;
+  isNextAnimationPlanned = false;
+}
+
+/**
+ * Discard the animations that were chosen ahead of time, e.g. because the locks they were chosen
+ * under have changed. Pinned animations are kept.
+ */
+static void discardChosenAnimations() {
+  unsigned int numPinned = 0;
+  while (numPinned < animationQueueCount
+      && animationQueue[(animationQueueHead + numPinned) % ANIMATION_QUEUE_LEN].isPinned) {
+    numPinned++;
+  }
+
+  animationQueueCount = numPinned;
+  if (numPinned == 0) {
+    isNextAnimationPlanned = false;
+  }
+}
+
+// Neopixel intensity ramps up from zero to max over this many millis, then back down.
+static constexpr unsigned int NEO_PIXEL_RAMP_MILLIS = 2560;
 static constexpr uint32_t NEO_PIXEL_MAX_INTENSITY = 20; // out of 255.
-static float neoPixelIntensity = 0;
+static uint32_t neoPixelShownColor = 0;
 
 // NeoPixel color reflects current MacroState.
 static inline void updateNeoPixel() {
-  if (isNeoPixelIncreasing) {
-    neoPixelIntensity += NEO_PIXEL_INCREMENT;
-    if (neoPixelIntensity >= 1 - NEO_PIXEL_INCREMENT) {
-      isNeoPixelIncreasing = false;
-      neoPixelIntensity = 1.0f;
-    }
-  } else {
-    neoPixelIntensity -= NEO_PIXEL_INCREMENT;
-    if (neoPixelIntensity <= NEO_PIXEL_INCREMENT) {
-      isNeoPixelIncreasing = true;
-      neoPixelIntensity = 0.0f;
-    }
+  // Intensity is a triangle wave over time.
+  unsigned int rampPos = millis() % (2 * NEO_PIXEL_RAMP_MILLIS);
+  if (rampPos > NEO_PIXEL_RAMP_MILLIS) {
+    rampPos = 2 * NEO_PIXEL_RAMP_MILLIS - rampPos; // Ramping down.
   }
 
-  uint8_t colorIntensity = NEO_PIXEL_MAX_INTENSITY * neoPixelIntensity;
+  uint8_t colorIntensity = NEO_PIXEL_MAX_INTENSITY * rampPos / NEO_PIXEL_RAMP_MILLIS;
 
-  neoPixel.clear();
+  uint32_t color = 0;
   switch(macroState) {
   case MacroState::MS_RUNNING:
-    neoPixel.setPixelColor(0, neoPixelColor(0, colorIntensity, 0)); // Green
+    color = neoPixelColor(0, colorIntensity, 0); // Green
     break;
   case MacroState::MS_ADMIN:
-    neoPixel.setPixelColor(0, neoPixelColor(colorIntensity, 0, 0)); // Red
+    color = neoPixelColor(colorIntensity, 0, 0); // Red
     break;
   case MacroState::MS_WAITING:
-    neoPixel.setPixelColor(0, neoPixelColor(0, 0, colorIntensity)); // Blue
+    color = neoPixelColor(0, 0, colorIntensity); // Blue
     break;
   };
-  neoPixel.show();
+
+  if (color != neoPixelShownColor) {
+    // Only refresh the NeoPixel when its color changes (every ~128ms).
+    neoPixelShownColor = color;
+    neoPixel.clear();
+    neoPixel.setPixelColor(0, color);
+    neoPixel.show();
+  }
 }
 
 static void printWhyLastReset() {
@@ -170,13 +226,32 @@ void setup() {
   // Print current config'd brightness to dbg console.
   printCurrentBrightness();
 
-  // Set up PWM on PWM_PORT_GROUP:PWM_PORT_PIN via TCC0.
-  pwmTimer.setupTcc();
+  // Load the program for EF_PROGRAM from EEPROM.
+  setupEffectProgram();
+
+  // Compute the brightness fade curves.
+  setupFadeCurves();
+
+  // Set up PWM on PWM_PORT_GROUP:PWM_PORT_PIN via TCC0, and on the pins of any other zones.
+  for (PwmTimer *zoneTimer : pwmZoneTimers) {
+    zoneTimer->setupTcc();
+  }
+  if constexpr (SUBFRAME_FLICKER_ENABLED) {
+    setupSubFrameFlicker();
+  }
 
   // Define signs and map them to I/O channels.
   setupSigns(parallelBank0, parallelBank1);
   setupSentences(); // Define collections of signs for each sentence.
 
+  // Show frames on the playback timer from here on.
+  setupFramePlayback();
+
+  // Sleep between events without the millisecond SysTick interrupt.
+  if constexpr (TICKLESS_IDLE_ENABLED) {
+    setupIdleSleep();
+  }
+
   // Initialize random seed for random choices of button assignment
   // and sentence/animation combos to show. Analog read from A3 (disconnected/floating).
   randomSeed(analogRead(3));
@@ -189,18 +264,9 @@ void setup() {
   // Decide whether to begin in RUNNING (i.e. "DARK") mode or WAITING (DARK==0; daylight).
   initialDarkSensorRead();
 
-  // Runtime validation of our config: the number of button handler functions must match
-  // the number of (addressable) effects and sentences defined. Otherwise, we either left one out,
-  // or something more dangerous, like defined a sentence button for an invalid sentence id.
-  if (numUserButtonFns() != NUM_ADDRESSABLE_EFFECTS + sentences.size()) {
-    DBGPRINTU("*** WARNING: User button handler function array has inconsistent size:", numUserButtonFns());
-    DBGPRINTU("  Addressable Effect enum count:", NUM_ADDRESSABLE_EFFECTS);
-    DBGPRINTU("  Sentence array length:", sentences.size());
-    DBGPRINTU("  Expected button handler array length:", NUM_ADDRESSABLE_EFFECTS + sentences.size());
-    DBGPRINTU("  Actual button handler array length:", numUserButtonFns());
-  } else {
-    DBGPRINTU("Buttons initialized from handler array of size:", numUserButtonFns());
-  }
+  // (The button handler array is checked against the effect registry and sentence count
+  // at compile time.)
+  DBGPRINTU("Buttons initialized from handler array of size:", numUserButtonFns());
 
   // Set up WDT failsafe.
   if constexpr (WATCHDOG_ENABLED) {
@@ -214,8 +280,8 @@ void setMacroStateRunning() {
   macroState = MacroState::MS_RUNNING;
 
   // Clear locked effect/sentence.
-  remainingLockedSentenceMillis = 0;
-  remainingLockedEffectMillis = 0;
+  isSentenceLocked = false;
+  isEffectLocked = false;
 
   // Reset any prior temperature rise.
   mainSentenceTemperature = MAIN_SENTENCE_BASE_TEMPERATURE;
@@ -224,8 +290,8 @@ void setMacroStateRunning() {
   lastSentenceId = INVALID_SENTENCE_ID;
 
   // Reset any animation state.
-  activeAnimation.stop();
-  clearOnDeckAnimationParams();
+  activeAnimation->stop();
+  clearAnimationQueue();
 
   // Attach a random assortment of button handlers.
   attachStandardButtonHandlers();
@@ -236,7 +302,7 @@ void setMacroStateWaiting() {
   macroState = MacroState::MS_WAITING;
   // Buttons can enter admin mode but do not change sign effect.
   attachWaitModeButtonHandlers();
-  activeAnimation.stop();
+  activeAnimation->stop();
   allSignsOff();
   // TODO(aaron): Put the ATSAMD51 to sleep for a while?
   // TODO(aaron): If we do go to sleep, we need to enable an interrupt to watch for the
@@ -245,28 +311,45 @@ void setMacroStateWaiting() {
   // day).
 }
 
+// Times (per micros()) at which the inputs are next due to be polled.
+static unsigned long nextButtonPollMicros = 0;
+static unsigned long nextDarkSensorPollMicros = 0;
+
+/** Return true if the deadline has been reached as of 'now'. (Safe across micros() wraparound.) */
+static inline bool isDue(unsigned long deadline, unsigned long now) {
+  return (long)(now - deadline) >= 0;
+}
+
+/** Return the micros from 'now' until the deadline, or 0 if it has already passed. */
+static inline unsigned long microsUntil(unsigned long deadline, unsigned long now) {
+  return isDue(deadline, now) ? 0 : deadline - now;
+}
+
 /**
- * Sleep for the appropriate amount of time to make each loop iteration
- * take an equal LOOP_MICROS microseconds of time.
+ * Sleep until the next event the loop must handle: the next button or DARK sensor poll, or
+ * the next visible change in the active animation. The CPU idles in the meantime, woken only by
+ * the sleep timer at the deadline and by the interrupts that have work to do (see
+ * idleSleep.h). When it's woken by the frame playback timer, it writes out the signs for the
+ * frame just shown.
  */
-static inline void sleepLoopIncrement(unsigned long loopStartMicros) {
-  unsigned long curMicros = micros();
-  unsigned long delayTime = LOOP_MICROS;
-  if (curMicros < loopStartMicros) {
-    // Clock wraparound happened mid-loop. Pretend the loop was zero-duration.
-    curMicros = loopStartMicros;
-  }
-  unsigned long loopExecDuration = curMicros - loopStartMicros;
+static inline void sleepUntilNextEvent(unsigned long loopStartMicros) {
+  unsigned long now = micros();
+  unsigned long loopExecDuration = now - loopStartMicros;
   if (loopExecDuration > LOOP_MICROS) {
-    delayTime = 0; // The loop actually exceeded the target interval. No need to sleep.
     DBGPRINTU("*** WARNING: Late loop iteration: microseconds =", loopExecDuration);
-  } else {
-    delayTime -= loopExecDuration; // Subtract loop runtime from total sleep.
   }
 
-  // DBGPRINTU("loop iteration time in microseconds =", loopExecDuration);
-  if (delayTime > 0) {
-    delayMicroseconds(delayTime);
+  unsigned long sleepMicros = min(microsUntil(nextButtonPollMicros, now),
+      microsUntil(nextDarkSensorPollMicros, now));
+  if (macroState != MacroState::MS_WAITING) {
+    sleepMicros = min(sleepMicros, (unsigned long)activeAnimation->getMicrosToNextChange());
+  }
+
+  unsigned long wakeMicros = now + sleepMicros;
+  while (!isDue(wakeMicros, now)) {
+    idleSleep(wakeMicros - now);
+    showPlayedFrameSigns();
+    now = micros();
   }
 }
 
@@ -290,13 +373,11 @@ static void validateAnimationParams(Effect &newEffect, unsigned int &newSentence
 }
 
 /**
- * Choose the next animation to run.
+ * Choose the next animation to run, after those already in the queue.
  *
  * Populates newEffect, newSentenceId, and newFlags with the parameters necessary to begin
  * the animation.
  *
- * - If the "on deck" state is valid, this is used (sentence, effect, and flags), and the on deck
- *   state is cleared.
  * - If an effect or sentence id is locked, that locked element will be used. Unlocked
  *   element(s) are selected by the normal algorithm that follows:
  * - The sentence is either the main message, or a randomly-chosen sentence.
@@ -311,23 +392,7 @@ static void validateAnimationParams(Effect &newEffect, unsigned int &newSentence
  *   Each possible flag has its own probability weighting.
  */
 static void chooseNextAnimation(Effect &newEffect, unsigned int &newSentenceId, uint32_t &newFlags) {
-
-  if (onDeckSentenceId != INVALID_SENTENCE_ID && onDeckEffect != Effect::EF_NO_EFFECT) {
-    // We teed up a state 'on deck' for use after the last animation finished, as part of
-    // an animation chain. Its time has now come.
-    newSentenceId = onDeckSentenceId;
-    newEffect = onDeckEffect;
-    newFlags = onDeckFlags;
-
-    // Clear the on-deck state so it doesn't get used endlessly.
-    clearOnDeckAnimationParams();
-
-    // Validate on deck state and conform it if necessary.
-    validateAnimationParams(newEffect, newSentenceId);
-    return;
-  }
-
-  if (remainingLockedEffectMillis > 0) {
+  if (isEffectLocked) {
     // Use the effect locked in by user.
     newEffect = lockedEffect;
   } else {
@@ -335,7 +400,7 @@ static void chooseNextAnimation(Effect &newEffect, unsigned int &newSentenceId,
     newEffect = randomEffect();
   }
 
-  if (remainingLockedSentenceMillis > 0) {
+  if (isSentenceLocked) {
     // Use the sentence locked in by user.
     newSentenceId = lockedSentenceId;
   } else {
@@ -382,52 +447,101 @@ static void chooseNextAnimation(Effect &newEffect, unsigned int &newSentenceId,
   newFlags = newAnimationFlags(newEffect, newSentence);
 }
 
-/** Main loop body when we're in the MS_RUNNING macro state. */
-static void loopStateRunning() {
+/**
+ * Take one step toward having the upcoming animations ready: fill in the head of the queue,
+ * plan it in nextAnimation, or choose another animation to follow. Returns false if there's
+ * nothing left to do.
+ */
+static bool stepAnimationPlanning() {
+  if (animationQueueCount == 0 || (isNextAnimationPlanned && animationQueueCount < ANIMATION_QUEUE_LEN)) {
+    Effect newEffect;
+    unsigned int newSentenceId;
+    uint32_t newFlags;
+    chooseNextAnimation(newEffect, newSentenceId, newFlags);
+    enqueueAnimation(newSentenceId, newEffect, newFlags, false);
+    return true;
+  } else if (!isNextAnimationPlanned) {
+    const QueuedAnimation &queued = animationQueue[animationQueueHead];
+    const Sentence &newSentence = sentences[queued.sentenceId];
+
+    DBGPRINT("Planning next animation for sentence:");
+    newSentence.toDbgPrint();
+    debugPrintEffect(queued.effect);
+
+    // Plan the new animation for the recommended amt of time.
+    nextAnimation->setParameters(newSentence, queued.effect, queued.flags, 0);
+    isNextAnimationPlanned = true;
+    return true;
+  }
 
-  // Update cool-down on user choice locks.
-  remainingLockedEffectMillis = (remainingLockedEffectMillis > LOOP_MILLIS) ?
-      remainingLockedEffectMillis - LOOP_MILLIS : 0;
+  return false;
+}
 
-  remainingLockedSentenceMillis = (remainingLockedSentenceMillis > LOOP_MILLIS) ?
-      remainingLockedSentenceMillis - LOOP_MILLIS : 0;
+/** Start the animation at the head of the queue. */
+static void startNextAnimation() {
+  // This normally happened in the slack time of the last animation; if not, catch up now.
+  while (!isNextAnimationPlanned) {
+    stepAnimationPlanning();
+  }
 
+  swap(activeAnimation, nextAnimation);
+  animationQueueHead = (animationQueueHead + 1) % ANIMATION_QUEUE_LEN;
+  animationQueueCount--;
+  isNextAnimationPlanned = false;
+  activeAnimation->start();
+}
 
-  if (activeAnimation.isRunning()) {
-    // We're currently in an animation; just advance the next frame.
-    activeAnimation.next();
-    return;
-  }
+/** Main loop body when we're in the MS_RUNNING macro state. */
+static void loopStateRunning() {
 
-  // Current animation is done. Need to choose a new one.
-  Effect newEffect;
-  unsigned int newSentenceId;
-  uint32_t newFlags;
-  chooseNextAnimation(newEffect, newSentenceId, newFlags);
-  const Sentence &newSentence = sentences[newSentenceId]; // validity guaranteed by chooseNext().
+  // Expire user choice locks. Animations chosen under the lock are discarded too.
+  unsigned int now = millis();
+  if (isEffectLocked && now - effectLockStartMillis >= EFFECT_LOCK_MILLIS) {
+    isEffectLocked = false;
+    discardChosenAnimations();
+  }
 
-  DBGPRINT("Setting up new animation for sentence:");
-  newSentence.toDbgPrint();
-  debugPrintEffect(newEffect);
+  if (isSentenceLocked && now - sentenceLockStartMillis >= SENTENCE_LOCK_MILLIS) {
+    isSentenceLocked = false;
+    discardChosenAnimations();
+  }
 
-  // Start the new animation for the recommended amt of time.
-  activeAnimation.setParameters(newSentence, newEffect, newFlags, 0);
-  activeAnimation.start();
+  if (activeAnimation->isRunning()) {
+    // We're currently in an animation; advance the next frame. If there's time to spare before
+    // the frame after, use it to prepare what comes next.
+    activeAnimation->next();
+    if (activeAnimation->getMicrosToNextChange() >= PLANNING_STEP_MICROS) {
+      stepAnimationPlanning();
+    }
+    return;
+  }
 
-  // Track the sentence id associated with the newly-started animation,
-  // so next time through we don't show it twice in a row (unless it's locked).
-  lastSentenceId = newSentenceId;
+  // Current animation is done; on to the next one.
+  startNextAnimation();
 }
 
 void loop() {
   unsigned int loopStartMicros = micros();
 
+  // If a frame was shown while the last iteration ran, its signs are due now.
+  showPlayedFrameSigns();
+
   // Tell WDT we're still alive. (Required once per 2 seconds; this loop targets 10ms loop time.)
   Watchdog.reset();
 
-  // Poll buttons and dark sensor every loop.
-  pollButtons();
-  pollDarkSensor();
+  // Collect all sign changes made during this iteration; they're written out once, below.
+  beginSignFrame();
+
+  // Poll buttons and dark sensor when due.
+  if (isDue(nextButtonPollMicros, loopStartMicros)) {
+    nextButtonPollMicros = loopStartMicros + BUTTON_POLL_MICROS;
+    pollButtons();
+  }
+
+  if (isDue(nextDarkSensorPollMicros, loopStartMicros)) {
+    nextDarkSensorPollMicros = loopStartMicros + DARK_SENSOR_POLL_MICROS;
+    pollDarkSensor();
+  }
 
   updateNeoPixel(); // Display current macroState on NeoPixel.
   logSignStatus();
@@ -441,10 +555,7 @@ void loop() {
     loopStateAdmin();
     break;
   case MacroState::MS_WAITING:
-    // Definitionally nothing to do in the waiting state...
-    // TODO - instead of loops of short-sleep & polling the dark sensor every 10ms,
-    // we should put the system into a lower-power mode and query every minute or so
-    // or wait for an interrupt to wake us.
+    // Definitionally nothing to do in the waiting state; we only wake to poll the inputs.
     break;
   default:
     DBGPRINTU("*** ERROR: Unknown MacroState:", (unsigned int)macroState);
@@ -452,14 +563,18 @@ void loop() {
     setMacroStateRunning();
   }
 
-  // At the end of each loop iteration, sleep until this iteration is LOOP_MICROS long.
-  sleepLoopIncrement(loopStartMicros);
+  // Send this frame's sign changes to the I2C sign banks: at most one write per bank.
+  commitSignFrame();
+
+  // Sleep until there's something more to do.
+  sleepUntilNextEvent(loopStartMicros);
 }
 
 /** "Lock in" the specified effect for the next few seconds. */
 void lockEffect(const Effect e) {
   lockedEffect = e;
-  remainingLockedEffectMillis = EFFECT_LOCK_MILLIS;
+  isEffectLocked = true;
+  effectLockStartMillis = millis();
 
   if ((unsigned int)lockedEffect > (unsigned int)MAX_EFFECT_ID) {
     DBGPRINTU("Invalid effect id for lock:", (unsigned int)lockedEffect);
@@ -470,16 +585,19 @@ void lockEffect(const Effect e) {
   DBGPRINTU("Locked effect id:", (unsigned int)lockedEffect);
   debugPrintEffect(lockedEffect);
 
-  // Start a new animation with the chosen effect and current sentence.
-  activeAnimation.stop();
-  activeAnimation.setParameters(activeAnimation.getSentence(), lockedEffect, 0, 0);
-  activeAnimation.start();
+  // Start a new animation with the chosen effect and current sentence. The animations chosen
+  // to follow it are chosen again, with the lock.
+  discardChosenAnimations();
+  activeAnimation->stop();
+  activeAnimation->setParameters(activeAnimation->getSentence(), lockedEffect, 0, 0);
+  activeAnimation->start();
 }
 
 /** "Lock in" the specified sentence for the next few seconds. */
 void lockSentence(const unsigned int sentenceId) {
   lockedSentenceId = sentenceId;
-  remainingLockedSentenceMillis = SENTENCE_LOCK_MILLIS;
+  isSentenceLocked = true;
+  sentenceLockStartMillis = millis();
 
   if (lockedSentenceId >= sentences.size()) {
     DBGPRINTU("Invalid sentence id for lock:", lockedSentenceId);
@@ -489,9 +607,11 @@ void lockSentence(const unsigned int sentenceId) {
 
   DBGPRINTU("Locked sentence id:", lockedSentenceId);
 
-  // Start a new animation with the chosen sentence and current effect.
-  activeAnimation.stop();
-  activeAnimation.setParameters(sentences[lockedSentenceId], activeAnimation.getEffect(), 0, 0);
-  activeAnimation.start();
+  // Start a new animation with the chosen sentence and current effect. The animations chosen
+  // to follow it are chosen again, with the lock.
+  discardChosenAnimations();
+  activeAnimation->stop();
+  activeAnimation->setParameters(sentences[lockedSentenceId], activeAnimation->getEffect(), 0, 0);
+  activeAnimation->start();
 }
 
@@ -9,6 +9,7 @@
 //#define DBG_START_PAUSED
 
 #include <Arduino.h>
+#include <array>
 #include <vector>
 
 #include <I2CParallel.h>
@@ -19,12 +20,21 @@
 using namespace std;
 
 #include "lib/samd51pwm.h"
+#include "lib/samd51tc.h"
+#include "lib/spscring.h"
+#include "lib/codematcher.h"
 #include "lib/smarteeprom.h"
 #include "sign.h"
 #include "sentence.h"
 #include "buttons.h"
 #include "adminState.h"
 #include "saveconfig.h"
+#include "compositor.h"
+#include "subFrameFlicker.h"
+#include "fade.h"
+#include "framePlayback.h"
+#include "idleSleep.h"
+#include "effectProgram.h"
 #include "animation.h"
 #include "darkSensor.h"
 
@@ -41,13 +51,53 @@ constexpr bool WATCHDOG_ENABLED = true;
 // the debug console.
 constexpr bool REPORT_ANALOG_DARK_SENSOR = false;
 
+// Set REPORT_OVERLAY_COSTS to true to time each animation overlay layer, and report the
+// worst case on the debug console at the end of each animation.
+constexpr bool REPORT_OVERLAY_COSTS = false;
+
+// Set SUBFRAME_FLICKER_ENABLED to false to flicker signs only at the main loop frame rate,
+// without the sub-frame flicker timer interrupt.
+constexpr bool SUBFRAME_FLICKER_ENABLED = true;
+
+// Set REPORT_SUBFRAME_FLICKER_COSTS to true to time the sub-frame flicker interrupt, and report
+// the worst case on the debug console at the end of each animation.
+constexpr bool REPORT_SUBFRAME_FLICKER_COSTS = false;
+
+// Set BUTTON_INTERRUPTS_ENABLED to false to read every button on every poll, rather than only
+// after the button bank's INT line or a button's gpio pin has recorded an edge.
+constexpr bool BUTTON_INTERRUPTS_ENABLED = true;
+
+// Set IMMEDIATE_BUTTON_PRESSES to false to register a button press only after it has held for
+// the debounce interval, rather than as soon as two samples agree on it (see
+// ButtonDebouncer::poll()).
+constexpr bool IMMEDIATE_BUTTON_PRESSES = true;
+
+// Set TICKLESS_IDLE_ENABLED to false to idle with the SysTick interrupt running, which wakes
+// the CPU every millisecond.
+constexpr bool TICKLESS_IDLE_ENABLED = true;
+
 // Number of DARK readings to average together to get a useful reading.
 constexpr uint8_t AVG_NUM_DARK_SAMPLES = 32;
 
-/** Every loop iteration lasts for 10ms. */
+/**
+ * The main loop sleeps until the next event it must handle: a visible change in the active
+ * animation or the next poll of the inputs. Brightness ramps are rendered with one frame every
+ * 10ms. An iteration that takes longer than that is reported as late. Frames are shown on a
+ * 10ms timer tick, FRAME_LEAD_TICKS after they're rendered (see framePlayback.h).
+ */
 constexpr unsigned int LOOP_MICROS = 10 * 1000;
 constexpr unsigned int LOOP_MILLIS = LOOP_MICROS / 1000;
 
+/** Buttons are polled every 20ms. (Comfortably within the 25ms debounce interval.) */
+constexpr unsigned int BUTTON_POLL_MICROS = 20 * 1000;
+/**
+ * Buttons are only read when an interrupt records an edge, or while one is debouncing. In case
+ * an edge is missed, they're also read once a second regardless.
+ */
+constexpr unsigned int BUTTON_SAFETY_POLL_MICROS = 1000 * 1000;
+/** The DARK sensor is sampled every 50ms; AVG_NUM_DARK_SAMPLES samples make one reading. */
+constexpr unsigned int DARK_SENSOR_POLL_MICROS = 50 * 1000;
+
 /** The Watchdog timer resets the MCU if not pinged once per 2 seconds. */
 constexpr unsigned int WATCHDOG_TIMEOUT_MILLIS = 2000;
 
@@ -65,9 +115,10 @@ void lockEffect(const Effect e);
 /** "Lock in" the specified sentence for the next few seconds. */
 void lockSentence(const unsigned int sentenceId);
 
-/** Set animation parameters to use after current animation finishes. */
-void setOnDeckAnimationParams(unsigned int sentenceId, Effect ef, uint32_t flags);
-void clearOnDeckAnimationParams();
+/** Run the specified animation after the current one finishes, instead of any chosen so far. */
+void queueNextAnimation(unsigned int sentenceId, Effect ef, uint32_t flags);
+/** Discard all upcoming animations; the next ones will be chosen afresh. */
+void clearAnimationQueue();
 
 // The top-level state machine of the system: it's either running, waiting for nightfall, or in
 // admin mode. Other state machines controlling LED signs, etc. are only valid in certain macro
@@ -86,9 +137,12 @@ extern void setMacroStateRunning();
 /** Switch to MS_WAITING MacroState. */
 extern void setMacroStateWaiting();
 
-/** The global PWM timer. */
+/** The global PWM timer. (The timer of PWM zone 0.) */
 extern PwmTimer pwmTimer;
 
+/** The PWM timer of each PWM zone; see getPwmZoneSigns() for the signs in each zone. */
+extern PwmTimer *const pwmZoneTimers[NUM_PWM_ZONES];
+
 /**
  * Pack r/g/b channels for a neopixel into a 32-bit word.
  */
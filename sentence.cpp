@@ -6,70 +6,59 @@
 
 vector<Sentence> sentences;
 
-// Helper function for setupSentences()
-static unsigned int _sentence(const unsigned int signVector) {
-  static unsigned int nextSentenceId = 0;
+// The signs lit by each sentence, indexed by sentence id.
+static constexpr unsigned int SENTENCE_SIGN_BITS[] = {
+  // sentence id 0 is "You don't have to like all the art!"
+  S_YOU | S_DONT | S_HAVE | S_TO | S_LIKE | S_ALL | S_THE | S_ART | S_BANG,
 
-  sentences.emplace_back(nextSentenceId, signVector);
-  return nextSentenceId++;
-}
+  S_DO | S_YOU | S_LIKE | S_THE | S_ART | S_QUESTION,
+  S_DO | S_YOU | S_LIKE | S_ART | S_QUESTION,
+  S_LIKE | S_THE | S_ART | S_BANG,
+  S_LOVE | S_THE | S_ART | S_BANG,
+  S_HATE | S_THE | S_ART | S_BANG,
+  S_WHY | S_DO | S_YOU | S_LIKE | S_ART | S_QUESTION,
+  S_WHY | S_DO | S_YOU | S_LOVE | S_ART | S_QUESTION,
+  S_WHY | S_DO | S_YOU | S_HATE | S_ART | S_QUESTION,
+  S_WHY | S_LIKE | S_ALL | S_ART | S_QUESTION,
+  S_DO | S_YOU | S_LOVE | S_QUESTION,
+  S_DO | S_YOU | S_HATE | S_QUESTION,
+  S_WHY | S_DO | S_YOU | S_LOVE | S_QUESTION,
+  S_WHY | S_DO | S_YOU | S_HATE | S_QUESTION,
+  S_I | S_LIKE | S_ART | S_BANG,
+  S_I | S_LOVE | S_ART | S_BANG,
+  S_YOU | S_DONT | S_HAVE | S_TO | S_LIKE | S_BM | S_BANG,
+  S_WHY | S_DO | S_YOU | S_LOVE | S_BM | S_QUESTION,
+};
+
+static_assert(std::size(SENTENCE_SIGN_BITS) == NUM_SENTENCES,
+    "NUM_SENTENCES must match the number of sentences defined");
 
-// sentence id for "You don't have to like all the art!"
-static unsigned int MAIN_MSG_SENTENCE_ID = 0;
+static constexpr unsigned int MAIN_MSG_SENTENCE_ID = 0;
 unsigned int mainMsgId() {
   return MAIN_MSG_SENTENCE_ID;
 }
 
 void setupSentences() {
-  MAIN_MSG_SENTENCE_ID =
-      _sentence( S_YOU | S_DONT | S_HAVE | S_TO | S_LIKE | S_ALL | S_THE | S_ART | S_BANG );
-
-  _sentence( S_DO | S_YOU | S_LIKE | S_THE | S_ART | S_QUESTION );
-  _sentence( S_DO | S_YOU | S_LIKE | S_ART | S_QUESTION );
-  _sentence( S_LIKE | S_THE | S_ART | S_BANG );
-  _sentence( S_LOVE | S_THE | S_ART | S_BANG );
-  _sentence( S_HATE | S_THE | S_ART | S_BANG );
-  _sentence( S_WHY | S_DO | S_YOU | S_LIKE | S_ART | S_QUESTION );
-  _sentence( S_WHY | S_DO | S_YOU | S_LOVE | S_ART | S_QUESTION );
-  _sentence( S_WHY | S_DO | S_YOU | S_HATE | S_ART | S_QUESTION );
-  _sentence( S_WHY | S_LIKE | S_ALL | S_ART | S_QUESTION );
-  _sentence( S_DO | S_YOU | S_LOVE | S_QUESTION );
-  _sentence( S_DO | S_YOU | S_HATE | S_QUESTION );
-  _sentence( S_WHY | S_DO | S_YOU | S_LOVE | S_QUESTION );
-  _sentence( S_WHY | S_DO | S_YOU | S_HATE | S_QUESTION );
-  _sentence( S_I | S_LIKE | S_ART | S_BANG );
-  _sentence( S_I | S_LOVE | S_ART | S_BANG );
-  _sentence( S_YOU | S_DONT | S_HAVE | S_TO | S_LIKE | S_BM | S_BANG );
-  _sentence( S_WHY | S_DO | S_YOU | S_LOVE | S_BM | S_QUESTION );
+  sentences.clear();
+  sentences.reserve(NUM_SENTENCES);
+  for (unsigned int id = 0; id < NUM_SENTENCES; id++) {
+    sentences.emplace_back(id, SENTENCE_SIGN_BITS[id]);
+  }
 }
 
 /** Turn on the signs for sentence */
 void Sentence::enable() {
-  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
-    if (_signs & (1 << i)) {
-      signs[i].enable();
-    }
-  }
+  signBoard.enable(_signs);
 }
 
 /** Turn on the signs for sentence (and only those signs) */
 void Sentence::enableExclusively() {
-  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
-    if (_signs & (1 << i)) {
-      signs[i].enable();
-    } else {
-      signs[i].disable(); // Not part of this sentence.
-    }
-  }
+  signBoard.setEnabled(_signs);
 }
 
 /** Turn signs participating in this sentence off. */
 void Sentence::disable() {
-  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
-    if (_signs & (1 << i)) {
-      signs[i].disable(); // It's an element of this sentence; turn it off.
-    }
-  }
+  signBoard.disable(_signs);
 }
 
 /** Return the sign id of the n'th word in the sentence. (n=1 for 'the first word') */
@@ -35,6 +35,9 @@ private:
   unsigned int _signs;
 };
 
+// The number of sentences defined in sentence.cpp. (User buttons are generated for each.)
+constexpr unsigned int NUM_SENTENCES = 18;
+
 extern vector<Sentence> sentences;
 extern "C" void setupSentences();
 extern "C" unsigned int mainMsgId();
@@ -1,207 +1,416 @@
 // (C) Copyright 2022 Aaron Kimball
 //
-// Sign class and SignChannel class implementations.
-// Sign channels pull a pin high to enable a sign, low to turn it off.
+// SignBoard and Sign class implementations.
+// Sign bank pins are pulled high to enable a sign, low to turn it off.
 
 #include "like-the-art.h"
 
-static uint32_t activeSignBits = 0; // bit array tracking active signs.
 static uint32_t loggedActiveSignBits = 0; // bit array tracking active signs @ last time logged.
 
-void I2CSignChannel::setup() {
-  disable();
+// Sign I/O wiring, indexed by sign id.
+// Note that the production channels are NOT wired in order in I2C; see schematic.
+static constexpr SignPin PRODUCTION_SIGN_PINS[NUM_SIGNS] = {
+  { 0, 2 }, // WHY
+  { 0, 0 }, // DO
+  { 0, 1 }, // YOU
+  { 0, 3 }, // I
+  { 0, 4 }, // DON'T
+  { 0, 6 }, // HAVE
+  { 0, 5 }, // TO
+  { 0, 7 }, // LOVE
+
+  { 1, 2 }, // LIKE
+  { 1, 0 }, // HATE
+  { 1, 1 }, // )'(
+  { 1, 3 }, // ALL
+  { 1, 4 }, // THE
+  { 1, 6 }, // ART
+  { 1, 5 }, // !
+  { 1, 7 }, // ?
+};
+
+// The breadboard model only has 4 standard THT LEDs, on bank 0. Other signs are unconnected.
+static constexpr SignPin BREADBOARD_SIGN_PINS[NUM_SIGNS] = {
+  { 0, 0 }, // WHY
+  { 0, 1 }, // DO
+  { 0, 2 }, // YOU
+  { 0, 3 }, // I
+
+  { NO_SIGN_BANK, 0 }, // DON'T
+  { NO_SIGN_BANK, 0 }, // HAVE
+  { NO_SIGN_BANK, 0 }, // TO
+  { NO_SIGN_BANK, 0 }, // LOVE
+  { NO_SIGN_BANK, 0 }, // LIKE
+  { NO_SIGN_BANK, 0 }, // HATE
+  { NO_SIGN_BANK, 0 }, // )'(
+  { NO_SIGN_BANK, 0 }, // ALL
+  { NO_SIGN_BANK, 0 }, // THE
+  { NO_SIGN_BANK, 0 }, // ART
+  { NO_SIGN_BANK, 0 }, // !
+  { NO_SIGN_BANK, 0 }, // ?
+};
+
+static constexpr const SignPin *SIGN_PINS =
+    IS_TARGET_PRODUCTION ? PRODUCTION_SIGN_PINS : BREADBOARD_SIGN_PINS;
+
+// PWM zone membership: the signs whose brightness each zone's PWM output (pwmZoneTimers[zone])
+// gates. Both boards have a single PWM output, NAND'd with every sign's control line.
+static constexpr uint32_t PRODUCTION_PWM_ZONE_SIGNS[NUM_PWM_ZONES] = {
+  ALL_SIGNS_MASK,
+};
+
+static constexpr uint32_t BREADBOARD_PWM_ZONE_SIGNS[NUM_PWM_ZONES] = {
+  ALL_SIGNS_MASK,
+};
+
+static constexpr const uint32_t *PWM_ZONE_SIGNS =
+    IS_TARGET_PRODUCTION ? PRODUCTION_PWM_ZONE_SIGNS : BREADBOARD_PWM_ZONE_SIGNS;
+
+/** Return true if every sign is in exactly one PWM zone. */
+static constexpr bool isPwmZonePartition(const uint32_t *zoneSigns) {
+  uint32_t seen = 0;
+  for (unsigned int zone = 0; zone < NUM_PWM_ZONES; zone++) {
+    if (zoneSigns[zone] & seen) {
+      return false;
+    }
+    seen |= zoneSigns[zone];
+  }
+  return seen == ALL_SIGNS_MASK;
+}
+
+static_assert(isPwmZonePartition(PRODUCTION_PWM_ZONE_SIGNS), "Each sign needs exactly one PWM zone");
+static_assert(isPwmZonePartition(BREADBOARD_PWM_ZONE_SIGNS), "Each sign needs exactly one PWM zone");
+
+// Sign bit arrays are converted to bank output bytes 4 signs at a time.
+// BANK_OUTPUT.bits[n][x] holds the bank bytes (bank 0 in the low byte, bank 1 in the high byte)
+// that light up the signs whose ids are set in nibble `x` of the n'th nibble of a sign bit array.
+static_assert(NUM_SIGN_BANKS == 2, "Bank output table packs exactly 2 banks into a uint16_t");
+static constexpr unsigned int NUM_SIGN_NIBBLES = NUM_SIGNS / 4;
+
+struct BankOutputTable {
+  uint16_t bits[NUM_SIGN_NIBBLES][16];
+};
+
+static constexpr BankOutputTable makeBankOutputTable() {
+  BankOutputTable table = {};
+  for (unsigned int n = 0; n < NUM_SIGN_NIBBLES; n++) {
+    for (unsigned int x = 0; x < 16; x++) {
+      for (unsigned int k = 0; k < 4; k++) {
+        const SignPin &signPin = SIGN_PINS[4 * n + k];
+        if ((x & (1 << k)) && signPin.bank != NO_SIGN_BANK) {
+          table.bits[n][x] |= (1 << signPin.pin) << (8 * signPin.bank);
+        }
+      }
+    }
+  }
+  return table;
 }
 
-void I2CSignChannel::enable() {
-  _bus.setOr(_bit); // Set our pin bit high.
+static constexpr BankOutputTable BANK_OUTPUT = makeBankOutputTable();
+
+// Estimated current surge as each sign switches on, in mA, indexed by sign id. It's about
+// proportional to the length of neon in the sign, so this counts letters.
+static constexpr unsigned int TURN_ON_MA_PER_LETTER = 50;
+static constexpr uint16_t SIGN_TURN_ON_MA[NUM_SIGNS] = {
+  3 * TURN_ON_MA_PER_LETTER, // WHY
+  2 * TURN_ON_MA_PER_LETTER, // DO
+  3 * TURN_ON_MA_PER_LETTER, // YOU
+  1 * TURN_ON_MA_PER_LETTER, // I
+  4 * TURN_ON_MA_PER_LETTER, // DON'T
+  4 * TURN_ON_MA_PER_LETTER, // HAVE
+  2 * TURN_ON_MA_PER_LETTER, // TO
+  4 * TURN_ON_MA_PER_LETTER, // LOVE
+
+  4 * TURN_ON_MA_PER_LETTER, // LIKE
+  4 * TURN_ON_MA_PER_LETTER, // HATE
+  3 * TURN_ON_MA_PER_LETTER, // )'(
+  3 * TURN_ON_MA_PER_LETTER, // ALL
+  3 * TURN_ON_MA_PER_LETTER, // THE
+  3 * TURN_ON_MA_PER_LETTER, // ART
+  1 * TURN_ON_MA_PER_LETTER, // !
+  1 * TURN_ON_MA_PER_LETTER, // ?
+};
+
+static constexpr unsigned int NUM_BANK_PINS = 8 * NUM_SIGN_BANKS;
+
+struct BankPinTurnOnTable {
+  uint16_t milliamps[NUM_BANK_PINS]; // Indexed by bank bit.
+};
+
+static constexpr BankPinTurnOnTable makeBankPinTurnOnTable() {
+  BankPinTurnOnTable table = {};
+  for (unsigned int signId = 0; signId < NUM_SIGNS; signId++) {
+    const SignPin &signPin = SIGN_PINS[signId];
+    if (signPin.bank != NO_SIGN_BANK) {
+      table.milliamps[8 * signPin.bank + signPin.pin] = SIGN_TURN_ON_MA[signId];
+    }
+  }
+  return table;
 }
 
-void I2CSignChannel::disable() {
-  _bus.setAnd(~_bit); // Set our pin bit low.
+static constexpr BankPinTurnOnTable BANK_PIN_TURN_ON = makeBankPinTurnOnTable();
+
+static_assert(TURN_ON_STAGGER_SLOTS >= 1, "Signs need at least one slot to turn on in");
+
+SignBoard::SignBoard():
+    _enabled(0), _dimmed(0), _modulatedOff(0), _modulated(0), _level(), _levelError(),
+    _isInFrame(false),
+    _banks(), _committedBankState() {
+  resetLevels();
 }
 
+void SignBoard::setup(I2CParallel &bank0, I2CParallel &bank1) {
+  _enabled = 0;
+  resetLevels();
 
-void GpioSignChannel::setup() {
-  pinMode(_pin, OUTPUT);
-  disable();
+  // setup() has already written 0 (all signs off) to each bank.
+  _banks[0] = &bank0;
+  _banks[1] = &bank1;
+  for (unsigned int i = 0; i < NUM_SIGN_BANKS; i++) {
+    _committedBankState[i] = 0;
+  }
 }
 
-void GpioSignChannel::enable() {
-  digitalWrite(_pin, 1);
+void SignBoard::enable(uint32_t signBits) {
+  _enabled |= signBits;
+  if (!_isInFrame) {
+    _writeBanks();
+  }
 }
 
-void GpioSignChannel::disable() {
-  digitalWrite(_pin, 0);
+void SignBoard::disable(uint32_t signBits) {
+  _enabled &= ~signBits;
+  if (!_isInFrame) {
+    _writeBanks();
+  }
 }
 
+void SignBoard::setEnabled(uint32_t signBits, uint32_t scope) {
+  _enabled = (_enabled & ~scope) | (signBits & scope & ALL_SIGNS_MASK);
+  if (!_isInFrame) {
+    _writeBanks();
+  }
+}
 
-Sign::Sign(unsigned int id, const char *const word, SignChannel *channel):
-    _id(id), _word(std::move(word)), _channel(channel),
-    _enabled(false), _active(false), _flickerThreshold(FLICKER_ALWAYS_ON) {
+void SignBoard::setLevels(const uint8_t *levels, uint32_t scope) {
+  scope &= ALL_SIGNS_MASK;
+  while (scope) {
+    unsigned int signId = __builtin_ctz(scope);
+    scope &= scope - 1; // Clear lowest set bit.
 
-  channel->setup();
+    uint8_t level = levels[signId];
+    _level[signId] = level;
+    if (level < SIGN_LEVEL_FULL) {
+      _dimmed |= 1 << signId;
+    } else {
+      _dimmed &= ~(1 << signId);
+    }
+  }
 }
 
-// Move constructor.
-Sign::Sign(Sign &&other):
-    _id(other._id), _word(other._word), _channel(other._channel),
-    _enabled(other._enabled), _active(other._active), _flickerThreshold(other._flickerThreshold) {
-  other._channel = NULL; // So its d'tor doesn't deallocate it.
+void SignBoard::resetLevels(uint32_t scope) {
+  scope &= ALL_SIGNS_MASK;
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    if (scope & (1 << i)) {
+      _level[i] = SIGN_LEVEL_FULL;
+    }
+  }
+  _dimmed &= ~scope;
 }
 
-// Actually make sure the sign is on thru the sign channel.
-// Called by enable(), as well as flickerFrame() if flickering to on position.
-void Sign::_activate() {
-  this->_channel->enable();
-  this->_active = true;
-  activeSignBits |= 1 << _id;
+// The level a dimmed sign is modulated at: its level, or if that's below SIGN_LEVEL_MIN_DIMMED,
+// whichever of 0 and SIGN_LEVEL_MIN_DIMMED is nearer.
+static inline unsigned int modulatedLevel(uint8_t level) {
+  if (level >= SIGN_LEVEL_MIN_DIMMED) {
+    return level;
+  }
+  return (level < SIGN_LEVEL_MIN_DIMMED / 2) ? 0 : SIGN_LEVEL_MIN_DIMMED;
 }
 
-// Actually make sure the sign is off thru the sign channel.
-// Called by disable(), as well as flickerFrame() if flickering to off position.
-void Sign::_deactivate() {
-  if (NULL != this->_channel) {
-    this->_channel->disable();
+/**
+ * Advance the sigma-delta modulator by one frame: decide which lit, dimmed signs are on.
+ *
+ * Each dimmed sign accumulates its level every frame; when the accumulator reaches
+ * SIGN_LEVEL_FULL the sign is on for the frame and SIGN_LEVEL_FULL is subtracted. Over any run
+ * of frames, the sign is on in level / SIGN_LEVEL_FULL of them, to within one frame. A sign
+ * that stops being modulated has its accumulator reset to the midpoint, so that it starts
+ * afresh (and rounds to nearest) the next time.
+ */
+void SignBoard::_modulate() {
+  uint32_t modulated = _enabled & _dimmed;
+  uint32_t modulatedOff = 0;
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    if (!(modulated & (1 << i))) {
+      _levelError[i] = SIGN_LEVEL_FULL / 2;
+      continue;
+    }
+
+    unsigned int error = _levelError[i] + modulatedLevel(_level[i]);
+    if (error >= SIGN_LEVEL_FULL) {
+      error -= SIGN_LEVEL_FULL; // On for this frame.
+    } else {
+      modulatedOff |= 1 << i;
+    }
+    _levelError[i] = error;
   }
-  this->_active = false;
-  activeSignBits &= ~(1 << _id);
+
+  _modulated = modulated;
+  _modulatedOff = modulatedOff;
 }
 
-void Sign::enable() {
-  //DBGPRINTU("Enable sign:", _id);
-  //DBGPRINT(_word);
-  this->_enabled = true;
-  this->_activate();
+/**
+ * Return the lit, dimmed signs that are off for a write outside a frame, without advancing the
+ * modulator: as in the last frame for the signs it modulated, and for any others (newly lit or
+ * newly dimmed), as the modulator's next step will start them.
+ */
+uint32_t SignBoard::_currentModulatedOff() const {
+  uint32_t modulated = _enabled & _dimmed;
+  uint32_t modulatedOff = _modulatedOff & _modulated & modulated;
+  uint32_t fresh = modulated & ~_modulated;
+  while (fresh) {
+    unsigned int signId = __builtin_ctz(fresh);
+    fresh &= fresh - 1; // Clear lowest set bit.
+    if (_levelError[signId] + modulatedLevel(_level[signId]) < SIGN_LEVEL_FULL) {
+      modulatedOff |= 1 << signId;
+    }
+  }
+  return modulatedOff;
 }
 
-void Sign::disable() {
-  //DBGPRINTU("Disable sign:", _id);
-  //DBGPRINT(_word);
-  this->_enabled = false;
-  this->_deactivate();
+/**
+ * Start collecting sign changes for the current frame (loop iteration). Until
+ * commitFrame() is called, sign changes only update the board state.
+ */
+void SignBoard::beginFrame() {
+  _isInFrame = true;
 }
 
-// Flickering generates a random number 'r' between 0 and FLICKER_RANGE_MAX.
-// If r > threshold, the light is on (assuming its already enabled). Setting the
-// threshold to 0 (FLICKER_ALWAYS_ON) ensures it's always enabled.
-void Sign::flickerFrame() {
-  if (!this->_enabled) {
-    return; // Disabled signs do not flicker. They are shut off.
+/**
+ * Queue the sign changes collected since beginFrame() for playback as one frame. Dimmed signs
+ * are modulated once per committed frame.
+ */
+void SignBoard::commitFrame() {
+  _isInFrame = false;
+  _modulate();
+  queueOutputFrame(_bankBits());
+}
+
+// Convert the active sign bits to bank output bytes (bank 0 in the low byte).
+uint32_t SignBoard::_bankBits() const {
+  uint32_t active = _enabled & ~(_modulatedOff & _dimmed);
+  return BANK_OUTPUT.bits[0][active & 0xF]
+      | BANK_OUTPUT.bits[1][(active >> 4) & 0xF]
+      | BANK_OUTPUT.bits[2][(active >> 8) & 0xF]
+      | BANK_OUTPUT.bits[3][(active >> 12) & 0xF];
+}
+
+void SignBoard::showBankBits(uint32_t bankBits) {
+  // Switch on as many signs per slot as the surge allows; turning signs off can't hurt, so
+  // that all happens in the first slot.
+  uint32_t shownBankBits = _committedBankBits();
+  for (unsigned int slot = 1; slot < TURN_ON_STAGGER_SLOTS; slot++) {
+    uint32_t stageBankBits = turnOnStage(shownBankBits, bankBits);
+    if (stageBankBits == bankBits) {
+      break;
+    }
+    _writeBankBits(stageBankBits);
+    shownBankBits = stageBankBits;
+    delayMicroseconds(TURN_ON_SLOT_MICROS);
   }
 
-  if (_flickerThreshold == FLICKER_ALWAYS_ON && !this->_active && this->_enabled) {
-    // This is for some reason not active, despite being enabled -- and we have
-    // disabled the flicker effect. Just activate it and leave. (Case can be hit if flicker threshold
-    // is updated while the sign is enabled but has flickered off.)
-    _activate();
-    return;
+  _writeBankBits(bankBits);
+}
+
+uint32_t SignBoard::_committedBankBits() const {
+  uint32_t bankBits = 0;
+  for (unsigned int i = 0; i < NUM_SIGN_BANKS; i++) {
+    bankBits |= _committedBankState[i] << (8 * i);
   }
+  return bankBits;
+}
 
-  unsigned int flickerRand = random(FLICKER_RANGE_MAX);
-  if (flickerRand >= _flickerThreshold) {
-    // Sign should be active
-    if (!_active) {
-      // ... and it isn't. Switch that.
-      _activate();
+void SignBoard::_writeBankBits(uint32_t bankBits) {
+  for (unsigned int i = 0; i < NUM_SIGN_BANKS; i++) {
+    uint8_t bankState = (bankBits >> (8 * i)) & 0xFF;
+    if (NULL != _banks[i] && bankState != _committedBankState[i]) {
+      _banks[i]->write(bankState);
+      _committedBankState[i] = bankState;
     }
-  } else if (_active) {
-    // Sign should be inactive... Yet, it is active. Switch that.
-    _deactivate();
   }
 }
 
-Sign::~Sign() {
-  if (NULL != _channel) {
-    delete _channel;
-  }
+// Write the board state out to the banks right away.
+void SignBoard::_writeBanks() {
+  _modulatedOff = _currentModulatedOff();
+  showBankBits(_bankBits());
 }
 
-vector<Sign> signs;
-
-const char *const W_WHY = "WHY";
-const char *const W_DO = "DO";
-const char *const W_YOU = "YOU";
-const char *const W_I = "I";
-const char *const W_DONT = "DON'T";
-const char *const W_HAVE = "HAVE";
-const char *const W_TO = "TO";
-const char *const W_LOVE = "LOVE";
-const char *const W_LIKE = "LIKE";
-const char *const W_HATE = "HATE";
-const char *const W_BM = ")'(";
-const char *const W_ALL = "ALL";
-const char *const W_THE = "THE";
-const char *const W_ART = "ART";
-const char *const W_BANG = "!";
-const char *const W_QUESTION = "?";
+SignBoard signBoard;
+
+void beginSignFrame() {
+  signBoard.beginFrame();
+}
+
+void commitSignFrame() {
+  signBoard.commitFrame();
+}
+
+static constexpr const char *W_WHY = "WHY";
+static constexpr const char *W_DO = "DO";
+static constexpr const char *W_YOU = "YOU";
+static constexpr const char *W_I = "I";
+static constexpr const char *W_DONT = "DON'T";
+static constexpr const char *W_HAVE = "HAVE";
+static constexpr const char *W_TO = "TO";
+static constexpr const char *W_LOVE = "LOVE";
+static constexpr const char *W_LIKE = "LIKE";
+static constexpr const char *W_HATE = "HATE";
+static constexpr const char *W_BM = ")'(";
+static constexpr const char *W_ALL = "ALL";
+static constexpr const char *W_THE = "THE";
+static constexpr const char *W_ART = "ART";
+static constexpr const char *W_BANG = "!";
+static constexpr const char *W_QUESTION = "?";
+
+array<Sign, NUM_SIGNS> signs = {
+  Sign(0, W_WHY),
+  Sign(1, W_DO),
+  Sign(2, W_YOU),
+  Sign(3, W_I),
+  Sign(4, W_DONT),
+  Sign(5, W_HAVE),
+  Sign(6, W_TO),
+  Sign(7, W_LOVE),
+  Sign(8, W_LIKE),
+  Sign(9, W_HATE),
+  Sign(10, W_BM),
+  Sign(11, W_ALL),
+  Sign(12, W_THE),
+  Sign(13, W_ART),
+  Sign(14, W_BANG),
+  Sign(15, W_QUESTION),
+};
 
 static constexpr unsigned int SENTENCE_LEN = 64; // At most 62 chars + \0 in the sentence.
 static char activeSentence[SENTENCE_LEN];
 
 void setupSigns(I2CParallel &bank0, I2CParallel &bank1) {
-  // Define Signs with bindings to I/O channels.
-  signs.clear();
-  signs.reserve(NUM_SIGNS);
-
+  // Bind the sign board to its I/O channels. The sign id -> pin mapping is in SIGN_PINS.
   if constexpr (IS_TARGET_PRODUCTION) {
-    // Setup the signs array to have channels reflecting the actual
-    // production connections through the PCBs to all 16 LED neon signs.
     DBGPRINT("Initializing PRODUCTION sign channel bindings (x16).");
-
-    // Note that the production channels are NOT wired in order in I2C; see schematic.
-    signs.emplace_back(0, W_WHY,  new I2CSC(bank0, 2));
-    signs.emplace_back(1, W_DO,   new I2CSC(bank0, 0));
-    signs.emplace_back(2, W_YOU,  new I2CSC(bank0, 1));
-    signs.emplace_back(3, W_I,    new I2CSC(bank0, 3));
-    signs.emplace_back(4, W_DONT, new I2CSC(bank0, 4));
-    signs.emplace_back(5, W_HAVE, new I2CSC(bank0, 6));
-    signs.emplace_back(6, W_TO,   new I2CSC(bank0, 5));
-    signs.emplace_back(7, W_LOVE, new I2CSC(bank0, 7));
-
-    signs.emplace_back(8, W_LIKE,       new I2CSC(bank1, 2));
-    signs.emplace_back(9, W_HATE,       new I2CSC(bank1, 0));
-    signs.emplace_back(10, W_BM,        new I2CSC(bank1, 1));
-    signs.emplace_back(11, W_ALL,       new I2CSC(bank1, 3));
-    signs.emplace_back(12, W_THE,       new I2CSC(bank1, 4));
-    signs.emplace_back(13, W_ART,       new I2CSC(bank1, 6));
-    signs.emplace_back(14, W_BANG,      new I2CSC(bank1, 5));
-    signs.emplace_back(15, W_QUESTION,  new I2CSC(bank1, 7));
   } else {
-    // !(IS_TARGET_PRODUCTION) case; breadboard-mode.
-    // Setup the signs array to have channels reflecting the
-    // connections available on the breadboard model (4 standard THT LEDs).
     DBGPRINT("Initializing BREADBOARD sign channel bindings (x4).");
-
-    signs.emplace_back(0, W_WHY,  new I2CSC(bank0, 0));
-    signs.emplace_back(1, W_DO,   new I2CSC(bank0, 1));
-    signs.emplace_back(2, W_YOU,  new I2CSC(bank0, 2));
-    signs.emplace_back(3, W_I,    new I2CSC(bank0, 3));
-
-    signs.emplace_back(4, W_DONT,       new NSC());
-    signs.emplace_back(5, W_HAVE,       new NSC());
-    signs.emplace_back(6, W_TO,         new NSC());
-    signs.emplace_back(7, W_LOVE,       new NSC());
-    signs.emplace_back(8, W_LIKE,       new NSC());
-    signs.emplace_back(9, W_HATE,       new NSC());
-    signs.emplace_back(10, W_BM,        new NSC());
-    signs.emplace_back(11, W_ALL,       new NSC());
-    signs.emplace_back(12, W_THE,       new NSC());
-    signs.emplace_back(13, W_ART,       new NSC());
-    signs.emplace_back(14, W_BANG,      new NSC());
-    signs.emplace_back(15, W_QUESTION,  new NSC());
   }
+
+  signBoard.setup(bank0, bank1);
 }
 
 void allSignsOff() {
-  for (auto &sign : signs) {
-    sign.disable();
-  }
+  signBoard.setEnabled(0);
 }
 
 void allSignsOn() {
-  for (auto &sign : signs) {
-    sign.enable();
-  }
+  signBoard.setEnabled(ALL_SIGNS_MASK);
 }
 
 /** Print a log msg w/ the signs that would be active in the specified sentence. */
@@ -225,6 +434,7 @@ void logSentence(uint32_t sentenceBits) {
 
 /** Print a log msg w/ the current active signs. */
 void logSignStatus() {
+  uint32_t activeSignBits = signBoard.getEnabled();
   if (activeSignBits == loggedActiveSignBits) {
     // State hasn't changed since last loop. Don't log.
     return;
@@ -234,28 +444,113 @@ void logSignStatus() {
   logSentence(activeSignBits);
 }
 
-// Set the PWM level to the current configured maximum brightness
-void configMaxPwm() {
-  pwmTimer.setDutyCycle(getMaxPwmDutyCycle());
+unsigned int turnOnMilliamps(uint32_t bankBits) {
+  unsigned int milliamps = 0;
+  for (; bankBits != 0; bankBits &= bankBits - 1) {
+    milliamps += BANK_PIN_TURN_ON.milliamps[__builtin_ctz(bankBits)];
+  }
+  return milliamps;
+}
+
+uint32_t turnOnStage(uint32_t shownBankBits, uint32_t bankBits) {
+  // Everything but the signs turning on goes straight to bankBits. Then add each turn-on, in
+  // bank bit order, that still fits under MAX_TURN_ON_SLOT_MA. The first one is always added, so
+  // that every slot makes progress.
+  uint32_t turningOn = bankBits & ~shownBankBits;
+  uint32_t stageBankBits = bankBits & ~turningOn;
+  unsigned int milliamps = 0;
+  for (; turningOn != 0; turningOn &= turningOn - 1) {
+    unsigned int bit = __builtin_ctz(turningOn);
+    unsigned int signMilliamps = BANK_PIN_TURN_ON.milliamps[bit];
+    if (milliamps == 0 || milliamps + signMilliamps <= MAX_TURN_ON_SLOT_MA) {
+      stageBankBits |= 1 << bit;
+      milliamps += signMilliamps;
+    }
+  }
+
+  return stageBankBits;
+}
+
+uint32_t getPwmZoneSigns(unsigned int zone) {
+  return PWM_ZONE_SIGNS[zone];
 }
 
-// Return the configured max-brightness PWM duty cycle
-uint32_t getMaxPwmDutyCycle() {
-  uint32_t freq = pwmTimer.getPwmFreq();
+// The max-brightness PWM duty cycle of each zone, for the maxBrightness setting it was computed for.
+static bool isMaxPwmConfigured = false;
+static uint8_t maxPwmBrightness;
+static uint32_t maxPwmDutyCycle[NUM_PWM_ZONES];
+
+// When the maxBrightness setting changes, the max duty cycle fades to the new setting. The
+// fade's levels are fractions of the full PWM range, so the one fade serves every zone.
+static Fade maxPwmFade;
+static uint32_t maxPwmFadeStartMillis;
+static bool isMaxPwmFadeActive = false;
 
-  switch (fieldConfig.maxBrightness) {
+/** Return the PWM duty cycle for a maxBrightness setting, given the timer's duty cycle range. */
+static uint32_t dutyCycleForBrightness(uint8_t maxBrightness, uint32_t range) {
+  switch (maxBrightness) {
   case BRIGHTNESS_FULL: // 100%
-    return freq;
+    return range;
   case BRIGHTNESS_NORMAL: // 70%
-    return (freq * 70) / 100;
+    return (range * 70) / 100;
   case BRIGHTNESS_POWER_SAVE_1: // 60%
-    return (freq * 60) / 100;
+    return (range * 60) / 100;
   case BRIGHTNESS_POWER_SAVE_2: // 50%
-    return freq / 2;
+    return range / 2;
   default: // Unknown PWM frequency required... Just use 'normal' (70%)
     DBGPRINT("*** WARNING: invalid fieldConfig.maxBrightness; using normal/70%");
-    return (freq * 70) / 100;
+    return (range * 70) / 100;
+  }
+}
+
+/** Return a zone's max duty cycle now, partway through the fade if there is one. */
+static uint32_t currentMaxPwmDutyCycle(unsigned int zone) {
+  if (isMaxPwmFadeActive) {
+    uint32_t fadeMillis = millis() - maxPwmFadeStartMillis;
+    if (!maxPwmFade.isDone(fadeMillis)) {
+      return ((uint64_t)pwmZoneTimers[zone]->getDutyCycleRange() * maxPwmFade.levelAt(fadeMillis))
+          >> KF_LEVEL_SHIFT;
+    }
+    isMaxPwmFadeActive = false;
   }
 
+  return maxPwmDutyCycle[zone];
+}
+
+// Set the PWM level of every zone in the frame to the current configured maximum brightness
+void configMaxPwm() {
+  for (unsigned int zone = 0; zone < NUM_PWM_ZONES; zone++) {
+    setFrameDutyCycle(zone, getMaxPwmDutyCycle(zone));
+  }
+}
+
+// Return the configured max-brightness PWM duty cycle of a zone. For MAX_BRIGHTNESS_FADE_MILLIS
+// after fieldConfig.maxBrightness changes, this fades from the old setting to the new one.
+uint32_t getMaxPwmDutyCycle(unsigned int zone) {
+  if (!isMaxPwmConfigured || fieldConfig.maxBrightness != maxPwmBrightness) {
+    uint32_t fromDutyCycle = currentMaxPwmDutyCycle(0);
+    maxPwmBrightness = fieldConfig.maxBrightness;
+    for (unsigned int z = 0; z < NUM_PWM_ZONES; z++) {
+      maxPwmDutyCycle[z] = dutyCycleForBrightness(maxPwmBrightness, pwmZoneTimers[z]->getDutyCycleRange());
+    }
+
+    if (isMaxPwmConfigured) {
+      // The setting changed (not just loaded at boot); fade to it. (Every zone is at the same
+      // fraction of its range, so zone 0 speaks for all of them.)
+      uint32_t range = pwmZoneTimers[0]->getDutyCycleRange();
+      maxPwmFade.start(((uint64_t)fromDutyCycle << KF_LEVEL_SHIFT) / range,
+          ((uint64_t)maxPwmDutyCycle[0] << KF_LEVEL_SHIFT) / range, MAX_BRIGHTNESS_FADE_MILLIS, FADE_GAMMA);
+      maxPwmFadeStartMillis = millis();
+      isMaxPwmFadeActive = true;
+    }
+    isMaxPwmConfigured = true;
+  }
+
+  return currentMaxPwmDutyCycle(zone);
+}
+
+// Return true if the max brightness is fading to a new setting.
+bool isMaxPwmFading() {
+  return isMaxPwmFadeActive;
 }
 
@@ -1,131 +1,164 @@
 // (c) Copyright 2022 Aaron Kimball
 //
-// Definition of a single light-up sign
+// Definition of the board of light-up signs, and of a single sign.
 
 #ifndef _SIGN_H
 #define _SIGN_H
 
+constexpr unsigned int NUM_SIGNS = 16;
+constexpr unsigned int MAX_SIGN_ID = NUM_SIGNS - 1;
+constexpr unsigned int INVALID_SIGN_ID = NUM_SIGNS + 1;
+
+// Bit array with every sign on the board set.
+constexpr uint32_t ALL_SIGNS_MASK = (1 << NUM_SIGNS) - 1;
+
+// Number of I2C parallel bus expanders (PCF8574) that drive signs; 8 signs each.
+constexpr unsigned int NUM_SIGN_BANKS = 2;
+
 /**
- * A SignChannel turns a single sign on or off.
+ * The I/O connection for a sign: a pin on one of the sign banks.
  */
-class SignChannel {
-public:
-  SignChannel() { };
-  virtual ~SignChannel() {};
-  virtual void setup() = 0;
-  virtual void enable() = 0;
-  virtual void disable() = 0;
+struct SignPin {
+  uint8_t bank; // Index of the PCF8574 bank, or NO_SIGN_BANK if the sign isn't connected.
+  uint8_t pin;  // Pin within the bank (0..7).
 };
 
-/**
- * I2CSignChannel is a SignChannel that communicates over I2C to a specific
- * pin on an I2C parallel bus expander (PCF8574).
- */
-class I2CSignChannel: public SignChannel {
-public:
-  I2CSignChannel(I2CParallel &bus, unsigned int pin): _bus(bus), _pin(pin), _bit(1 << pin) { };
+constexpr uint8_t NO_SIGN_BANK = 0xFF;
 
-  virtual void setup();
-  virtual void enable();
-  virtual void disable();
-private:
-  I2CParallel &_bus;
-  const unsigned int _pin;
-  const unsigned int _bit;
-};
+// Virtual brightness of a single sign, relative to the PWM brightness of its zone.
+constexpr uint8_t SIGN_LEVEL_FULL = 255;
 
+// The lowest level at which a dimmed sign is modulated. The modulator switches signs once a
+// frame (100 Hz); below half brightness the 'on' frames come less than 50 times a second, and
+// the sign visibly strobes instead of looking dim. Lower levels are shown at 0 or at this level,
+// whichever is nearer.
+constexpr uint8_t SIGN_LEVEL_MIN_DIMMED = 128;
+
+// Number of PWM zones: independent PWM outputs (see pwmZoneTimers), each gating the brightness
+// of its own group of signs. Zone membership is set in sign.cpp.
+constexpr unsigned int NUM_PWM_ZONES = 1;
+static_assert(NUM_PWM_ZONES >= 1 && NUM_PWM_ZONES <= 8, "Zone sets are 8-bit masks");
+
+// When the max brightness setting changes, the PWM fades to the new level over this long.
+constexpr unsigned int MAX_BRIGHTNESS_FADE_MILLIS = 400;
+
+// Signs switching on together draw a surge of current that can brown out the board. When the
+// signs turning on in one write would draw more than MAX_TURN_ON_SLOT_MA (by the estimates in
+// sign.cpp), they're switched on over up to TURN_ON_STAGGER_SLOTS slots, TURN_ON_SLOT_MICROS
+// apart. The last slot switches on whatever is left. (All of it is over well within a frame.)
+constexpr unsigned int TURN_ON_STAGGER_SLOTS = 4;
+constexpr unsigned int TURN_ON_SLOT_MICROS = 500;
+constexpr unsigned int MAX_TURN_ON_SLOT_MA = 600;
 
 /**
- * GpioSignChannel is a SignChannel that directly drives an Arduino digital output pin
+ * The SignBoard holds the state of all signs as bit arrays (bit n is sign id n) and drives
+ * them through the sign banks.
+ *
+ * Outside of a sign frame, every change is written through to the I2C banks immediately.
+ * Between beginFrame() and commitFrame(), changes only accumulate in the board state; the
+ * commit then queues the frame for playback (see framePlayback.h). When it's shown, each bank
+ * is written at most once, and banks whose byte did not change are skipped.
+ *
+ * Brightness is set by PWM, shared by every sign in a PWM zone, but each sign also has a
+ * virtual brightness level. A lit sign below SIGN_LEVEL_FULL is switched on in that fraction of the
+ * committed frames by a first-order sigma-delta modulator: each frame adds the level to the
+ * sign's error accumulator, and the sign is on in frames where the accumulator reaches
+ * SIGN_LEVEL_FULL. The on/off pattern is deterministic and spreads the 'on' frames as evenly
+ * as possible. (Levels below SIGN_LEVEL_MIN_DIMMED are rounded to 0 or to it.) The modulator
+ * only changes which bank bits are committed. Changes written outside a frame keep the last
+ * frame's on/off choice for the signs it modulated, and don't advance the modulator.
  */
-class GpioSignChannel: public SignChannel {
+class SignBoard {
 public:
-  GpioSignChannel(unsigned int pin): _pin(pin) { };
+  SignBoard();
 
-  virtual void setup();
-  virtual void enable();
-  virtual void disable();
-private:
-  const unsigned int _pin;
-};
+  // Bind to the I2C bus expanders. All signs start off.
+  void setup(I2CParallel &bank0, I2CParallel &bank1);
 
-/**
- * A sign channel that doesn't actually do anything. For debugging, of course.
- */
-class NullSignChannel: public SignChannel {
-  virtual void setup() {};
-  virtual void enable() {};
-  virtual void disable() {};
-};
+  void enable(uint32_t signBits);     // Turn the specified signs on.
+  void disable(uint32_t signBits);    // Turn the specified signs off.
+  // Turn on exactly the specified signs within 'scope'; all other signs in scope are turned off.
+  // Signs outside of scope are unaffected.
+  void setEnabled(uint32_t signBits, uint32_t scope = ALL_SIGNS_MASK);
+
+  uint32_t getEnabled() const { return _enabled; };
+
+  // Set the virtual brightness of each sign within 'scope' from levels[] (indexed by sign id).
+  void setLevels(const uint8_t *levels, uint32_t scope = ALL_SIGNS_MASK);
+  void resetLevels(uint32_t scope = ALL_SIGNS_MASK); // Set signs in scope to SIGN_LEVEL_FULL.
+  uint8_t getLevel(unsigned int signId) const { return _level[signId]; };
+  // True if any lit sign is dimmed by the modulator; each frame may then change the output.
+  bool isModulating() const { return (_enabled & _dimmed) != 0; };
+
+  void beginFrame();
+  void commitFrame();
+
+  // Write the sign bank bytes (bank 0 in the low byte) to any bank whose byte changed,
+  // staggering the signs that turn on (see TURN_ON_STAGGER_SLOTS).
+  void showBankBits(uint32_t bankBits);
 
-constexpr unsigned int FLICKER_RANGE_MAX = 1000;
-constexpr unsigned int FLICKER_ALWAYS_ON = 0;
-constexpr unsigned int FLICKER_ALWAYS_OFF = FLICKER_RANGE_MAX;
+private:
+  void _modulate();
+  uint32_t _currentModulatedOff() const;
+  uint32_t _bankBits() const;
+  uint32_t _committedBankBits() const;
+  void _writeBankBits(uint32_t bankBits);
+  void _writeBanks();
+
+  uint32_t _enabled; // Signs that are on.
+  uint32_t _dimmed;  // Signs with a level below SIGN_LEVEL_FULL.
+  uint32_t _modulatedOff; // Lit signs that the modulator holds off in the current frame.
+  uint32_t _modulated; // Signs that the modulator stepped in the current frame.
+  uint8_t _level[NUM_SIGNS];
+  uint8_t _levelError[NUM_SIGNS]; // Sigma-delta accumulator for each dimmed sign.
+  bool _isInFrame;
+  I2CParallel *_banks[NUM_SIGN_BANKS];
+  uint8_t _committedBankState[NUM_SIGN_BANKS]; // Byte most recently written to each bank.
+};
 
-// Sub-range within (ALWAYS_ON, RANGE_MAX] used when assigning flicker potential
-// to a sign determined to be flickering for the subsequent animation.
-constexpr unsigned int FLICKER_ASSIGN_MIN = 50;
-constexpr unsigned int FLICKER_ASSIGN_MAX = 300;
+extern SignBoard signBoard;
 
 /**
- * A Sign defines a single light-up sign. Signs are enabled or disabled through SignChannels.
+ * A Sign is a thin handle on a single light-up sign within the signBoard.
  */
 class Sign {
 public:
-  Sign(unsigned int id, const char *const word, SignChannel *sc);
-  Sign(Sign &&other) noexcept;
-  ~Sign();
+  constexpr Sign(unsigned int id, const char *const word): _id(id), _word(word) { };
 
-  void enable(); // Turn the sign on (unless flickering switches it momentarily off)
-  void disable(); // Turn the sign off.
-
-  // Flickering generates a random number 'r' between 0 and FLICKER_RANGE_MAX.
-  // If r > threshold, the light is on (assuming its already enabled). Setting the
-  // threshold to 0 (FLICKER_ALWAYS_ON) ensures it's always enabled.
-  void setFlickerThreshold(unsigned int threshold) { _flickerThreshold = threshold; };
-  unsigned int getFlickerThreshold() const { return _flickerThreshold; };
-  void flickerFrame();
+  void enable() { signBoard.enable(1 << _id); }; // Turn the sign on.
+  void disable() { signBoard.disable(1 << _id); }; // Turn the sign off.
 
   // If the sign was commanded to be on via enable.
-  bool isEnabled() const { return _enabled; };
-  // If the sign is actually supposed to be on (enabled and not flickered off).
-  bool isActive() const { return _active; };
+  bool isEnabled() const { return signBoard.getEnabled() & (1 << _id); };
 
   const char *word() const { return _word; };
   unsigned int id() const { return _id; };
 
 private:
-  void _activate();
-  void _deactivate();
-
-  const unsigned int _id;
-  const char *const _word;
-  SignChannel *_channel;
-  bool _enabled; // Whether this sign is nominally on
-  bool _active;  // Whether this sign is truly on (nominally on AND flicker is in 'on' state).
-  unsigned int _flickerThreshold;
+  unsigned int _id;
+  const char *_word;
 };
 
-#define I2CSC I2CSignChannel
-#define GPIOSC GpioSignChannel
-#define NSC NullSignChannel
-
-extern vector<Sign> signs;
+extern array<Sign, NUM_SIGNS> signs;
 
 extern "C" {
   extern void setupSigns(I2CParallel &bank0, I2CParallel &bank1);
+  extern void beginSignFrame(); // Defer sign output changes until commitSignFrame().
+  extern void commitSignFrame(); // Write all deferred sign changes to the sign banks.
   extern void allSignsOff(); // Turn all signs off
   extern void allSignsOn(); // Turn all signs on
-  extern void configMaxPwm(); // Set current PWM level to the configured max brightness.
-  extern uint32_t getMaxPwmDutyCycle();
+  extern void configMaxPwm(); // Set the PWM level of every zone to the configured max brightness.
+  extern uint32_t getMaxPwmDutyCycle(unsigned int zone = 0); // Of the zone's PWM timer.
+  extern uint32_t getPwmZoneSigns(unsigned int zone); // Signs whose brightness the zone sets.
+  // The bank bytes to show in the next turn-on slot, on the way from shownBankBits to bankBits.
+  extern uint32_t turnOnStage(uint32_t shownBankBits, uint32_t bankBits);
+  // Estimated current surge when the signs at the specified bank bits switch on, in mA.
+  extern unsigned int turnOnMilliamps(uint32_t bankBits);
+  extern bool isMaxPwmFading(); // True while a change to the max brightness fades in.
   extern void logSentence(uint32_t sentenceBits);
   extern void logSignStatus(); // Log the current sign status.
 }
 
-constexpr unsigned int NUM_SIGNS = 16;
-constexpr unsigned int MAX_SIGN_ID = NUM_SIGNS - 1;
-constexpr unsigned int INVALID_SIGN_ID = NUM_SIGNS + 1;
-
 // Bitfield-based one shot ids for each sign.
 constexpr unsigned int S_WHY = 1 << 0;
 constexpr unsigned int S_DO = 1 << 1;
@@ -144,7 +177,7 @@ constexpr unsigned int S_ART = 1 << 13;
 constexpr unsigned int S_BANG = 1 << 14;
 constexpr unsigned int S_QUESTION = 1 << 15;
 
-// Indexes of each word in the `signs` vector.
+// Indexes of each word in the `signs` array.
 constexpr unsigned int IDX_WHY      = 0;
 constexpr unsigned int IDX_DO       = 1;
 constexpr unsigned int IDX_YOU      = 2;
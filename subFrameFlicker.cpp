@@ -0,0 +1,135 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Sub-frame flicker interrupt.
+//
+// The signs are switched by the I2C sign banks, which are only written once per main loop
+// frame; an interrupt can't touch them. The PWM outputs that feed the signs can be switched off
+// at any time, though. TC3 interrupts at SUBFRAME_FLICKER_HZ and, while armed, forces every
+// PWM zone's output off in the ticks that the current plan marks as dropouts. The interrupt
+// only reads the plan's bit mask and writes the PWM pins' port config registers: no random
+// numbers, no I2C, and a fixed amount of work per tick. While disarmed, the timer is stopped,
+// so it doesn't wake the CPU for nothing.
+
+#include "like-the-art.h"
+
+static_assert((SUBFRAME_FLICKER_PLAN_TICKS & (SUBFRAME_FLICKER_PLAN_TICKS - 1)) == 0,
+    "Flicker plan length must be a power of 2");
+
+// The interrupt's own copy of the plan it's armed with; the plan it was armed from may be
+// replaced (or go away) while it's running. Only written with interrupts disabled.
+static SubFrameFlickerPlan armedPlan;
+static volatile bool isArmed = false;
+static volatile bool isForcedOff = false; // The PWM output is currently forced off.
+static unsigned int flickerTick = 0;
+static bool isTimerSetUp = false;
+
+// Longest time spent in the interrupt handler, in CPU cycles, if REPORT_SUBFRAME_FLICKER_COSTS.
+// (Doesn't include the dozen or so cycles each to enter and leave the interrupt.)
+static volatile uint32_t maxIsrCycles = 0;
+
+void makeSubFrameFlickerPlan(SubFrameFlickerPlan &plan, unsigned int threshold) {
+  memset(plan.dropouts, 0, sizeof(plan.dropouts));
+  if (threshold == FLICKER_ALWAYS_ON) {
+    return;
+  }
+
+  // The mean lit run, in ticks, shrinks toward 1 as the odds of being off rise.
+  threshold = min(threshold, FLICKER_RANGE_MAX);
+  unsigned int meanLitTicks = 1 + ((SUBFRAME_FLICKER_MAX_MEAN_LIT_TICKS - 1)
+      * (FLICKER_RANGE_MAX - threshold)) / FLICKER_RANGE_MAX;
+
+  // Alternate lit runs of 1..(2 * meanLitTicks - 1) ticks with dropouts, starting mid-run.
+  unsigned int tick = random(2 * meanLitTicks);
+  while (tick < SUBFRAME_FLICKER_PLAN_TICKS) {
+    unsigned int dropoutEnd = tick + random(1, SUBFRAME_FLICKER_MAX_DROPOUT_TICKS + 1);
+    for (; tick < dropoutEnd && tick < SUBFRAME_FLICKER_PLAN_TICKS; tick++) {
+      plan.dropouts[tick / 32] |= 1 << (tick % 32);
+    }
+    tick += random(1, 2 * meanLitTicks);
+  }
+}
+
+static inline void setZoneOutputsForcedOff(bool isOff) {
+  for (PwmTimer *zoneTimer : pwmZoneTimers) {
+    zoneTimer->setOutputForcedOff(isOff);
+  }
+}
+
+void setupSubFrameFlicker() {
+  // Preempts the frame playback interrupt, which arms and disarms it.
+  int ret = setupPeriodicTc(TC3, 1000000 / SUBFRAME_FLICKER_HZ, 2);
+  if (ret != PERIODIC_TC_SUCCESS) {
+    DBGPRINTI("*** ERROR: Could not set up sub-frame flicker timer:", ret);
+    return;
+  }
+  isTimerSetUp = true;
+  stopPeriodicTc(TC3); // Until it's armed.
+}
+
+void setSubFrameFlicker(const SubFrameFlickerPlan *plan) {
+  // Called from the frame playback interrupt as well as the main loop.
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (isSubFrameFlickerArmedWith(plan)) {
+    __set_PRIMASK(primask);
+    return;
+  }
+
+  if (isTimerSetUp && plan == NULL) {
+    stopPeriodicTc(TC3);
+  } else if (isTimerSetUp && !isArmed) {
+    restartPeriodicTc(TC3);
+  }
+  if (plan != NULL) {
+    armedPlan = *plan;
+  }
+  isArmed = plan != NULL;
+  if (plan == NULL && isForcedOff) {
+    // Don't leave the signs dark until the next tick.
+    setZoneOutputsForcedOff(false);
+    isForcedOff = false;
+  }
+  __set_PRIMASK(primask);
+}
+
+bool isSubFrameFlickerArmedWith(const SubFrameFlickerPlan *plan) {
+  if (plan == NULL || !isArmed) {
+    return plan == NULL && !isArmed;
+  }
+  return memcmp(plan->dropouts, armedPlan.dropouts, sizeof(armedPlan.dropouts)) == 0;
+}
+
+void logSubFrameFlickerCosts() {
+  if constexpr (REPORT_SUBFRAME_FLICKER_COSTS) {
+    uint32_t cycles = maxIsrCycles;
+    DBGPRINTU("Sub-frame flicker interrupt, max cycles per tick:", cycles);
+    DBGPRINTU("  Max CPU share (in 0.01%):", cycles * SUBFRAME_FLICKER_HZ / (F_CPU / 10000));
+  }
+}
+
+extern "C" void TC3_Handler() {
+  uint32_t startCycles = 0;
+  if constexpr (REPORT_SUBFRAME_FLICKER_COSTS) {
+    startCycles = SysTick->VAL;
+  }
+
+  TC3->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+
+  unsigned int tick = (flickerTick + 1) & (SUBFRAME_FLICKER_PLAN_TICKS - 1);
+  flickerTick = tick;
+  bool isOff = isArmed && (armedPlan.dropouts[tick / 32] & (1 << (tick % 32)));
+  if (isOff != isForcedOff) {
+    setZoneOutputsForcedOff(isOff);
+    isForcedOff = isOff;
+  }
+
+  if constexpr (REPORT_SUBFRAME_FLICKER_COSTS) {
+    // SysTick counts down, and wraps around to LOAD every millisecond.
+    uint32_t endCycles = SysTick->VAL;
+    uint32_t cycles = (startCycles >= endCycles)
+        ? startCycles - endCycles : startCycles + SysTick->LOAD + 1 - endCycles;
+    if (cycles > maxIsrCycles) {
+      maxIsrCycles = cycles;
+    }
+  }
+}
@@ -0,0 +1,51 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Sub-frame flicker: a timer interrupt that briefly drops out the PWM output between
+// main-loop frames, so flickering signs sputter like a failing neon tube rather than strobing
+// at the frame rate.
+
+#ifndef _SUB_FRAME_FLICKER_H
+#define _SUB_FRAME_FLICKER_H
+
+// The flicker interrupt runs from TC3 at this rate; each tick may change the output.
+constexpr unsigned int SUBFRAME_FLICKER_HZ = 1000;
+
+// A flicker plan covers this many ticks, then repeats. (A power of 2.)
+constexpr unsigned int SUBFRAME_FLICKER_PLAN_TICKS = 256;
+
+// Dropouts last 1 to this many ticks. The lit runs between them are longer for signs with a
+// lower flicker threshold.
+constexpr unsigned int SUBFRAME_FLICKER_MAX_DROPOUT_TICKS = 3;
+constexpr unsigned int SUBFRAME_FLICKER_MAX_MEAN_LIT_TICKS = 32;
+
+/**
+ * A precomputed sequence of PWM dropouts for the flicker interrupt. Bit n (of dropouts[n / 32])
+ * is set if the PWM output is forced off in tick n.
+ */
+struct SubFrameFlickerPlan {
+  uint32_t dropouts[SUBFRAME_FLICKER_PLAN_TICKS / 32];
+};
+
+/**
+ * Fill in a flicker plan for signs with the given flicker threshold (FLICKER_ALWAYS_ON to
+ * FLICKER_RANGE_MAX). Uses random(); call it from the main loop, never from the interrupt.
+ */
+void makeSubFrameFlickerPlan(SubFrameFlickerPlan &plan, unsigned int threshold);
+
+// Set up TC3 to interrupt at SUBFRAME_FLICKER_HZ while armed. Requires the PWM to be set up.
+void setupSubFrameFlicker();
+
+/**
+ * Arm the interrupt with a copy of a plan, or disarm it with NULL. Dropouts darken every PWM
+ * zone, so only arm it while every lit sign is flickering. (Frame playback calls this as each
+ * frame is shown; see setFrameSubFrameFlicker().)
+ */
+void setSubFrameFlicker(const SubFrameFlickerPlan *plan);
+
+// True if the interrupt is armed with the same dropouts as 'plan', or disarmed and 'plan' is NULL.
+bool isSubFrameFlickerArmedWith(const SubFrameFlickerPlan *plan);
+
+// Log the worst-case time spent in the interrupt, if REPORT_SUBFRAME_FLICKER_COSTS.
+void logSubFrameFlickerCosts();
+
+#endif // _SUB_FRAME_FLICKER_H
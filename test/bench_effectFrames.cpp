@@ -0,0 +1,108 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// What each effect costs per frame: plays every effect on every sentence, as the main loop
+// would, and times setParameters() (planning) and each next() (the per-frame step, including
+// any planner resume at a keyframe), on this machine.
+//
+//   make -C test bench
+
+#include "hostFakes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+// Plays of each effect on each sentence.
+static constexpr unsigned int NUM_REPS = 20;
+
+static I2CParallel bank0;
+static I2CParallel bank1;
+
+using BenchClock = std::chrono::steady_clock;
+
+static inline double nanosSince(BenchClock::time_point start) {
+  return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+struct EffectCost {
+  double planNanos;    // setParameters() and start(), in total.
+  std::vector<double> frameNanos; // Each next().
+  unsigned long numPlays;
+
+  // The frame cost that 'fraction' of frames come in under. (Timing on a busy machine is
+  // noisy; the median and a high percentile leave out the outliers that a mean or max would
+  // report.)
+  double frameNanosAt(double fraction) {
+    std::sort(frameNanos.begin(), frameNanos.end());
+    return frameNanos[(size_t)(fraction * (frameNanos.size() - 1))];
+  }
+};
+
+// The fraction of frames reported as the typical and the worst case.
+static constexpr double TYPICAL_FRAME_FRACTION = 0.5;
+static constexpr double WORST_FRAME_FRACTION = 0.999;
+
+static void playEffect(Animation &anim, unsigned int sentenceId, Effect effect,
+    EffectCost &cost) {
+
+  BenchClock::time_point start = BenchClock::now();
+  anim.setParameters(sentences[sentenceId], effect, 0, 0);
+  beginSignFrame();
+  anim.start();
+  commitSignFrame();
+  cost.planNanos += nanosSince(start);
+  cost.numPlays++;
+
+  while (anim.isRunning()) {
+    advanceMicros(LOOP_MICROS);
+    beginSignFrame();
+    start = BenchClock::now();
+    anim.next();
+    cost.frameNanos.push_back(nanosSince(start));
+    commitSignFrame();
+  }
+}
+
+int main() {
+  bank0.init(0 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  bank1.init(1 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  setupFadeCurves();
+  setupSigns(bank0, bank1);
+  setupSentences();
+  randomSeed(1);
+
+  Animation &anim = *activeAnimation;
+  EffectCost costs[NUM_EFFECTS] = {};
+  for (unsigned int rep = 0; rep < NUM_REPS; rep++) {
+    for (unsigned int sentenceId = 0; sentenceId < sentences.size(); sentenceId++) {
+      for (unsigned int e = 0; e < (unsigned int)Effect::EF_NO_EFFECT; e++) {
+        playEffect(anim, sentenceId, (Effect)e, costs[e]);
+      }
+    }
+  }
+
+  printf("%-20s %12s %13s %12s\n", "effect", "plan ns", "median frame", "99.9% frame");
+  EffectCost total = {};
+  for (unsigned int e = 0; e < (unsigned int)Effect::EF_NO_EFFECT; e++) {
+    EffectCost &cost = costs[e];
+    total.planNanos += cost.planNanos;
+    total.numPlays += cost.numPlays;
+    if (cost.frameNanos.empty()) {
+      // E.g. EF_PROGRAM, with no program installed.
+      printf("%-20s %12.0f %13s %12s\n", Animation::EFFECTS[e].name,
+          cost.planNanos / cost.numPlays, "-", "-");
+      continue;
+    }
+    total.frameNanos.insert(total.frameNanos.end(), cost.frameNanos.begin(),
+        cost.frameNanos.end());
+    printf("%-20s %12.0f %13.0f %12.0f\n", Animation::EFFECTS[e].name,
+        cost.planNanos / cost.numPlays, cost.frameNanosAt(TYPICAL_FRAME_FRACTION),
+        cost.frameNanosAt(WORST_FRAME_FRACTION));
+  }
+  printf("%-20s %12.0f %13.0f %12.0f\n", "all", total.planNanos / total.numPlays,
+      total.frameNanosAt(TYPICAL_FRAME_FRACTION), total.frameNanosAt(WORST_FRAME_FRACTION));
+  printf("%zu frames; sizeof(Animation) = %zu bytes\n", total.frameNanos.size(),
+      sizeof(Animation));
+  return 0;
+}
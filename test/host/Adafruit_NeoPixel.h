@@ -0,0 +1,22 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host stand-in for Adafruit_NeoPixel.
+
+#ifndef _HOST_ADAFRUIT_NEOPIXEL_H
+#define _HOST_ADAFRUIT_NEOPIXEL_H
+
+#include <stdint.h>
+
+#define NEO_GRB 0
+#define NEO_KHZ800 0
+
+class Adafruit_NeoPixel {
+public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin, int type) { };
+  void begin() { };
+  void clear() { };
+  void show() { };
+  void setPixelColor(uint16_t n, uint32_t color) { };
+};
+
+#endif // _HOST_ADAFRUIT_NEOPIXEL_H
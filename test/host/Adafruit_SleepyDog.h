@@ -0,0 +1,16 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host stand-in for Adafruit_SleepyDog.
+
+#ifndef _HOST_ADAFRUIT_SLEEPYDOG_H
+#define _HOST_ADAFRUIT_SLEEPYDOG_H
+
+class WatchdogSAMD {
+public:
+  int enable(int maxPeriodMS = 0) { return maxPeriodMS; };
+  void reset() { };
+};
+
+extern WatchdogSAMD Watchdog;
+
+#endif // _HOST_ADAFRUIT_SLEEPYDOG_H
@@ -0,0 +1,80 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host stand-in for the Arduino core: just the declarations the sketch uses. The clock, pins
+// and interrupts behind them are faked in hostFakes.cpp.
+
+#ifndef _HOST_ARDUINO_H
+#define _HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+#define LOW 0
+#define HIGH 1
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+#define A4 18
+#define AR_DEFAULT 0
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint32_t pin, uint32_t mode);
+int digitalRead(uint32_t pin);
+void digitalWrite(uint32_t pin, uint32_t val);
+int analogRead(uint32_t pin);
+void analogReference(int mode);
+
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint32_t pin, void (*callback)(), uint32_t mode);
+void detachInterrupt(uint32_t pin);
+void noInterrupts();
+void interrupts();
+
+#include "samd.h"
+
+struct PinDescription {
+  int ulPort;
+  int ulPin;
+  int ulPinType;
+  int ulPinAttribute;
+  int ulADCChannelNumber;
+  int ulPWMChannel;
+  int ulTCChannel;
+  int ulExtInt;
+};
+
+extern const PinDescription g_APinDescription[];
+
+#define PIN_ATTR_PWM_E 1
+#define PIN_ATTR_PWM_F 2
+#define PIN_ATTR_PWM_G 4
+
+struct HostSerial {
+  int available();
+  int read();
+};
+
+extern HostSerial Serial;
+
+#endif // _HOST_ARDUINO_H
@@ -0,0 +1,40 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host stand-in for the i2cparallel library. Every read() and write() is one I2C transaction;
+// the fake counts them per bank (see hostFakes.h).
+
+#ifndef _HOST_I2C_PARALLEL_H
+#define _HOST_I2C_PARALLEL_H
+
+#include <stdint.h>
+
+constexpr uint8_t I2C_PCF8574_MIN_ADDR = 0x20;
+constexpr uint32_t I2C_SPEED_STANDARD = 100000;
+constexpr uint32_t I2C_SPEED_FAST = 400000;
+
+class I2CParallel {
+public:
+  void init(uint8_t i2cAddr, uint32_t busSpeed);
+  void write(uint8_t val);
+  uint8_t read();
+  void enableInputs(uint8_t mask);
+  uint8_t getLastState() const { return hostOutput; };
+
+  // Host only: what the fake bus has seen.
+  uint8_t hostAddr = 0;
+  uint8_t hostOutput = 0;        // Last byte written.
+  uint8_t hostInputs = 0xFF;     // What read() returns. (Buttons pull their pins low.)
+  unsigned int hostWrites = 0;
+  unsigned int hostReads = 0;
+  int hostIntPin = -1;           // The gpio pin its INT output drives, if any.
+  uint8_t hostLastRead = 0xFF;   // What read() last returned.
+};
+
+struct TwoWire {
+  void begin();
+  void setClock(uint32_t freq);
+};
+
+extern TwoWire Wire;
+
+#endif // _HOST_I2C_PARALLEL_H
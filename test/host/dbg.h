@@ -0,0 +1,15 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host stand-in for PyArduinoDebug: debug output is discarded.
+
+#ifndef _HOST_DBG_H
+#define _HOST_DBG_H
+
+#define DBGSETUP()
+#define DBGPRINT(x) do { (void)(x); } while (0)
+#define DBGPRINTU(msg, val) do { (void)(msg); (void)(val); } while (0)
+#define DBGPRINTI(msg, val) do { (void)(msg); (void)(val); } while (0)
+#define DBGPRINTX(msg, val) do { (void)(msg); (void)(val); } while (0)
+#define DBGPRINTF(msg, val) do { (void)(msg); (void)(val); } while (0)
+
+#endif // _HOST_DBG_H
@@ -0,0 +1,346 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host stand-in for the ATSAMD51 CMSIS headers: the peripherals the sketch touches, as plain
+// memory. Each register has a 'reg' word and, separately, the named bits the sketch reads or
+// writes one at a time; unlike on the chip, they don't alias. Registers are pointer-sized so
+// that DMA descriptors can hold host addresses. Constants keep their CMSIS names, but only
+// some keep their values.
+
+#ifndef _HOST_SAMD_H
+#define _HOST_SAMD_H
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 120000000UL
+#endif
+
+struct HostRegBits {
+  uint32_t ENABLE, SWRST, WAVE, PER, CC0, CC1, COUNT, CTRLB, GENCTRL7, PMUXEN, DMAENABLE;
+  uint32_t LOAD, WMODE, BUSY, DONE, SEESOVF;
+};
+
+struct HostReg {
+  volatile uintptr_t reg;
+  HostRegBits bit;
+};
+
+/**
+ * A control register with a SWRST bit (bit 0). Writing SWRST resets the register to 0 at once,
+ * as if the reset had completed, and is counted.
+ */
+struct HostCtrlWord {
+  volatile uintptr_t value;
+  unsigned int hostResets;
+
+  operator uintptr_t() const { return value; }
+  HostCtrlWord &operator=(uintptr_t val) {
+    if (val & 1) {
+      value = 0;
+      hostResets++;
+    } else {
+      value = val;
+    }
+    return *this;
+  }
+  HostCtrlWord &operator|=(uintptr_t val) { return *this = value | val; }
+  HostCtrlWord &operator&=(uintptr_t val) { return *this = value & val; }
+};
+
+struct HostCtrlReg {
+  HostCtrlWord reg;
+  HostRegBits bit;
+};
+
+/** An interrupt flag register: as on the chip, writing a 1 to a flag clears it. */
+struct HostFlagWord {
+  volatile uintptr_t value;
+
+  operator uintptr_t() const { return value; }
+  HostFlagWord &operator=(uintptr_t val) {
+    value &= ~val;
+    return *this;
+  }
+};
+
+struct HostFlagReg {
+  HostFlagWord reg;
+  HostRegBits bit;
+};
+
+/**
+ * A TCC buffer register (CCBUFn). Writing it sets its valid bit in the TCC's STATUS register,
+ * until the value is copied into the register it buffers at the end of the PWM period
+ * (hostTccPeriodEnd()).
+ */
+struct HostBufWord {
+  volatile uintptr_t value;
+  volatile uintptr_t *status;
+  uintptr_t validBit;
+
+  operator uintptr_t() const { return value; }
+  HostBufWord &operator=(uintptr_t val) {
+    value = val;
+    *status |= validBit;
+    return *this;
+  }
+};
+
+struct HostBufReg {
+  HostBufWord reg;
+  HostRegBits bit;
+};
+
+struct Tcc {
+  HostReg CTRLA, CTRLBCLR, CTRLBSET, SYNCBUSY, STATUS, COUNT, WAVE, PER, PERBUF;
+  HostReg INTENCLR, INTENSET, INTFLAG, EVCTRL;
+  HostReg CC[6];
+  HostBufReg CCBUF[6];
+
+  Tcc();
+};
+
+struct TcCount16 {
+  HostReg CTRLA, CTRLBCLR, CTRLBSET, SYNCBUSY, STATUS, COUNT, WAVE;
+  HostReg INTENCLR, INTENSET, INTFLAG, EVCTRL;
+  HostReg CC[2];
+  HostReg CCBUF[2];
+};
+
+union Tc {
+  TcCount16 COUNT16;
+};
+
+struct PortGroup {
+  HostReg DIR, DIRCLR, DIRSET, OUT, OUTCLR, OUTSET, OUTTGL, IN;
+  HostReg PINCFG[32];
+  HostReg PMUX[16];
+};
+
+struct Port {
+  PortGroup Group[4];
+};
+
+struct Mclk {
+  HostReg AHBMASK, APBAMASK, APBBMASK, APBCMASK, APBDMASK;
+};
+
+struct Gclk {
+  HostReg SYNCBUSY;
+  HostReg GENCTRL[12];
+  HostReg PCHCTRL[48];
+};
+
+struct Nvmctrl {
+  HostReg CTRLA, CTRLB, INTFLAG, STATUS, ADDR, SEECFG, SEESTAT;
+};
+
+struct Rstc {
+  HostReg RCAUSE;
+};
+
+struct DmacDescriptor {
+  HostReg BTCTRL, BTCNT, SRCADDR, DSTADDR, DESCADDR;
+};
+
+struct DmacChannel {
+  HostCtrlReg CHCTRLA;
+  HostReg CHCTRLB, CHPRILVL, CHEVCTRL, CHINTENCLR, CHINTENSET;
+  HostFlagReg CHINTFLAG;
+  HostReg CHSTATUS;
+};
+
+struct Dmac {
+  HostCtrlReg CTRL;
+  HostReg CRCCTRL, SWTRIGCTRL, PRICTRL0, INTPEND, INTSTATUS, BUSYCH, PENDCH, ACTIVE;
+  HostReg BASEADDR, WRBADDR;
+  DmacChannel Channel[32];
+};
+
+struct HostSysTick {
+  volatile uint32_t CTRL, LOAD, VAL, CALIB;
+};
+
+extern Tcc *const TCC0, *const TCC1, *const TCC2, *const TCC3, *const TCC4;
+extern Tc *const TC0, *const TC1, *const TC2, *const TC3, *const TC4, *const TC5;
+extern Port *const PORT;
+extern Mclk *const MCLK;
+extern Gclk *const GCLK;
+extern Nvmctrl *const NVMCTRL;
+extern Rstc *const RSTC;
+extern Dmac *const DMAC;
+extern HostSysTick *const SysTick;
+
+// Field constructors: the value as is.
+#define HOST_FIELD(name) constexpr uint32_t name(uint32_t val) { return val; }
+HOST_FIELD(PORT_PMUX_PMUXE)
+HOST_FIELD(PORT_PMUX_PMUXO)
+HOST_FIELD(GCLK_GENCTRL_DIV)
+HOST_FIELD(GCLK_GENCTRL_SRC)
+HOST_FIELD(DMAC_CHPRILVL_PRILVL)
+#undef HOST_FIELD
+
+// Fields that share a register with bits the fakes act on are shifted into place, as on the chip.
+constexpr uint32_t DMAC_CTRL_LVLEN(uint32_t lvl) { return lvl << 8; }
+constexpr uint32_t DMAC_CHCTRLA_TRIGSRC(uint32_t src) { return src << 8; }
+
+enum : uint32_t {
+  GCLK_GENCTRL_SRC_DFLL = 6,
+  GCLK_GENCTRL_SRC_DPLL0 = 7,
+  GCLK_GENCTRL_GENEN = 1 << 8,
+  GCLK_GENCTRL_IDC = 1 << 9,
+  GCLK_PCHCTRL_GEN_GCLK1 = 1,
+  GCLK_PCHCTRL_GEN_GCLK7 = 7,
+  GCLK_PCHCTRL_CHEN = 1 << 6,
+
+  MCLK_AHBMASK_DMAC = 1 << 9,
+  MCLK_APBAMASK_TC0 = 1 << 14,
+  MCLK_APBAMASK_TC1 = 1 << 15,
+  MCLK_APBBMASK_TC2 = 1 << 13,
+  MCLK_APBBMASK_TC3 = 1 << 14,
+  MCLK_APBCMASK_TC4 = 1 << 5,
+  MCLK_APBCMASK_TC5 = 1 << 6,
+  MCLK_APBBMASK_TCC0 = 1 << 11,
+  MCLK_APBBMASK_TCC1 = 1 << 12,
+  MCLK_APBCMASK_TCC2 = 1 << 3,
+  MCLK_APBCMASK_TCC3 = 1 << 4,
+  MCLK_APBDMASK_TCC4 = 1 << 0,
+
+  TC0_GCLK_ID = 9,
+  TC1_GCLK_ID = 9,
+  TC2_GCLK_ID = 26,
+  TC3_GCLK_ID = 26,
+  TC4_GCLK_ID = 30,
+  TC5_GCLK_ID = 30,
+  TCC0_GCLK_ID = 25,
+  TCC1_GCLK_ID = 25,
+  TCC2_GCLK_ID = 29,
+  TCC3_GCLK_ID = 29,
+  TCC4_GCLK_ID = 38,
+
+  TC_CTRLA_SWRST = 1 << 0,
+  TC_CTRLA_ENABLE = 1 << 1,
+  TC_CTRLA_MODE_COUNT16 = 0,
+  TC_CTRLA_PRESCSYNC_PRESC = 1 << 4,
+  TC_CTRLA_PRESCALER_DIV1 = 0 << 8,
+  TC_CTRLA_PRESCALER_DIV2 = 1 << 8,
+  TC_CTRLA_PRESCALER_DIV4 = 2 << 8,
+  TC_CTRLA_PRESCALER_DIV8 = 3 << 8,
+  TC_CTRLA_PRESCALER_DIV16 = 4 << 8,
+  TC_CTRLA_PRESCALER_DIV64 = 5 << 8,
+  TC_CTRLA_PRESCALER_DIV256 = 6 << 8,
+  TC_CTRLA_PRESCALER_DIV1024 = 7 << 8,
+  TC_CTRLBSET_ONESHOT = 1 << 2,
+  TC_CTRLBSET_CMD_RETRIGGER = 1 << 5,
+  TC_CTRLBSET_CMD_STOP = 2 << 5,
+  TC_CTRLBSET_CMD_READSYNC = 4 << 5,
+  TC_CTRLBCLR_ONESHOT = 1 << 2,
+  TC_WAVE_WAVEGEN_MFRQ = 1,
+  TC_INTENSET_OVF = 1 << 0,
+  TC_INTENSET_MC0 = 1 << 4,
+  TC_INTENCLR_OVF = 1 << 0,
+  TC_INTENCLR_MC0 = 1 << 4,
+  TC_INTFLAG_OVF = 1 << 0,
+  TC_INTFLAG_MC0 = 1 << 4,
+
+  TCC_CTRLA_RESOLUTION_NONE = 0,
+  TCC_CTRLA_RESOLUTION_DITH4 = 1 << 5,
+  TCC_CTRLA_RESOLUTION_DITH5 = 2 << 5,
+  TCC_CTRLA_RESOLUTION_DITH6 = 3 << 5,
+  TCC_WAVE_WAVEGEN_NPWM = 2,
+  TCC_STATUS_CCBUFV0 = 1 << 16,
+
+  DMAC_CTRL_SWRST = 1 << 0,
+  DMAC_CTRL_DMAENABLE = 1 << 1,
+  DMAC_CHCTRLA_SWRST = 1 << 0,
+  DMAC_CHCTRLA_ENABLE = 1 << 1,
+  DMAC_CHCTRLA_TRIGACT_BURST = 2 << 20,
+  DMAC_CHINTENSET_TERR = 1 << 0,
+  DMAC_CHINTENSET_TCMPL = 1 << 1,
+  DMAC_CHINTENCLR_TERR = 1 << 0,
+  DMAC_CHINTENCLR_TCMPL = 1 << 1,
+  DMAC_CHINTFLAG_TERR = 1 << 0,
+  DMAC_CHINTFLAG_TCMPL = 1 << 1,
+  DMAC_CHINTFLAG_SUSP = 1 << 2,
+  DMAC_BTCTRL_VALID = 1 << 0,
+  DMAC_BTCTRL_EVOSEL_DISABLE = 0,
+  DMAC_BTCTRL_BLOCKACT_NOACT = 0,
+  DMAC_BTCTRL_BLOCKACT_INT = 1 << 3,
+  DMAC_BTCTRL_BEATSIZE_WORD = 2 << 8,
+  DMAC_BTCTRL_SRCINC = 1 << 10,
+  DMAC_BTCTRL_DSTINC = 1 << 11,
+
+  TCC0_DMAC_ID_OVF = 0x16,
+  TCC1_DMAC_ID_OVF = 0x1D,
+  TCC2_DMAC_ID_OVF = 0x23,
+  TCC3_DMAC_ID_OVF = 0x27,
+  TCC4_DMAC_ID_OVF = 0x2A,
+
+  NVMCTRL_CTRLB_CMDEX_KEY = 0xA5 << 8,
+  NVMCTRL_CTRLB_CMD_EP = 0x00,
+  NVMCTRL_CTRLB_CMD_PBC = 0x15,
+  NVMCTRL_CTRLB_CMD_WQW = 0x04,
+  NVMCTRL_CTRLB_CMD_SEEFLUSH = 0x33,
+  NVMCTRL_STATUS_READY = 1 << 0,
+  NVMCTRL_SEESTAT_LOAD = 1 << 2,
+  NVMCTRL_SEESTAT_BUSY = 1 << 3,
+  NVMCTRL_USER = 0x00804000,
+  SEEPROM_ADDR = 0x44000000,
+  RSTC_RCAUSE_SYST = 1 << 6,
+
+  SysTick_CTRL_ENABLE_Msk = 1 << 0,
+  SysTick_CTRL_TICKINT_Msk = 1 << 1,
+  SysTick_CTRL_CLKSOURCE_Msk = 1 << 2,
+  SysTick_CTRL_COUNTFLAG_Msk = 1 << 16,
+  SCB_ICSR_PENDSTCLR_Msk = 1 << 25,
+  SCB_ICSR_PENDSTSET_Msk = 1 << 26,
+};
+
+/**
+ * SCB->ICSR, for the SysTick's pending bit: reads PENDSTSET while the SysTick interrupt is
+ * pending; writing PENDSTCLR clears it.
+ */
+struct HostIcsr {
+  volatile bool isSysTickPending;
+
+  operator uint32_t() const { return isSysTickPending ? SCB_ICSR_PENDSTSET_Msk : 0; }
+  HostIcsr &operator=(uint32_t val) {
+    if (val & SCB_ICSR_PENDSTCLR_Msk) {
+      isSysTickPending = false;
+    } else if (val & SCB_ICSR_PENDSTSET_Msk) {
+      isSysTickPending = true;
+    }
+    return *this;
+  }
+};
+
+struct HostScb {
+  HostIcsr ICSR;
+};
+
+extern HostScb *const SCB;
+
+enum IRQn_Type {
+  DMAC_0_IRQn = 31,
+  TC0_IRQn = 107,
+  TC1_IRQn = 108,
+  TC2_IRQn = 109,
+  TC3_IRQn = 110,
+  TC4_IRQn = 111,
+  TC5_IRQn = 112,
+};
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SystemReset() __attribute__((noreturn)); // As in CMSIS.
+
+void __WFI();
+void __DSB();
+void __disable_irq();
+void __enable_irq();
+uint32_t __get_PRIMASK();
+void __set_PRIMASK(uint32_t primask);
+
+#endif // _HOST_SAMD_H
@@ -0,0 +1,628 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host fakes for the Arduino core, the libraries and the peripherals; see hostFakes.h.
+// Also stands in for lib/samd51tc.cpp and lib/smarteeprom.cpp, which only make sense on the
+// chip.
+
+#include "hostFakes.h"
+
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C" void TC3_Handler();
+extern "C" void TC4_Handler();
+extern "C" void TC5_Handler() __attribute__((weak));
+extern "C" void DMAC_0_Handler();
+
+// Peripheral registers, as plain memory.
+static Tcc tccs[5];
+static Tc tcs[6];
+static Port port;
+static Mclk mclk;
+static Gclk gclk;
+static Nvmctrl nvmctrl;
+static Rstc rstc;
+static Dmac dmac;
+static HostScb scb = {};
+static HostSysTick sysTick = {
+  SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_CLKSOURCE_Msk,
+  F_CPU / 1000 - 1, F_CPU / 1000 - 1, 0
+};
+
+Tcc *const TCC0 = &tccs[0];
+Tcc *const TCC1 = &tccs[1];
+Tcc *const TCC2 = &tccs[2];
+Tcc *const TCC3 = &tccs[3];
+Tcc *const TCC4 = &tccs[4];
+Tc *const TC0 = &tcs[0];
+Tc *const TC1 = &tcs[1];
+Tc *const TC2 = &tcs[2];
+Tc *const TC3 = &tcs[3];
+Tc *const TC4 = &tcs[4];
+Tc *const TC5 = &tcs[5];
+Port *const PORT = &port;
+Mclk *const MCLK = &mclk;
+Gclk *const GCLK = &gclk;
+Nvmctrl *const NVMCTRL = &nvmctrl;
+Rstc *const RSTC = &rstc;
+Dmac *const DMAC = &dmac;
+HostSysTick *const SysTick = &sysTick;
+HostScb *const SCB = &scb;
+
+const PinDescription g_APinDescription[64] = {};
+
+HostSerial Serial;
+TwoWire Wire;
+WatchdogSAMD Watchdog;
+
+int HostSerial::available() { return 0; }
+int HostSerial::read() { return -1; }
+void TwoWire::begin() { }
+void TwoWire::setClock(uint32_t freq) { }
+
+//////////// Random numbers ////////////
+
+// A fixed seed, so every run of a test sees the same choices.
+static std::mt19937 rng(12345);
+
+long random(long howBig) {
+  return howBig <= 0 ? 0 : (long)(rng() % (unsigned long)howBig);
+}
+
+long random(long howSmall, long howBig) {
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void randomSeed(unsigned long seed) {
+  rng.seed(seed);
+}
+
+//////////// Interrupts ////////////
+
+static unsigned long nowMicros = 0;
+static bool isIrqDisabled = false;
+static bool isInIsr = false;
+static HostWakeups wakeups = {};
+
+// Interrupt sources: the timers, then one for all the pin interrupts, then DMAC channel 0.
+static constexpr unsigned int NUM_TCS = 6;
+static constexpr unsigned int PIN_IRQ = NUM_TCS;
+static constexpr unsigned int DMAC_IRQ = NUM_TCS + 1;
+static constexpr unsigned int NUM_IRQS = NUM_TCS + 2;
+static bool isIrqPending[NUM_IRQS];
+
+static constexpr unsigned int NUM_PINS = 64;
+static void (*pinIsr[NUM_PINS])() = {};
+static uint32_t pinIsrMode[NUM_PINS];
+static bool isPinIsrPending[NUM_PINS];
+static int pinLevel[NUM_PINS];
+static int analogValue[NUM_PINS];
+
+// Milliseconds counted by the SysTick interrupt.
+static unsigned long sysTicks = 0;
+
+extern "C" void SysTick_DefaultHandler() {
+  sysTicks++;
+}
+
+static void runIsr(unsigned int irq) {
+  isInIsr = true;
+  if (irq == PIN_IRQ) {
+    for (unsigned int pin = 0; pin < NUM_PINS; pin++) {
+      if (isPinIsrPending[pin]) {
+        isPinIsrPending[pin] = false;
+        pinIsr[pin]();
+      }
+    }
+  } else if (irq == 3) {
+    TC3_Handler();
+  } else if (irq == 4) {
+    TC4_Handler();
+  } else if (irq == 5 && TC5_Handler != NULL) {
+    TC5_Handler();
+  } else if (irq == DMAC_IRQ) {
+    DMAC_0_Handler();
+  }
+  isInIsr = false;
+}
+
+// Run the pending interrupts, if they're enabled.
+static void runPendingIsrs() {
+  if (isIrqDisabled || isInIsr) {
+    return;
+  }
+
+  if (scb.ICSR.isSysTickPending) {
+    scb.ICSR.isSysTickPending = false;
+    SysTick_DefaultHandler();
+  }
+
+  for (unsigned int irq = 0; irq < NUM_IRQS; irq++) {
+    if (isIrqPending[irq]) {
+      isIrqPending[irq] = false;
+      runIsr(irq);
+    }
+  }
+}
+
+static void raiseIrq(unsigned int irq) {
+  isIrqPending[irq] = true;
+  runPendingIsrs();
+}
+
+void noInterrupts() { isIrqDisabled = true; }
+void interrupts() { isIrqDisabled = false; runPendingIsrs(); }
+void __disable_irq() { noInterrupts(); }
+void __enable_irq() { interrupts(); }
+uint32_t __get_PRIMASK() { return isIrqDisabled; }
+void __set_PRIMASK(uint32_t primask) { primask ? noInterrupts() : interrupts(); }
+void __DSB() { }
+
+bool areHostInterruptsEnabled() {
+  return !isIrqDisabled;
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) { }
+void NVIC_EnableIRQ(IRQn_Type irq) { }
+void NVIC_DisableIRQ(IRQn_Type irq) { }
+void NVIC_ClearPendingIRQ(IRQn_Type irq) {
+  if (irq >= TC0_IRQn && irq < TC0_IRQn + NUM_TCS) {
+    isIrqPending[irq - TC0_IRQn] = false;
+  } else if (irq == DMAC_0_IRQn) {
+    isIrqPending[DMAC_IRQ] = false;
+  }
+}
+
+void NVIC_SystemReset() {
+  fprintf(stderr, "NVIC_SystemReset() at %lu us\n", nowMicros);
+  exit(2);
+}
+
+//////////// TCC and DMAC ////////////
+
+Tcc::Tcc() : CTRLA(), CTRLBCLR(), CTRLBSET(), SYNCBUSY(), STATUS(), COUNT(), WAVE(), PER(),
+    PERBUF(), INTENCLR(), INTENSET(), INTFLAG(), EVCTRL(), CC(), CCBUF() {
+  for (unsigned int i = 0; i < sizeof(CCBUF) / sizeof(CCBUF[0]); i++) {
+    CCBUF[i].reg.status = &STATUS.reg;
+    CCBUF[i].reg.validBit = TCC_STATUS_CCBUFV0 << i;
+  }
+}
+
+/**
+ * What a DMAC channel is doing: the descriptor of the block in progress, as fetched, and the
+ * beats left in it. The channel fetches its first descriptor (from BASEADDR) on its first trigger
+ * after being enabled, and each next one (from DESCADDR) as soon as a block ends.
+ */
+struct HostDmaChannel {
+  bool isFetched;
+  unsigned int resets; // CHCTRLA resets seen; a reset forgets the block in progress.
+  DmacDescriptor desc;
+  uintptr_t beatsLeft;
+};
+
+static HostDmaChannel dmaChannels[sizeof(Dmac::Channel) / sizeof(Dmac::Channel[0])];
+
+static void fetchDmaDescriptor(HostDmaChannel &state, const DmacDescriptor *desc) {
+  state.desc = *desc;
+  state.beatsLeft = desc->BTCNT.reg;
+  state.isFetched = true;
+}
+
+// Write a beat to its destination. A TCC compare buffer is written as the TCC sees it.
+static void writeDmaBeat(uintptr_t dstAddr, uint32_t val) {
+  for (Tcc &tcc : tccs) {
+    for (HostBufReg &buf : tcc.CCBUF) {
+      if (dstAddr == (uintptr_t)&buf.reg) {
+        buf.reg = val;
+        return;
+      }
+    }
+  }
+  *(volatile uintptr_t *)dstAddr = val;
+}
+
+/**
+ * A DMA trigger: each enabled channel triggered by 'trigSrc' transfers one beat (a burst of one
+ * word, from an incrementing source to a fixed destination). At the end of a block, it flags
+ * TCMPL if the block says to, and goes on to the next block, or disables itself if there's none.
+ */
+static void triggerDma(uint32_t trigSrc) {
+  if (!(dmac.CTRL.reg & DMAC_CTRL_DMAENABLE)) {
+    return;
+  }
+
+  for (unsigned int ch = 0; ch < sizeof(dmaChannels) / sizeof(dmaChannels[0]); ch++) {
+    DmacChannel &channel = dmac.Channel[ch];
+    HostDmaChannel &state = dmaChannels[ch];
+    if (channel.CHCTRLA.reg.hostResets != state.resets) {
+      state.resets = channel.CHCTRLA.reg.hostResets;
+      state.isFetched = false;
+    }
+    if (!(channel.CHCTRLA.reg & DMAC_CHCTRLA_ENABLE)) {
+      state.isFetched = false;
+      continue;
+    } else if (((channel.CHCTRLA.reg >> 8) & 0x7F) != trigSrc) {
+      continue;
+    }
+
+    if (!state.isFetched) {
+      fetchDmaDescriptor(state, (const DmacDescriptor *)dmac.BASEADDR.reg + ch);
+    }
+    if (!(state.desc.BTCTRL.reg & DMAC_BTCTRL_VALID) || state.beatsLeft == 0) {
+      channel.CHINTFLAG.reg.value |= DMAC_CHINTFLAG_TERR;
+      channel.CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+    } else {
+      // With SRCINC, SRCADDR is the end of the block.
+      uintptr_t srcAddr = state.desc.SRCADDR.reg;
+      if (state.desc.BTCTRL.reg & DMAC_BTCTRL_SRCINC) {
+        srcAddr -= state.beatsLeft * sizeof(uint32_t);
+      }
+      writeDmaBeat(state.desc.DSTADDR.reg, *(const uint32_t *)srcAddr);
+
+      if (--state.beatsLeft == 0) {
+        if (state.desc.BTCTRL.reg & DMAC_BTCTRL_BLOCKACT_INT) {
+          channel.CHINTFLAG.reg.value |= DMAC_CHINTFLAG_TCMPL;
+        }
+        if (state.desc.DESCADDR.reg != 0) {
+          fetchDmaDescriptor(state, (const DmacDescriptor *)state.desc.DESCADDR.reg);
+        } else {
+          channel.CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+          state.isFetched = false;
+        }
+      }
+    }
+
+    if (ch == 0 && (channel.CHINTFLAG.reg & channel.CHINTENSET.reg)) {
+      raiseIrq(DMAC_IRQ);
+    }
+  }
+}
+
+void hostTccPeriodEnd(Tcc *tcc) {
+  static const uint32_t TRIGGERS[] = {
+    TCC0_DMAC_ID_OVF, TCC1_DMAC_ID_OVF, TCC2_DMAC_ID_OVF, TCC3_DMAC_ID_OVF, TCC4_DMAC_ID_OVF
+  };
+
+  for (unsigned int i = 0; i < sizeof(tcc->CCBUF) / sizeof(tcc->CCBUF[0]); i++) {
+    HostBufWord &buf = tcc->CCBUF[i].reg;
+    if (tcc->STATUS.reg & buf.validBit) {
+      tcc->CC[i].reg = buf.value;
+      tcc->STATUS.reg &= ~buf.validBit;
+    }
+  }
+  triggerDma(TRIGGERS[tcc - tccs]);
+}
+
+
+//////////// Timers (for lib/samd51tc) ////////////
+
+struct HostTimer {
+  bool isRunning;
+  bool isOneShot;
+  unsigned long periodMicros;
+  unsigned long dueMicros;
+};
+
+static HostTimer timers[NUM_TCS];
+
+static int tcIndex(Tc *tc) {
+  for (unsigned int i = 0; i < NUM_TCS; i++) {
+    if (tc == &tcs[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int setupPeriodicTc(Tc *tc, uint32_t periodMicros, uint32_t irqPriority) {
+  int i = tcIndex(tc);
+  if (i < 0) {
+    return ERR_PERIODIC_TC_INVALID;
+  }
+
+  timers[i] = { true, false, periodMicros, nowMicros + periodMicros };
+  return PERIODIC_TC_SUCCESS;
+}
+
+void stopPeriodicTc(Tc *tc) {
+  int i = tcIndex(tc);
+  timers[i].isRunning = false;
+  isIrqPending[i] = false;
+}
+
+void restartPeriodicTc(Tc *tc) {
+  int i = tcIndex(tc);
+  timers[i].isRunning = true;
+  timers[i].dueMicros = nowMicros + timers[i].periodMicros;
+}
+
+int setupOneShotTc(Tc *tc, uint32_t irqPriority) {
+  int i = tcIndex(tc);
+  if (i < 0) {
+    return ERR_PERIODIC_TC_INVALID;
+  }
+
+  timers[i] = { false, true, 0, 0 };
+  return PERIODIC_TC_SUCCESS;
+}
+
+void startOneShotTc(Tc *tc, uint32_t micros) {
+  int i = tcIndex(tc);
+  micros = max(min(micros, ONE_SHOT_TC_MAX_MICROS), (uint32_t)1);
+  timers[i] = { true, true, micros, nowMicros + micros };
+  isIrqPending[i] = false;
+}
+
+uint32_t stopOneShotTc(Tc *tc) {
+  int i = tcIndex(tc);
+  HostTimer &timer = timers[i];
+  unsigned long startMicros = timer.dueMicros - timer.periodMicros;
+  timer.isRunning = false;
+  isIrqPending[i] = false;
+  return min(nowMicros - startMicros, timer.periodMicros);
+}
+
+bool isHostTcRunning(Tc *tc) {
+  int i = tcIndex(tc);
+  return i >= 0 && timers[i].isRunning;
+}
+
+// Return the index of the first timer due by 'deadline', or -1.
+static int nextDueTimer(unsigned long deadline) {
+  int next = -1;
+  for (unsigned int i = 0; i < NUM_TCS; i++) {
+    if (timers[i].isRunning && (long)(timers[i].dueMicros - deadline) <= 0
+        && (next < 0 || (long)(timers[i].dueMicros - timers[next].dueMicros) < 0)) {
+      next = i;
+    }
+  }
+  return next;
+}
+
+static void updateSysTickVal() {
+  // SysTick counts down from LOAD to 0 every millisecond.
+  uint32_t cyclesPerMilli = sysTick.LOAD + 1;
+  sysTick.VAL = sysTick.LOAD - (uint32_t)((uint64_t)(nowMicros % 1000) * cyclesPerMilli / 1000);
+}
+
+static bool isSysTickInterruptOn() {
+  uint32_t on = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk;
+  return (sysTick.CTRL & on) == on;
+}
+
+// Move the clock, running (or pending) the SysTick interrupt for each millisecond that ends.
+static void setNow(unsigned long micros) {
+  unsigned long numTicks = micros / 1000 - nowMicros / 1000;
+  nowMicros = micros;
+  updateSysTickVal();
+  if (!isSysTickInterruptOn()) {
+    return;
+  }
+  for (unsigned long i = 0; i < numTicks; i++) {
+    scb.ICSR.isSysTickPending = true;
+    runPendingIsrs();
+  }
+}
+
+// Run the timers due by 'deadline' in order, then leave the clock there.
+static void runTimersUntil(unsigned long deadline) {
+  int i;
+  while ((i = nextDueTimer(deadline)) >= 0) {
+    HostTimer &timer = timers[i];
+    if ((long)(timer.dueMicros - nowMicros) > 0) {
+      setNow(timer.dueMicros);
+    }
+    if (timer.isOneShot) {
+      timer.isRunning = false;
+    } else {
+      timer.dueMicros += timer.periodMicros;
+    }
+    raiseIrq(i);
+  }
+  setNow(deadline);
+}
+
+void advanceMicros(unsigned long us) {
+  runTimersUntil(nowMicros + us);
+}
+
+unsigned long hostMicros() {
+  return nowMicros;
+}
+
+// Sleep until the next interrupt: a timer, or the SysTick. (Pin interrupts only come from the
+// test, so nothing else can wake us.)
+void __WFI() {
+  for (unsigned int irq = 0; irq < NUM_IRQS; irq++) {
+    if (isIrqPending[irq] || scb.ICSR.isSysTickPending) {
+      runPendingIsrs();
+      wakeups.total++;
+      return;
+    }
+  }
+
+  int i = nextDueTimer(nowMicros + 0x7FFFFFFF);
+  bool isSysTickNext = isSysTickInterruptOn()
+      && (i < 0 || (long)(timers[i].dueMicros - (nowMicros / 1000 + 1) * 1000) > 0);
+  if (isSysTickNext) {
+    setNow((nowMicros / 1000 + 1) * 1000);
+    wakeups.sysTick++;
+  } else if (i >= 0) {
+    runTimersUntil(timers[i].dueMicros);
+    wakeups.tc[i]++;
+  } else {
+    fprintf(stderr, "__WFI() with no interrupt that could wake it, at %lu us\n", nowMicros);
+    abort();
+  }
+  wakeups.total++;
+}
+
+unsigned long hostSysTicks() {
+  return sysTicks;
+}
+
+const HostWakeups &hostWakeups() {
+  return wakeups;
+}
+
+void resetHostWakeups() {
+  wakeups = {};
+}
+
+//////////// Clock ////////////
+
+unsigned long millis() {
+  return nowMicros / 1000;
+}
+
+unsigned long micros() {
+  return nowMicros;
+}
+
+void delay(unsigned long ms) {
+  advanceMicros(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  advanceMicros(us);
+}
+
+//////////// Pins ////////////
+
+void pinMode(uint32_t pin, uint32_t mode) {
+  if (mode == INPUT_PULLUP && pin < NUM_PINS) {
+    pinLevel[pin] = HIGH;
+  }
+}
+
+int digitalRead(uint32_t pin) {
+  return pin < NUM_PINS ? pinLevel[pin] : LOW;
+}
+
+void digitalWrite(uint32_t pin, uint32_t val) { }
+
+int analogRead(uint32_t pin) {
+  return pin < NUM_PINS ? analogValue[pin] : 0;
+}
+
+void analogReference(int mode) { }
+
+void attachInterrupt(uint32_t pin, void (*callback)(), uint32_t mode) {
+  pinIsr[pin] = callback;
+  pinIsrMode[pin] = mode;
+}
+
+void detachInterrupt(uint32_t pin) {
+  pinIsr[pin] = NULL;
+}
+
+void setHostPin(uint32_t pin, int level) {
+  int prevLevel = pinLevel[pin];
+  pinLevel[pin] = level;
+  if (pinIsr[pin] == NULL || level == prevLevel) {
+    return;
+  }
+
+  uint32_t mode = pinIsrMode[pin];
+  if (mode == CHANGE || (mode == FALLING && level == LOW) || (mode == RISING && level == HIGH)) {
+    isPinIsrPending[pin] = true;
+    raiseIrq(PIN_IRQ);
+  }
+}
+
+void setHostAnalog(uint32_t pin, int value) {
+  analogValue[pin] = value;
+}
+
+//////////// I2C ////////////
+
+static constexpr unsigned int MAX_I2C_BANKS = 8;
+static I2CParallel *i2cBanks[MAX_I2C_BANKS];
+static unsigned long i2cTransactions = 0;
+
+void I2CParallel::init(uint8_t i2cAddr, uint32_t busSpeed) {
+  hostAddr = i2cAddr;
+  for (I2CParallel *&bank : i2cBanks) {
+    if (bank == NULL || bank == this) {
+      bank = this;
+      return;
+    }
+  }
+}
+
+void I2CParallel::write(uint8_t val) {
+  hostOutput = val;
+  hostWrites++;
+  i2cTransactions++;
+}
+
+uint8_t I2CParallel::read() {
+  hostReads++;
+  i2cTransactions++;
+  hostLastRead = hostInputs;
+  if (hostIntPin >= 0) {
+    setHostPin(hostIntPin, HIGH); // Reading the bank releases INT.
+  }
+  return hostInputs;
+}
+
+void I2CParallel::enableInputs(uint8_t mask) {
+  write(mask);
+}
+
+I2CParallel *hostI2CBank(uint8_t addr) {
+  for (I2CParallel *bank : i2cBanks) {
+    if (bank != NULL && bank->hostAddr == addr) {
+      return bank;
+    }
+  }
+  return NULL;
+}
+
+void connectHostBankInt(uint8_t addr, uint32_t pin) {
+  I2CParallel *bank = hostI2CBank(addr);
+  bank->hostIntPin = pin;
+  bank->hostLastRead = bank->hostInputs;
+  setHostPin(pin, HIGH);
+}
+
+void setHostBankInputs(uint8_t addr, uint8_t inputs) {
+  I2CParallel *bank = hostI2CBank(addr);
+  bank->hostInputs = inputs;
+  if (bank->hostIntPin >= 0) {
+    // INT is held low while the inputs differ from what was last read.
+    setHostPin(bank->hostIntPin, inputs == bank->hostLastRead ? HIGH : LOW);
+  }
+}
+
+unsigned long hostI2CTransactions() {
+  return i2cTransactions;
+}
+
+//////////// SmartEEPROM (for lib/smarteeprom) ////////////
+
+static uint8_t eeprom[512];
+
+void programEEPROMFuses(uint8_t sblk, uint8_t psz) { }
+void setEEPROMCommitMode(bool useExplicitCommit) { }
+
+int readEEPROM(unsigned int offset, void *dataOut, size_t size) {
+  if (offset + size > sizeof(eeprom)) {
+    return EEPROM_OVERFLOW;
+  }
+  memcpy(dataOut, eeprom + offset, size);
+  return EEPROM_SUCCESS;
+}
+
+int writeEEPROM(unsigned int offset, const void *data, size_t size) {
+  if (offset + size > sizeof(eeprom)) {
+    return EEPROM_OVERFLOW;
+  }
+  memcpy(eeprom + offset, data, size);
+  return EEPROM_SUCCESS;
+}
+
+int commitEEPROM() {
+  return EEPROM_SUCCESS;
+}
@@ -0,0 +1,67 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Fakes behind the host stand-in headers (test/host/), for the host tests: a clock that only
+// moves when told to, timer interrupts that run as it passes their deadlines, counted I2C
+// transactions, and pins a test can drive.
+//
+// Time advances through advanceMicros(), delay(), delayMicroseconds() and __WFI(). Each timer
+// set up with setupPeriodicTc() runs its TCn_Handler() as the clock passes each period. While
+// interrupts are disabled, handlers that come due are held pending, as in the NVIC, and run
+// when they're enabled again.
+
+#ifndef _HOST_FAKES_H
+#define _HOST_FAKES_H
+
+#include "../like-the-art.h"
+
+// The fake clock, in micros since boot.
+unsigned long hostMicros();
+// Move the clock forward, running each timer interrupt that comes due on the way.
+void advanceMicros(unsigned long us);
+
+// Milliseconds counted by the SysTick interrupt (SysTick_DefaultHandler()), from which
+// millis() counts on the chip. (Here, millis() reads the fake clock.)
+unsigned long hostSysTicks();
+
+// True if the TC's periodic (or one-shot) interrupt is running.
+bool isHostTcRunning(Tc *tc);
+
+// True unless noInterrupts() (or __disable_irq()) is in effect.
+bool areHostInterruptsEnabled();
+
+/** What woke the CPU from each __WFI(). */
+struct HostWakeups {
+  unsigned long total;
+  unsigned long sysTick;
+  unsigned long tc[6]; // TC0..TC5.
+  unsigned long pin;
+};
+
+const HostWakeups &hostWakeups();
+void resetHostWakeups();
+
+// The end of a PWM period on the TCC: each compare buffer (CCBUFn) written since the last one
+// is copied into its compare register (CCn), and its STATUS.CCBUFVn bit clears. Then the
+// overflow triggers the DMAC channels set to it, each of which moves one word; the DMAC_0
+// interrupt runs if channel 0 flags one that's enabled.
+void hostTccPeriodEnd(Tcc *tcc);
+
+// The I2C bank at the specified address, or NULL if none has been init()'ed there.
+I2CParallel *hostI2CBank(uint8_t addr);
+// Total I2C reads and writes, on every bank.
+unsigned long hostI2CTransactions();
+
+// Model the PCF8574 INT output of the bank at 'addr' (open drain, with a pull-up) on a gpio
+// pin: it's pulled low while the bank's inputs differ from what it last returned, and released
+// when it's read (or when the inputs change back).
+void connectHostBankInt(uint8_t addr, uint32_t pin);
+// Set the inputs of the bank at 'addr', driving its INT pin if connected.
+void setHostBankInputs(uint8_t addr, uint8_t inputs);
+
+// Drive a gpio input pin (as read by digitalRead()). Runs its attached interrupt, if the change
+// is an edge that the interrupt is attached for.
+void setHostPin(uint32_t pin, int level);
+// Set the value analogRead() returns for a pin.
+void setHostAnalog(uint32_t pin, int value);
+
+#endif // _HOST_FAKES_H
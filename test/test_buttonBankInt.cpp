@@ -0,0 +1,121 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// The button bank's INT line: with nothing pressed, pollButtons() leaves the bank alone but for
+// the safety poll, about once a second, so the I2C bus stays free for the sign banks. A press
+// on the bank pulls INT low, and the bank is read on the next poll, until it settles.
+//
+// Polls the buttons as the main loop does, with the PCF8574 at 0x23 driving INT on D12, and
+// prints the bank reads per second.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static constexpr uint8_t BUTTON_BANK_ADDR = 3 + I2C_PCF8574_MIN_ADDR;
+static constexpr uint32_t BUTTON_BANK_INT_PIN = 12;
+
+// Only the safety poll reads the bank. (Plus the first poll after setup; see checkIdleReads().)
+static constexpr unsigned long MAX_IDLE_READS_PER_SEC = 1000000 / BUTTON_SAFETY_POLL_MICROS;
+
+static I2CParallel *buttonBank;
+
+struct ButtonLog {
+  unsigned int numChanges;
+  uint8_t id;
+  uint8_t state;
+};
+
+static ButtonLog buttonLog;
+
+static void logButton(uint8_t id, uint8_t btnState) {
+  buttonLog.numChanges++;
+  buttonLog.id = id;
+  buttonLog.state = btnState;
+}
+
+/** Poll the buttons for 'micros', as the loop would; return the bank reads in that time. */
+static unsigned long pollFor(unsigned long micros) {
+  unsigned long startReads = buttonBank->hostReads;
+  for (unsigned long elapsed = 0; elapsed < micros; elapsed += BUTTON_POLL_MICROS) {
+    advanceMicros(BUTTON_POLL_MICROS);
+    pollButtons();
+  }
+  return buttonBank->hostReads - startReads;
+}
+
+static void checkIdleReads(const char *name, unsigned long secs) {
+  unsigned long reads = pollFor(secs * 1000000);
+  printf("%-24s %2lu s: %.1f button bank reads/s\n", name, secs, (double)reads / secs);
+  CHECK(reads <= MAX_IDLE_READS_PER_SEC * secs + 1);
+}
+
+/**
+ * Set the bank's inputs, bouncing for a few ms first; return how many polls it took for the
+ * button to register the change.
+ */
+static unsigned int changeBankInputs(uint8_t inputs, uint8_t id, uint8_t btnState) {
+  uint8_t prevInputs = buttonBank->hostInputs;
+  for (unsigned int i = 0; i < 3; i++) {
+    setHostBankInputs(BUTTON_BANK_ADDR, inputs);
+    advanceMicros(1000);
+    setHostBankInputs(BUTTON_BANK_ADDR, prevInputs);
+    advanceMicros(1000);
+  }
+  setHostBankInputs(BUTTON_BANK_ADDR, inputs);
+
+  buttonLog = {};
+  unsigned int numPolls = 0;
+  while (buttonLog.numChanges == 0 && numPolls < 100) {
+    pollFor(BUTTON_POLL_MICROS);
+    numPolls++;
+  }
+  CHECK_EQ(buttonLog.numChanges, 1);
+  CHECK_EQ(buttonLog.id, id);
+  CHECK_EQ(buttonLog.state, btnState);
+  return numPolls;
+}
+
+int main() {
+  setupButtons();
+  buttonBank = hostI2CBank(BUTTON_BANK_ADDR);
+  CHECK(buttonBank != NULL);
+  connectHostBankInt(BUTTON_BANK_ADDR, BUTTON_BANK_INT_PIN);
+  for (Button &btn : buttons) {
+    btn.setHandler(logButton);
+  }
+
+  checkIdleReads("idle", 60);
+
+  // Each bank button: the press and release are seen through INT, and read until they settle.
+  unsigned int maxDebouncePolls = BTN_DEBOUNCE_MILLIS * 1000 / BUTTON_POLL_MICROS + 2;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t id = bit + 1;
+    unsigned long startReads = buttonBank->hostReads;
+    unsigned int pressPolls = changeBankInputs(0xFF & ~(1 << bit), id, BTN_PRESSED);
+    CHECK(pressPolls <= maxDebouncePolls);
+    CHECK(buttonBank->hostReads - startReads <= pressPolls + 1);
+
+    pollFor(100 * 1000); // Held.
+    startReads = buttonBank->hostReads;
+    unsigned int releasePolls = changeBankInputs(0xFF, id, BTN_OPEN);
+    CHECK(releasePolls <= maxDebouncePolls);
+    CHECK(buttonBank->hostReads - startReads <= releasePolls + 1);
+    CHECK_EQ(digitalRead(BUTTON_BANK_INT_PIN), HIGH);
+  }
+
+  checkIdleReads("idle, after presses", 60);
+
+  // A second button pressed while INT is still low from the first makes no edge of its own;
+  // the read after the first edge sees both.
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 4));
+  advanceMicros(BUTTON_POLL_MICROS / 2);
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 4) & ~(1 << 5));
+  buttonLog = {};
+  pollFor(maxDebouncePolls * BUTTON_POLL_MICROS);
+  CHECK_EQ(buttonLog.numChanges, 2);
+  CHECK(!buttons[5].getState() && !buttons[6].getState());
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF);
+  pollFor(maxDebouncePolls * BUTTON_POLL_MICROS);
+  CHECK(buttons[5].getState() && buttons[6].getState());
+
+  return testResult("test_buttonBankInt");
+}
@@ -0,0 +1,268 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Immediate button presses (IMMEDIATE_BUTTON_PRESSES) register as soon as two samples of the
+// input agree: for a gpio button, its interrupt's reading at the edge and the next poll; for a
+// bank button, two polls in a row. A glitch that only one sample sees never registers.
+//
+// Gestures, recognized above the presses, each with its own timing: a long press once the
+// button has been held long enough; a double tap on a second press within DOUBLE_TAP_MILLIS;
+// and a chord when a button is pressed while others are held.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static constexpr uint32_t BTN0_PIN = 11;
+static constexpr uint8_t BUTTON_BANK_ADDR = 3 + I2C_PCF8574_MIN_ADDR;
+static constexpr uint32_t BUTTON_BANK_INT_PIN = 12;
+
+// Polls for a change to register after the debounce interval, without immediate presses.
+static constexpr unsigned int DEBOUNCE_POLLS = BTN_DEBOUNCE_MILLIS * 1000 / BUTTON_POLL_MICROS + 2;
+
+static constexpr unsigned int LONG_PRESS_MILLIS = 1000;
+
+static unsigned int numPresses;
+static unsigned int numReleases;
+static unsigned int numLongPresses;
+static unsigned int numDoubleTaps;
+static unsigned int numChords;
+static uint16_t chordMask;
+
+static void logButton(uint8_t id, uint8_t btnState) {
+  if (btnState == BTN_PRESSED) {
+    numPresses++;
+  } else {
+    numReleases++;
+  }
+}
+
+static void logLongPress(uint8_t id, uint8_t btnState) {
+  CHECK_EQ(btnState, BTN_PRESSED);
+  CHECK_EQ(buttons[id].getState(), BTN_PRESSED); // Still held.
+  numLongPresses++;
+}
+
+static void logDoubleTap(uint8_t id, uint8_t btnState) {
+  CHECK_EQ(btnState, BTN_PRESSED);
+  numDoubleTaps++;
+}
+
+static void logChord(uint16_t btnMask) {
+  numChords++;
+  chordMask = btnMask;
+}
+
+static void poll() {
+  advanceMicros(BUTTON_POLL_MICROS);
+  pollButtons();
+}
+
+/** Poll until a press registers (or for a while); return the polls it took. */
+static unsigned int pollUntilPressed() {
+  numPresses = 0;
+  unsigned int numPolls = 0;
+  while (numPresses == 0 && numPolls < 100) {
+    poll();
+    numPolls++;
+  }
+  CHECK_EQ(numPresses, 1);
+  return numPolls;
+}
+
+/** Poll for long enough that anything pending registers. */
+static void settle() {
+  for (unsigned int i = 0; i < 2 * DEBOUNCE_POLLS; i++) {
+    poll();
+  }
+}
+
+static void pollFor(unsigned long millis) {
+  for (unsigned long elapsed = 0; elapsed < millis * 1000; elapsed += BUTTON_POLL_MICROS) {
+    poll();
+  }
+}
+
+/** Press button 0, and release it after 'holdMillis'. */
+static void tapBtn0(unsigned long holdMillis) {
+  setHostPin(BTN0_PIN, LOW);
+  pollFor(holdMillis);
+  setHostPin(BTN0_PIN, HIGH);
+  settle();
+}
+
+static void checkGpioButton() {
+  // The interrupt's reading and the first poll agree.
+  setHostPin(BTN0_PIN, LOW);
+  advanceMicros(1000);
+  CHECK_EQ(pollUntilPressed(), 1);
+  CHECK_EQ(buttons[0].getState(), BTN_PRESSED);
+  setHostPin(BTN0_PIN, HIGH);
+  settle();
+  CHECK_EQ(buttons[0].getState(), BTN_OPEN);
+
+  // Bounce that ends pressed: the last edge and the poll agree.
+  for (unsigned int i = 0; i < 3; i++) {
+    setHostPin(BTN0_PIN, LOW);
+    advanceMicros(500);
+    setHostPin(BTN0_PIN, HIGH);
+    advanceMicros(500);
+  }
+  setHostPin(BTN0_PIN, LOW);
+  CHECK_EQ(pollUntilPressed(), 1);
+  setHostPin(BTN0_PIN, HIGH);
+  settle();
+
+  // A glitch between polls, gone by the poll: no press.
+  numPresses = 0;
+  setHostPin(BTN0_PIN, LOW);
+  advanceMicros(1000);
+  setHostPin(BTN0_PIN, HIGH);
+  settle();
+  CHECK_EQ(numPresses, 0);
+  CHECK_EQ(buttons[0].getState(), BTN_OPEN);
+}
+
+static void checkBankButton() {
+  // No sample but the bank read: the press registers on the second poll that reads it.
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 2));
+  unsigned int numPolls = pollUntilPressed();
+  CHECK_EQ(numPolls, 2);
+  CHECK(numPolls < DEBOUNCE_POLLS);
+  CHECK_EQ(buttons[3].getState(), BTN_PRESSED);
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF);
+  settle();
+  CHECK_EQ(buttons[3].getState(), BTN_OPEN);
+
+  // Pressed at one poll's read, and open again by the next: no press.
+  numPresses = 0;
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 2));
+  poll();
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF);
+  settle();
+  CHECK_EQ(numPresses, 0);
+  CHECK_EQ(buttons[3].getState(), BTN_OPEN);
+}
+
+static void checkLongPress() {
+  buttons[0].setLongPressHandler(logLongPress, LONG_PRESS_MILLIS);
+  numLongPresses = 0;
+
+  // Released too soon.
+  tapBtn0(LONG_PRESS_MILLIS / 2);
+  CHECK_EQ(numLongPresses, 0);
+
+  // Held: once, when the hold is long enough (to within a poll), however long it goes on.
+  setHostPin(BTN0_PIN, LOW);
+  CHECK_EQ(pollUntilPressed(), 1);
+  pollFor(LONG_PRESS_MILLIS - BUTTON_POLL_MICROS / 1000 * 2);
+  CHECK_EQ(numLongPresses, 0);
+  pollFor(BUTTON_POLL_MICROS / 1000 * 2);
+  CHECK_EQ(numLongPresses, 1);
+  pollFor(3 * LONG_PRESS_MILLIS);
+  CHECK_EQ(numLongPresses, 1);
+  setHostPin(BTN0_PIN, HIGH);
+  settle();
+
+  // Not once unsubscribed.
+  buttons[0].clearGestureHandlers();
+  tapBtn0(2 * LONG_PRESS_MILLIS);
+  CHECK_EQ(numLongPresses, 1);
+}
+
+static void checkDoubleTap() {
+  buttons[0].setDoubleTapHandler(logDoubleTap);
+  pollFor(DOUBLE_TAP_MILLIS);
+  numPresses = 0;
+  numDoubleTaps = 0;
+
+  // Each tap goes to the press handler too. Two taps make a double tap; a third, right after,
+  // begins the next one, which a fourth completes.
+  tapBtn0(60);
+  CHECK_EQ(numDoubleTaps, 0);
+  tapBtn0(60);
+  CHECK_EQ(numDoubleTaps, 1);
+  tapBtn0(60);
+  CHECK_EQ(numDoubleTaps, 1);
+  tapBtn0(60);
+  CHECK_EQ(numDoubleTaps, 2);
+  CHECK_EQ(numPresses, 4);
+
+  // Taps too far apart.
+  pollFor(DOUBLE_TAP_MILLIS);
+  tapBtn0(60);
+  pollFor(DOUBLE_TAP_MILLIS);
+  tapBtn0(60);
+  CHECK_EQ(numDoubleTaps, 2);
+
+  buttons[0].clearGestureHandlers();
+  tapBtn0(60);
+  CHECK_EQ(numDoubleTaps, 2);
+  pollFor(DOUBLE_TAP_MILLIS);
+}
+
+static void checkChord() {
+  setChordHandler(logChord);
+  numChords = 0;
+
+  // One button alone isn't a chord.
+  tapBtn0(60);
+  CHECK_EQ(numChords, 0);
+
+  // Button 3 held, then button 0 pressed: a chord of both. Releasing them makes no more.
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 2));
+  settle();
+  CHECK_EQ(numChords, 0);
+  setHostPin(BTN0_PIN, LOW);
+  settle();
+  CHECK_EQ(numChords, 1);
+  CHECK_EQ(chordMask, (1 << 0) | (1 << 3));
+  setHostPin(BTN0_PIN, HIGH);
+  settle();
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF);
+  settle();
+  CHECK_EQ(numChords, 1);
+
+  // Three buttons, pressed one after another: a chord of two, then of all three.
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 2));
+  settle();
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 2) & ~(1 << 5));
+  settle();
+  CHECK_EQ(numChords, 2);
+  CHECK_EQ(chordMask, (1 << 3) | (1 << 6));
+  setHostPin(BTN0_PIN, LOW);
+  settle();
+  CHECK_EQ(numChords, 3);
+  CHECK_EQ(chordMask, (1 << 0) | (1 << 3) | (1 << 6));
+  setHostPin(BTN0_PIN, HIGH);
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF);
+  settle();
+
+  // Resetting the handlers unsubscribes the chord handler too.
+  attachEmptyButtonHandlers();
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF & ~(1 << 2));
+  settle();
+  setHostPin(BTN0_PIN, LOW);
+  settle();
+  CHECK_EQ(numChords, 3);
+  setHostPin(BTN0_PIN, HIGH);
+  setHostBankInputs(BUTTON_BANK_ADDR, 0xFF);
+  settle();
+}
+
+int main() {
+  setupButtons();
+  connectHostBankInt(BUTTON_BANK_ADDR, BUTTON_BANK_INT_PIN);
+  for (Button &btn : buttons) {
+    btn.setHandler(logButton);
+  }
+  settle();
+
+  checkGpioButton();
+  checkBankButton();
+  CHECK_EQ(numReleases, 3);
+
+  checkLongPress();
+  checkDoubleTap();
+  checkChord();
+
+  return testResult("test_buttonPresses");
+}
@@ -0,0 +1,68 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// CodeMatcher: codeMatcherStates() counts the states of the codes' trie, so codes that begin
+// alike share them; and the matcher built with exactly that many states recognizes each code
+// wherever it ends in a stream of keys, including after a false start.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static constexpr unsigned int NUM_KEYS = 9;
+static constexpr unsigned int MAX_LEN = 10;
+typedef KeyCode<MAX_LEN> Code;
+
+// Like the service codes: four codes that share their first 9 keys.
+static constexpr std::array<Code, 4> sharedCodes = {{
+  { 0, 10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 3 } },
+  { 1, 10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 0 } },
+  { 2, 10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 8 } },
+  { 3, 10, { 1, 0, 4, 8, 5, 1, 5, 6, 6, 2 } },
+}};
+static_assert(codeMatcherStates(sharedCodes) == 1 + 9 + 4, "Shared prefixes share states");
+
+// Codes with nothing in common, one that's a prefix of another, and a repeat.
+static constexpr std::array<Code, 2> apartCodes = {{
+  { 0, 3, { 1, 2, 3 } },
+  { 1, 4, { 4, 5, 6, 7 } },
+}};
+static_assert(codeMatcherStates(apartCodes) == 1 + 3 + 4, "Distinct codes need their own states");
+
+static constexpr std::array<Code, 4> nestedCodes = {{
+  { 0, 4, { 1, 2, 3, 4 } },
+  { 1, 2, { 1, 2 } },
+  { 2, 3, { 1, 2, 5 } },
+  { 3, 4, { 1, 2, 3, 4 } },
+}};
+static_assert(codeMatcherStates(nestedCodes) == 1 + 4 + 1, "A code within another adds none");
+
+static constexpr auto sharedMatcher = makeCodeMatcher<NUM_KEYS,
+    codeMatcherStates(sharedCodes)>(sharedCodes);
+
+/** Press 'keys' in turn; return the id of the code matched by the last one, or NO_MATCH. */
+template<size_t N>
+static uint8_t enter(const uint8_t (&keys)[N]) {
+  uint8_t state = sharedMatcher.START_STATE;
+  for (uint8_t key : keys) {
+    state = sharedMatcher.step(state, key);
+  }
+  return sharedMatcher.match[state];
+}
+
+int main() {
+  for (const Code &code : sharedCodes) {
+    uint8_t state = sharedMatcher.START_STATE;
+    for (unsigned int k = 0; k < code.length; k++) {
+      CHECK_EQ(sharedMatcher.match[state], sharedMatcher.NO_MATCH);
+      state = sharedMatcher.step(state, code.keys[k]);
+    }
+    CHECK_EQ(sharedMatcher.match[state], code.id);
+  }
+
+  // After a false start, and after a code that overlaps the next one's beginning.
+  CHECK_EQ(enter({ 7, 1, 0, 4, 1, 0, 4, 8, 5, 1, 5, 6, 6, 8 }), 2);
+  CHECK_EQ(enter({ 1, 0, 4, 8, 5, 1, 5, 6, 1, 0, 4, 8, 5, 1, 5, 6, 6, 0 }), 1);
+  CHECK_EQ(enter({ 1, 0, 4, 8, 5, 1, 5, 6, 6, 7 }), sharedMatcher.NO_MATCH);
+  CHECK_EQ(enter({ 1, 0, 4, 8, 5, 1, 5, 6, 6, 3, 3 }), sharedMatcher.NO_MATCH);
+
+  return testResult("test_codeMatcher");
+}
@@ -0,0 +1,199 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// The keyframe timelines play every effect on every sentence as the per-frame effects did:
+// frame for frame, the same signs are lit as recorded in data/perFrameEffects.txt.
+//
+// Brightness is not compared; the fade curves and PWM resolution have changed since on
+// purpose. The LOVE/HATE fade used to pick one of the two words at random each frame, and
+// now sets their levels; for it, the fraction of frames each word is lit is compared instead,
+// over windows of the fade.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static const char *const GOLDEN_FILE = "data/perFrameEffects.txt";
+
+// Frames per window, comparing the lit fraction of the LOVE/HATE fade.
+static constexpr unsigned int FADE_WINDOW_FRAMES = 100;
+
+static I2CParallel bank0;
+static I2CParallel bank1;
+
+struct EffectName {
+  const char *name;
+  Effect effect;
+};
+
+static const EffectName effectNames[] = {
+  { "EF_APPEAR", Effect::EF_APPEAR },
+  { "EF_GLOW", Effect::EF_GLOW },
+  { "EF_BLINK", Effect::EF_BLINK },
+  { "EF_BLINK_FAST", Effect::EF_BLINK_FAST },
+  { "EF_ONE_AT_A_TIME", Effect::EF_ONE_AT_A_TIME },
+  { "EF_BUILD", Effect::EF_BUILD },
+  { "EF_BUILD_RANDOM", Effect::EF_BUILD_RANDOM },
+  { "EF_SNAKE", Effect::EF_SNAKE },
+  { "EF_SLIDE_TO_END", Effect::EF_SLIDE_TO_END },
+  { "EF_MELT", Effect::EF_MELT },
+  { "EF_ALL_BRIGHT", Effect::EF_ALL_BRIGHT },
+  { "EF_ALL_DARK", Effect::EF_ALL_DARK },
+  { "EF_FADE_LOVE_HATE", Effect::EF_FADE_LOVE_HATE },
+};
+
+static bool findEffect(const char *name, Effect &effect) {
+  for (const EffectName &effectName : effectNames) {
+    if (!strcmp(effectName.name, name)) {
+      effect = effectName.effect;
+      return true;
+    }
+  }
+  return false;
+}
+
+/** The fraction of a frame that a sign is lit: its level, if enabled. */
+static double litFraction(unsigned int signId) {
+  if (!(signBoard.getEnabled() & (1 << signId))) {
+    return 0;
+  }
+  return (double)signBoard.getLevel(signId) / SIGN_LEVEL_FULL;
+}
+
+/** Play the effect, one frame every LOOP_MICROS, and compare each frame with 'expected'. */
+static void checkEffect(unsigned int sentenceId, Effect effect, unsigned long seed,
+    const std::vector<uint32_t> &expected) {
+
+  bool isLoveHateFade = effect == Effect::EF_FADE_LOVE_HATE;
+  uint32_t exactBits = isLoveHateFade ? ALL_SIGNS_MASK & ~(S_LOVE | S_HATE) : ALL_SIGNS_MASK;
+  unsigned int numMismatches = 0;
+
+  // For the LOVE/HATE fade, over each window: frames LOVE was lit before, and its expected
+  // lit frames and their variance now.
+  unsigned int expectedLoveFrames = 0;
+  double loveFrames = 0;
+  double loveVariance = 0;
+
+  randomSeed(seed);
+  activeAnimation->setParameters(sentences[sentenceId], effect, 0, 0);
+  beginSignFrame();
+  activeAnimation->start();
+  commitSignFrame();
+
+  unsigned int frame = 0;
+  while (true) {
+    uint32_t signBits = signBoard.getEnabled();
+    if (frame < expected.size() && (signBits & exactBits) != (expected[frame] & exactBits)) {
+      if (numMismatches++ == 0) {
+        printf("sentence %u, effect %u, frame %u: signs %04x, expected %04x\n", sentenceId,
+            (unsigned int)effect, frame, signBits, expected[frame]);
+      }
+    }
+
+    if (isLoveHateFade && frame < expected.size()) {
+      // Before, at most one of the two words was lit in each frame; now their levels add up
+      // to the same.
+      unsigned int expectedWords = __builtin_popcount(expected[frame] & (S_LOVE | S_HATE));
+      CHECK(expectedWords <= 1);
+      expectedLoveFrames += (expected[frame] & S_LOVE) != 0;
+      double love = litFraction(IDX_LOVE);
+      double hate = litFraction(IDX_HATE);
+      CHECK(fabs(love + hate - expectedWords) < 0.01);
+      loveFrames += love;
+      loveVariance += love * (1.0 - love);
+      if ((frame + 1) % FADE_WINDOW_FRAMES == 0) {
+        CHECK(fabs(loveFrames - expectedLoveFrames) <= 5 * sqrt(loveVariance) + 1);
+        expectedLoveFrames = 0;
+        loveFrames = 0;
+        loveVariance = 0;
+      }
+    }
+
+    if (!activeAnimation->isRunning()) {
+      break;
+    }
+    advanceMicros(LOOP_MICROS);
+    beginSignFrame();
+    activeAnimation->next();
+    commitSignFrame();
+    frame++;
+  }
+
+  CHECK_EQ(numMismatches, 0);
+  CHECK_EQ(frame + 1, expected.size());
+}
+
+/**
+ * Parse a line of the golden file into its sentence, effect, seed and the signs expected in
+ * each frame. Returns false if it's not an effect line.
+ */
+static bool parseLine(char *line, unsigned int &sentenceId, Effect &effect,
+    unsigned long &seed, std::vector<uint32_t> &expected) {
+
+  char effectName[32];
+  int numChars = 0;
+  if (sscanf(line, "%u %31s %lu%n", &sentenceId, effectName, &seed, &numChars) != 3) {
+    return false;
+  }
+  CHECK(sentenceId < sentences.size());
+  CHECK(findEffect(effectName, effect));
+
+  expected.clear();
+  char *runs = line + numChars;
+  unsigned int signBits = 0;
+  unsigned int numFrames = 0;
+  while (sscanf(runs, " %xx%u%n", &signBits, &numFrames, &numChars) == 2) {
+    expected.insert(expected.end(), numFrames, signBits);
+    runs += numChars;
+  }
+  return true;
+}
+
+int main() {
+  bank0.init(0 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  bank1.init(1 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  setupFadeCurves();
+  setupSigns(bank0, bank1);
+  setupSentences();
+
+  FILE *golden = fopen(GOLDEN_FILE, "r");
+  if (golden == NULL) {
+    printf("Cannot open %s\n", GOLDEN_FILE);
+    return 1;
+  }
+
+  // Each effect that may be checked against the golden file, on every sentence.
+  bool isCovered[sizeof(effectNames) / sizeof(effectNames[0])][64] = {};
+  unsigned int numEffects = 0;
+  unsigned long numFrames = 0;
+  static char line[16384];
+  std::vector<uint32_t> expected;
+  while (fgets(line, sizeof(line), golden)) {
+    unsigned int sentenceId = 0;
+    Effect effect = Effect::EF_NO_EFFECT;
+    unsigned long seed = 0;
+    if (line[0] == '#' || !parseLine(line, sentenceId, effect, seed, expected)) {
+      continue;
+    }
+    checkEffect(sentenceId, effect, seed, expected);
+    for (unsigned int i = 0; i < sizeof(effectNames) / sizeof(effectNames[0]); i++) {
+      if (effectNames[i].effect == effect && sentenceId < 64) {
+        isCovered[i][sentenceId] = true;
+      }
+    }
+    numEffects++;
+    numFrames += expected.size();
+  }
+  fclose(golden);
+
+  for (unsigned int i = 0; i < sizeof(effectNames) / sizeof(effectNames[0]); i++) {
+    for (unsigned int sentenceId = 0; sentenceId < sentences.size(); sentenceId++) {
+      CHECK(isCovered[i][sentenceId]);
+    }
+  }
+
+  printf("%u effects on sentences, %lu frames compared\n", numEffects, numFrames);
+  return testResult("test_effectTimelines");
+}
@@ -0,0 +1,131 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// FlickerOverlay draws geometric run lengths instead of rolling the dice every flicker frame;
+// the result must still look like independent rolls. For a range of thresholds and with
+// frames sampled every 1..50 flicker frames (as when frames are late or skipped), check the
+// fraction of frames a flickering sign is on, the odds of staying on from one frame to the
+// next, and the mean length of an 'on' run, against the per-frame odds.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+#include <math.h>
+
+static constexpr unsigned int NUM_SAMPLES = 400000;
+
+// Allowed deviation of a measured fraction, in standard deviations.
+static constexpr double MAX_SIGMAS = 5.0;
+
+static bool isNear(double measured, double expected, double sigma) {
+  return fabs(measured - expected) <= MAX_SIGMAS * sigma + 1e-9;
+}
+
+static void checkOnFraction(unsigned int threshold, unsigned int frameStep) {
+  FlickerOverlay overlay("flicker");
+  overlay.setThreshold(IDX_LOVE, threshold);
+  overlay.setThreshold(IDX_HATE, FLICKER_RANGE_MAX - threshold); // The complement, alongside.
+
+  const uint32_t lit = S_LOVE | S_HATE | S_ART; // ART doesn't flicker.
+  double p = (double)(FLICKER_RANGE_MAX - threshold) / FLICKER_RANGE_MAX;
+  double q = 1.0 - p;
+
+  unsigned long numOn = 0;
+  unsigned long numComplementOn = 0;
+  unsigned long numOnAfterOn = 0;
+  unsigned long numAfterOn = 0;
+  unsigned long numOnRuns = 0;
+  bool wasOn = false;
+  for (uint32_t i = 0; i < NUM_SAMPLES; i++) {
+    Frame frame = {};
+    frame.signBits = lit;
+    overlay.apply(frame, i * frameStep * FLICKER_FRAME_MILLIS);
+
+    CHECK_EQ(frame.signBits & ~lit, 0); // Never lights a sign.
+    CHECK(frame.signBits & S_ART);
+
+    bool isOn = (frame.signBits & S_LOVE) != 0;
+    numOn += isOn;
+    numComplementOn += (frame.signBits & S_HATE) != 0;
+    if (i > 0 && wasOn) {
+      numAfterOn++;
+      numOnAfterOn += isOn;
+    }
+    numOnRuns += isOn && (i == 0 || !wasOn);
+    wasOn = isOn;
+  }
+
+  double onFraction = (double)numOn / NUM_SAMPLES;
+  double complementOnFraction = (double)numComplementOn / NUM_SAMPLES;
+  double sigma = sqrt(p * q / NUM_SAMPLES);
+  printf("threshold %4u, every %2u frames: on %.4f (expected %.4f)", threshold, frameStep,
+      onFraction, p);
+  CHECK(isNear(onFraction, p, sigma));
+  CHECK(isNear(complementOnFraction, q, sigma));
+
+  // Sampled frames are independent: staying on is as likely as being on at all.
+  if (numAfterOn > 1000) {
+    double stayOn = (double)numOnAfterOn / numAfterOn;
+    printf(", on after on %.4f", stayOn);
+    CHECK(isNear(stayOn, p, sqrt(p * q / numAfterOn)));
+  }
+
+  // 'On' runs (in samples) are geometric, with mean 1 / (1 - p).
+  if (numOnRuns > 1000 && q > 0) {
+    double meanRun = (double)numOn / numOnRuns;
+    double expectedRun = 1.0 / q;
+    double runSigma = sqrt(p) / q / sqrt((double)numOnRuns);
+    printf(", mean on run %.3f (expected %.3f)", meanRun, expectedRun);
+    CHECK(isNear(meanRun, expectedRun, runSigma));
+  }
+  printf("\n");
+}
+
+/** Between the change times the overlay reports, its output holds still. */
+static void checkNextChangeMillis(unsigned int threshold) {
+  FlickerOverlay overlay("flicker");
+  overlay.setThreshold(IDX_I, threshold);
+  overlay.setThreshold(IDX_ALL, threshold / 2 + 1);
+
+  uint32_t prevSignBits = 0;
+  uint32_t nextChangeMillis = 0;
+  unsigned int numChanges = 0;
+  for (uint32_t frameNum = 0; frameNum < 100000; frameNum++) {
+    uint32_t millis = frameNum * FLICKER_FRAME_MILLIS;
+    Frame frame = {};
+    frame.signBits = S_I | S_ALL;
+    overlay.apply(frame, millis);
+    if (millis < nextChangeMillis) {
+      CHECK_EQ(frame.signBits, prevSignBits);
+    }
+    numChanges += frame.signBits != prevSignBits;
+    prevSignBits = frame.signBits;
+    nextChangeMillis = overlay.getNextChangeMillis();
+    CHECK(nextChangeMillis > millis);
+  }
+  CHECK(numChanges > 1000);
+}
+
+static void checkFixedStates() {
+  FlickerOverlay overlay("flicker");
+  overlay.setThreshold(IDX_WHY, FLICKER_ALWAYS_ON);
+  overlay.setThreshold(IDX_DO, FLICKER_ALWAYS_OFF);
+  for (uint32_t frameNum = 0; frameNum < 1000; frameNum++) {
+    Frame frame = {};
+    frame.signBits = S_WHY | S_DO;
+    overlay.apply(frame, frameNum * FLICKER_FRAME_MILLIS);
+    CHECK_EQ(frame.signBits, S_WHY);
+  }
+  CHECK_EQ(overlay.getFlickering(), S_DO);
+}
+
+int main() {
+  for (unsigned int threshold : { 50u, 250u, 500u, 925u, 990u }) {
+    for (unsigned int frameStep : { 1u, 3u, 7u, 50u }) {
+      checkOnFraction(threshold, frameStep);
+    }
+    checkNextChangeMillis(threshold);
+  }
+  checkFixedStates();
+
+  return testResult("test_flickerOverlay");
+}
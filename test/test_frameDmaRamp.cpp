@@ -0,0 +1,162 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// DMA ramps in played frames: a frame's ramp has its first blocks computed as the frame is
+// queued, and the playback interrupt only starts the DMAC on them. Every value of the ramp
+// reaches the PWM in turn, whether the frame is shown by the timer, replaces a frame queued in
+// the same tick, or is shown right away after a flush; and preparing the ramps of frames still
+// in the ring leaves the blocks of the ramp that's playing alone.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static I2CParallel bank0;
+static I2CParallel bank1;
+
+// The TCC and channel of zone 0's PWM: where its DMA ramps write.
+static Tcc *pwmTcc = NULL;
+static unsigned int pwmChannel = 0;
+
+static bool isRampPlaying() {
+  return DMAC->Channel[PWM_DMA_CHANNEL].CHCTRLA.reg & DMAC_CHCTRLA_ENABLE;
+}
+
+static void findPwmTcc() {
+  const DmacDescriptor &desc = *((const DmacDescriptor *)DMAC->BASEADDR.reg + PWM_DMA_CHANNEL);
+  for (Tcc *tcc : { TCC0, TCC1, TCC2, TCC3, TCC4 }) {
+    for (unsigned int ch = 0; ch < sizeof(tcc->CCBUF) / sizeof(tcc->CCBUF[0]); ch++) {
+      if (desc.DSTADDR.reg == (uintptr_t)&tcc->CCBUF[ch].reg) {
+        pwmTcc = tcc;
+        pwmChannel = ch;
+      }
+    }
+  }
+}
+
+static DmaRamp makeRamp(uint16_t fromLevel, uint16_t toLevel, FadeCurve curve,
+    uint32_t rampPeriods, uint32_t firstPeriod) {
+  Fade fade;
+  fade.start(fromLevel, toLevel, 1000, curve);
+  return { fade, pwmTimer.getDutyCycleRange(), rampPeriods, firstPeriod };
+}
+
+// The compare value the ramp sets 'index' periods after it starts.
+static uint32_t rampCount(const DmaRamp &ramp, uint32_t index) {
+  uint64_t period = ramp.firstPeriod + index + 1;
+  uint32_t pos = (period << FADE_SHIFT) / ramp.rampPeriods;
+  uint32_t dutyCycle = ((uint64_t)ramp.maxDutyCycle * ramp.fade.levelAtPosition(pos))
+      >> KF_LEVEL_SHIFT;
+  return pwmTimer.dutyCycleToCount(dutyCycle);
+}
+
+static void commitRampFrame(const DmaRamp &ramp) {
+  beginSignFrame();
+  signBoard.enable(S_WHY);
+  setFrameDmaRamp(ramp);
+  commitSignFrame();
+}
+
+/** Show the frames queued so far, up to the one committed last. */
+static void playQueuedFrames() {
+  for (unsigned int i = 0; i <= FRAME_LEAD_TICKS; i++) {
+    advanceMicros(LOOP_MICROS);
+    showPlayedFrameSigns();
+  }
+}
+
+/**
+ * Play values 'from' to 'to' (exclusive) of a ramp that has played 'from' values so far; each
+ * must reach CC in turn. 'from' is 0 for a ramp just started.
+ */
+static void checkRampValues(const DmaRamp &ramp, uint32_t from, uint32_t to) {
+  if (from == 0) {
+    hostTccPeriodEnd(pwmTcc); // The first value, into CCBUF.
+  }
+  unsigned int numMismatches = 0;
+  for (uint32_t i = from; i < to; i++) {
+    hostTccPeriodEnd(pwmTcc);
+    if (pwmTcc->CC[pwmChannel].reg != rampCount(ramp, i) && numMismatches++ == 0) {
+      printf("value %u is %u, expected %u\n", (unsigned int)i,
+          (unsigned int)pwmTcc->CC[pwmChannel].reg, (unsigned int)rampCount(ramp, i));
+    }
+  }
+  CHECK_EQ(numMismatches, 0);
+}
+
+int main() {
+  bank0.init(0 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  bank1.init(1 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  for (PwmTimer *zoneTimer : pwmZoneTimers) {
+    zoneTimer->setupTcc();
+  }
+  setupFadeCurves();
+  setupSubFrameFlicker();
+  setupSigns(bank0, bank1);
+  setupFramePlayback();
+
+  constexpr uint32_t RAMP_LEN = 3 * PWM_DMA_BLOCK_LEN + 10;
+  const DmaRamp rise = makeRamp(0, KF_LEVEL_FULL, FADE_LINEAR, RAMP_LEN, 0);
+  const DmaRamp fall = makeRamp(KF_LEVEL_FULL, 0, FADE_GAMMA, RAMP_LEN + 100, 100);
+  const DmaRamp ease = makeRamp(KF_LEVEL_FULL / 4, KF_LEVEL_FULL, FADE_EASE_IN_OUT, RAMP_LEN, 0);
+  const DmaRamp shortRise = makeRamp(0, KF_LEVEL_FULL / 2, FADE_GAMMA, 100, 0);
+
+  // Queued: nothing starts until the frame is shown; then it plays through the prepared blocks
+  // and on into the ones refilled by the DMAC interrupt.
+  commitRampFrame(rise);
+  CHECK(!isRampPlaying());
+  playQueuedFrames();
+  CHECK(isRampPlaying());
+  findPwmTcc();
+  CHECK(pwmTcc != NULL);
+  checkRampValues(rise, 0, RAMP_LEN);
+  CHECK(!isRampPlaying());
+
+  // While one ramp plays from its prepared blocks, frames with other ramps are queued, one
+  // replacing another in the same tick. The playing ramp carries on unchanged until the frame
+  // that replaced the other is shown, and that one plays, not the one it replaced.
+  commitRampFrame(rise);
+  playQueuedFrames();
+  checkRampValues(rise, 0, 100);
+  commitRampFrame(fall);
+  commitRampFrame(ease);
+  checkRampValues(rise, 100, 2 * PWM_DMA_BLOCK_LEN + 50);
+  playQueuedFrames();
+  checkRampValues(ease, 0, RAMP_LEN);
+
+  // Again, with the frames that replace each other in the ring slot the playing ramp's frame
+  // had, after frames that leave the PWM alone have come round to it.
+  commitRampFrame(rise);
+  playQueuedFrames();
+  checkRampValues(rise, 0, 10);
+  for (unsigned int i = 0; i < FRAME_RING_LEN - 1; i++) {
+    beginSignFrame();
+    signBoard.setEnabled((i % 2) ? S_WHY : S_LIKE);
+    commitSignFrame();
+    advanceMicros(LOOP_MICROS);
+    showPlayedFrameSigns();
+  }
+  commitRampFrame(fall);
+  commitRampFrame(ease);
+  checkRampValues(rise, 10, 2 * PWM_DMA_BLOCK_LEN + 50);
+  playQueuedFrames();
+  checkRampValues(ease, 0, RAMP_LEN);
+
+  // A frame in the same tick that leaves the PWM alone keeps the ramp of the one it replaced.
+  commitRampFrame(fall);
+  beginSignFrame();
+  signBoard.enable(S_LIKE);
+  commitSignFrame();
+  playQueuedFrames();
+  checkRampValues(fall, 0, RAMP_LEN);
+
+  // Shown right away after a flush, from blocks prepared as it's committed.
+  commitRampFrame(rise);
+  playQueuedFrames();
+  checkRampValues(rise, 0, 50);
+  flushOutputFrames();
+  commitRampFrame(shortRise);
+  CHECK(isRampPlaying());
+  checkRampValues(shortRise, 0, 100);
+  CHECK(!isRampPlaying());
+
+  return testResult("test_frameDmaRamp");
+}
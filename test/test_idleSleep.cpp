@@ -0,0 +1,93 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// The main loop's idle sleep is woken by the events it has to handle, not by the clock: no
+// SysTick interrupts while it sleeps, no playback ticks while no frames are queued, and no
+// flicker interrupts while the flicker is disarmed. millis() still counts every millisecond.
+//
+// Runs the whole sketch, setup() and loop(), playing each effect, then waiting for nightfall,
+// and prints how often the CPU was woken, and by what.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+// The sketch's entry points, called by the Arduino core on the chip.
+void setup();
+void loop();
+
+// In MS_WAITING, the loop only wakes to poll the buttons (every 20ms) and the DARK sensor
+// (every 50ms).
+static constexpr unsigned long MAX_WAITING_WAKEUPS_PER_SEC =
+    1000000 / BUTTON_POLL_MICROS + 1000000 / DARK_SENSOR_POLL_MICROS + 5;
+
+static constexpr uint16_t DARK_READING = 1000;
+static constexpr uint16_t LIGHT_READING = 100;
+
+static void printWakeups(const char *name, unsigned long micros) {
+  const HostWakeups &wakeups = hostWakeups();
+  double secs = micros / 1e6;
+  printf("%-20s %6.1f s: %6.1f wakeups/s (SysTick %.1f, playback TC4 %.1f, flicker TC3 %.1f,"
+      " sleep TC5 %.1f)\n", name, secs, wakeups.total / secs, wakeups.sysTick / secs,
+      wakeups.tc[4] / secs, wakeups.tc[3] / secs, wakeups.tc[5] / secs);
+}
+
+/** Run loop() until the animation with effect 'e' (queued to come next) has played. */
+static void playEffect(Effect e) {
+  queueNextAnimation(mainMsgId(), e, 0);
+  activeAnimation->stop();
+
+  resetHostWakeups();
+  unsigned long startMicros = hostMicros();
+  bool isStarted = false;
+  while (true) {
+    loop();
+    bool isPlaying = activeAnimation->isRunning() && activeAnimation->getEffect() == e;
+    if (isStarted && !isPlaying) {
+      break;
+    }
+    isStarted |= isPlaying;
+  }
+
+  // Idle sleep is tickless, whatever the effect.
+  CHECK_EQ(hostWakeups().sysTick, 0);
+  CHECK_EQ(hostSysTicks(), hostMicros() / 1000);
+
+  printWakeups(Animation::EFFECTS[(unsigned int)e].name, hostMicros() - startMicros);
+}
+
+int main() {
+  setHostAnalog(DARK_SENSOR_ANALOG, DARK_READING);
+  setup();
+  CHECK(macroState == MacroState::MS_RUNNING);
+
+  for (unsigned int e = 0; e < (unsigned int)Effect::EF_NO_EFFECT; e++) {
+    playEffect((Effect)e);
+  }
+
+  // Daylight: the signs go dark, and the loop only polls the inputs.
+  setHostAnalog(DARK_SENSOR_ANALOG, LIGHT_READING);
+  while (macroState != MacroState::MS_WAITING) {
+    loop();
+  }
+  for (unsigned int i = 0; i < 10; i++) {
+    loop(); // Let the last frames play out.
+  }
+
+  resetHostWakeups();
+  unsigned long startMicros = hostMicros();
+  while (hostMicros() - startMicros < 60 * 1000000UL) {
+    loop();
+  }
+  unsigned long waitingMicros = hostMicros() - startMicros;
+  printWakeups("MS_WAITING", waitingMicros);
+
+  const HostWakeups &wakeups = hostWakeups();
+  CHECK(wakeups.total <= MAX_WAITING_WAKEUPS_PER_SEC * waitingMicros / 1000000);
+  CHECK_EQ(wakeups.sysTick, 0);
+  CHECK_EQ(wakeups.tc[3], 0);
+  CHECK_EQ(wakeups.tc[4], 0);
+  CHECK(!isHostTcRunning(TC3));
+  CHECK(!isHostTcRunning(TC4));
+  CHECK_EQ(hostSysTicks(), hostMicros() / 1000);
+
+  return testResult("test_idleSleep");
+}
@@ -0,0 +1,195 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// DMA ramps, against a model of the DMAC and the TCC: the ramp's two blocks chain to each other
+// and are refilled from the DMAC interrupt, so every value reaches the PWM in order, one per PWM
+// period, with no more than two blocks computed ahead; the end-of-ramp callback runs once, as
+// the last value is written; and setting up the DMAC leaves another user's setup alone. A ramp
+// whose first blocks were prepared ahead of time starts without computing any values.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+// A TCC the sketch doesn't use.
+static Tcc *const TEST_TCC = TCC1;
+static constexpr uint32_t CHANNEL = 2;
+static constexpr uint32_t PWM_FREQ = 6000;
+
+// Descriptor memory of "another library" that set up the DMAC before the first ramp.
+static DmacDescriptor otherDescriptors[PWM_DMA_CHANNEL + 2] __attribute__((aligned(16)));
+
+struct RampLog {
+  uint32_t periodEnds;   // PWM periods ended since the ramp started; each writes one value.
+  uint32_t filled;       // Values computed so far, by fills that were in order.
+  uint32_t maxAhead;     // Most values computed ahead of those written to the PWM.
+  unsigned int numFills;
+  unsigned int numEnds;
+  uint32_t writtenAtEnd; // Values written to the PWM when the ramp ended.
+  bool isOutOfOrder;
+};
+
+static RampLog rampLog;
+
+static void endPeriod() {
+  rampLog.periodEnds++;
+  hostTccPeriodEnd(TEST_TCC);
+}
+
+// The ramp's value at 'index': distinct, and in range.
+static uint32_t rampValue(uint32_t index) {
+  return (index * 7 + 3) % 100000;
+}
+
+static void fillRamp(uint32_t *counts, uint32_t index, uint16_t numCounts, void *context) {
+  CHECK(context == &rampLog);
+  CHECK(numCounts > 0 && numCounts <= PWM_DMA_BLOCK_LEN);
+  if (index != rampLog.filled) {
+    rampLog.isOutOfOrder = true;
+  }
+  for (uint32_t i = 0; i < numCounts; i++) {
+    counts[i] = rampValue(index + i);
+  }
+  rampLog.filled = index + numCounts;
+  rampLog.maxAhead = max(rampLog.maxAhead, rampLog.filled - rampLog.periodEnds);
+  rampLog.numFills++;
+}
+
+static void onRampEnd() {
+  rampLog.numEnds++;
+  rampLog.writtenAtEnd = rampLog.periodEnds;
+}
+
+static PwmRampStart rampStart;
+
+/**
+ * Play a ramp of 'length' values; each must reach CC in turn, for one PWM period. If
+ * 'isPrepared', its first blocks are computed by prepareDmaRamp() before it starts.
+ */
+static void checkRamp(uint32_t length, bool isIrqLate, bool isPrepared) {
+  PwmTimer pwm(0, 10, 0x5, TEST_TCC, CHANNEL, PWM_FREQ, highResolutionPwmClock(PWM_FREQ));
+  pwm.setupTcc();
+  rampLog = {};
+
+  if (isPrepared) {
+    CHECK_EQ(pwm.prepareDmaRamp(rampStart, length, fillRamp, &rampLog), ERR_SUCCESS);
+    CHECK_EQ(rampLog.numFills, length > PWM_DMA_BLOCK_LEN ? 2 : 1);
+    unsigned int numPreparedFills = rampLog.numFills;
+    CHECK_EQ(pwm.startDmaRamp(rampStart, fillRamp, &rampLog, onRampEnd), ERR_SUCCESS);
+    CHECK_EQ(rampLog.numFills, numPreparedFills);
+  } else {
+    CHECK_EQ(pwm.startDmaRamp(length, fillRamp, &rampLog, onRampEnd), ERR_SUCCESS);
+    CHECK_EQ(rampLog.numFills, length > PWM_DMA_BLOCK_LEN ? 2 : 1);
+  }
+  CHECK(pwm.isDmaRampActive());
+
+  // The first period end writes the first value to CCBUF, and each one after applies it.
+  endPeriod();
+  unsigned int numMismatches = 0;
+  for (uint32_t i = 0; i < length; i++) {
+    // Late interrupts: hold off the DMAC interrupt for a while, mid-block.
+    bool isHeldOff = isIrqLate && (i % PWM_DMA_BLOCK_LEN) == PWM_DMA_BLOCK_LEN / 4;
+    if (isHeldOff) {
+      noInterrupts();
+    }
+    endPeriod();
+    if (TEST_TCC->CC[CHANNEL].reg != rampValue(i) && numMismatches++ == 0) {
+      printf("ramp of %u: value %u is %u, expected %u\n", length, i,
+          (unsigned int)TEST_TCC->CC[CHANNEL].reg, rampValue(i));
+    }
+    if (isHeldOff) {
+      for (unsigned int j = 0; j < PWM_DMA_BLOCK_LEN / 2 && i + 1 < length; j++) {
+        endPeriod();
+        i++;
+        numMismatches += TEST_TCC->CC[CHANNEL].reg != rampValue(i);
+      }
+      interrupts();
+    }
+  }
+  CHECK_EQ(numMismatches, 0);
+  CHECK(!rampLog.isOutOfOrder);
+  CHECK_EQ(rampLog.filled, length);
+  CHECK_EQ(rampLog.numFills, (length + PWM_DMA_BLOCK_LEN - 1) / PWM_DMA_BLOCK_LEN);
+  CHECK(rampLog.maxAhead <= 2 * PWM_DMA_BLOCK_LEN);
+
+  // Ended, once, when the last value was written (or when the held-off interrupt ran); the
+  // channel disabled itself.
+  CHECK_EQ(rampLog.numEnds, 1);
+  if (isIrqLate) {
+    CHECK(rampLog.writtenAtEnd >= length);
+  } else {
+    CHECK_EQ(rampLog.writtenAtEnd, length);
+  }
+  CHECK(!pwm.isDmaRampActive());
+  CHECK_EQ(DMAC->Channel[PWM_DMA_CHANNEL].CHCTRLA.reg & DMAC_CHCTRLA_ENABLE, 0);
+
+  // The PWM holds the last value.
+  for (unsigned int i = 0; i < 10; i++) {
+    endPeriod();
+  }
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, rampValue(length - 1));
+  CHECK_EQ(rampLog.numEnds, 1);
+
+  // The prepared blocks were played in place, and refilled elsewhere.
+  if (isPrepared) {
+    for (uint32_t i = 0; i < rampStart.numCounts[0]; i++) {
+      CHECK_EQ(rampStart.counts[0][i], rampValue(i));
+    }
+  }
+}
+
+/** A ramp stopped partway doesn't end (or call back); the next ramp starts from its start. */
+static void checkStopAndRestart() {
+  PwmTimer pwm(0, 10, 0x5, TEST_TCC, CHANNEL, PWM_FREQ, highResolutionPwmClock(PWM_FREQ));
+  pwm.setupTcc();
+  rampLog = {};
+
+  pwm.startDmaRamp(5000, fillRamp, &rampLog, onRampEnd);
+  for (unsigned int i = 0; i < 300; i++) {
+    endPeriod();
+  }
+  pwm.stopDmaRamp();
+  CHECK(!pwm.isDmaRampActive());
+  for (unsigned int i = 0; i < 1000; i++) {
+    endPeriod();
+  }
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, rampValue(299)); // The last value written before the stop.
+  CHECK_EQ(rampLog.numEnds, 0);
+
+  // Restarted in the middle of a block: the new ramp still begins at its first value.
+  rampLog = {};
+  pwm.startDmaRamp(3, fillRamp, &rampLog, onRampEnd);
+  for (uint32_t i = 0; i < 4; i++) {
+    endPeriod();
+    if (i > 0) {
+      CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, rampValue(i - 1));
+    }
+  }
+  CHECK_EQ(rampLog.numEnds, 1);
+
+  // Setting the duty cycle stops a ramp.
+  pwm.startDmaRamp(5000, fillRamp, &rampLog, onRampEnd);
+  pwm.setDutyCycle(pwm.getDutyCycleRange() / 2);
+  CHECK(!pwm.isDmaRampActive());
+  CHECK_EQ(DMAC->Channel[PWM_DMA_CHANNEL].CHCTRLA.reg & DMAC_CHCTRLA_ENABLE, 0);
+}
+
+int main() {
+  // Another library has set up the DMAC already.
+  DMAC->BASEADDR.reg = (uintptr_t)otherDescriptors;
+  DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE;
+
+  for (uint32_t length : { 1u, 2u, 255u, 256u, 257u, 511u, 512u, 513u, 1000u, 6000u }) {
+    checkRamp(length, false, false);
+    checkRamp(length, false, true);
+  }
+  checkRamp(6000, true, false);
+  checkRamp(6000, true, true);
+  checkStopAndRestart();
+
+  // The DMAC was never reset, and its ramps used the existing descriptor memory.
+  CHECK_EQ(DMAC->CTRL.reg.hostResets, 0);
+  CHECK(DMAC->CTRL.reg & DMAC_CTRL_DMAENABLE);
+  CHECK_EQ(DMAC->BASEADDR.reg, (uintptr_t)otherDescriptors);
+  CHECK(otherDescriptors[PWM_DMA_CHANNEL].BTCTRL.reg & DMAC_BTCTRL_VALID);
+
+  return testResult("test_pwmDmaRamp");
+}
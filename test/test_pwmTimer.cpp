@@ -0,0 +1,119 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// PwmTimer's buffered duty cycle updates, against the TCC's compare buffers: a buffered
+// update writes CCBUFn and nothing else, is pending until the end of the PWM period, and only
+// then reaches CCn; the last update in a period wins; and pending updates are tracked per
+// channel.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+// A TCC the sketch doesn't use, and two of its channels.
+static Tcc *const TEST_TCC = TCC1;
+static constexpr uint32_t CHANNEL = 2;
+static constexpr uint32_t OTHER_CHANNEL = 3;
+static constexpr uint32_t PWM_FREQ = 6000;
+static constexpr PwmClockConfig CLOCK_CONFIG = highResolutionPwmClock(PWM_FREQ);
+
+static void checkBufferedUpdate() {
+  PwmTimer pwm(0, 10, 0x5, TEST_TCC, CHANNEL, PWM_FREQ, CLOCK_CONFIG);
+  CHECK_EQ(pwm.setupTcc(), ERR_SUCCESS);
+  uint32_t range = pwm.getDutyCycleRange();
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(range / 2));
+  CHECK(!pwm.isUpdatePending());
+
+  // The update waits in CCBUF for the period to end.
+  uint32_t dutyCycle = range / 3;
+  CHECK_EQ(pwm.setDutyCycleBuffered(dutyCycle), ERR_SUCCESS);
+  CHECK_EQ(pwm.getDutyCycle(), dutyCycle);
+  CHECK_EQ(TEST_TCC->CCBUF[CHANNEL].reg, pwm.dutyCycleToCount(dutyCycle));
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(range / 2));
+  CHECK(pwm.isUpdatePending());
+
+  hostTccPeriodEnd(TEST_TCC);
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(dutyCycle));
+  CHECK(!pwm.isUpdatePending());
+
+  // Of several updates within one period, the last is the one applied.
+  pwm.setDutyCycleBuffered(range / 4);
+  pwm.setDutyCycleBuffered(range / 5);
+  pwm.setDutyCycleBuffered(range - 1);
+  CHECK(pwm.isUpdatePending());
+  hostTccPeriodEnd(TEST_TCC);
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(range - 1));
+  CHECK(!pwm.isUpdatePending());
+
+  // The ends of the range: always off, and always on (past the end of the period).
+  pwm.setDutyCycleBuffered(0);
+  hostTccPeriodEnd(TEST_TCC);
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, 0);
+  pwm.setDutyCycleBuffered(range);
+  hostTccPeriodEnd(TEST_TCC);
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, ((TEST_TCC->PER.reg >> CLOCK_CONFIG.ditherBits) + 1)
+      << CLOCK_CONFIG.ditherBits);
+
+  // Out of range: rejected, and nothing is written.
+  CHECK_EQ(pwm.setDutyCycleBuffered(range + 1), ERR_DUTY_CYCLE_TOO_LONG);
+  CHECK(!pwm.isUpdatePending());
+  CHECK_EQ(pwm.getDutyCycle(), range);
+
+  // An unbuffered update takes effect at once.
+  CHECK_EQ(pwm.setDutyCycle(range / 2), ERR_SUCCESS);
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(range / 2));
+  CHECK(!pwm.isUpdatePending());
+}
+
+static void checkChannelsApart() {
+  PwmTimer pwm(0, 10, 0x5, TEST_TCC, CHANNEL, PWM_FREQ, CLOCK_CONFIG);
+  PwmTimer other(0, 11, 0x5, TEST_TCC, OTHER_CHANNEL, PWM_FREQ, CLOCK_CONFIG);
+  pwm.setupTcc();
+  other.setupTcc();
+  uint32_t range = pwm.getDutyCycleRange();
+
+  other.setDutyCycleBuffered(range / 7);
+  CHECK(other.isUpdatePending());
+  CHECK(!pwm.isUpdatePending());
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(range / 2));
+
+  pwm.setDutyCycleBuffered(range / 9);
+  hostTccPeriodEnd(TEST_TCC);
+  CHECK(!pwm.isUpdatePending());
+  CHECK(!other.isUpdatePending());
+  CHECK_EQ(TEST_TCC->CC[CHANNEL].reg, pwm.dutyCycleToCount(range / 9));
+  CHECK_EQ(TEST_TCC->CC[OTHER_CHANNEL].reg, other.dutyCycleToCount(range / 7));
+}
+
+static void checkStopsDmaRamp() {
+  PwmTimer pwm(0, 10, 0x5, TEST_TCC, CHANNEL, PWM_FREQ, CLOCK_CONFIG);
+  pwm.setupTcc();
+  uint32_t range = pwm.getDutyCycleRange();
+  auto fill = [](uint32_t *counts, uint32_t index, uint16_t numCounts, void *context) {
+    for (uint32_t i = 0; i < numCounts; i++) {
+      counts[i] = index + i;
+    }
+  };
+
+  CHECK_EQ(pwm.startDmaRamp(16, fill, NULL, NULL), ERR_SUCCESS);
+  CHECK(pwm.isDmaRampActive());
+  CHECK_EQ(pwm.getDutyCycle(), PWM_DUTY_CYCLE_RAMPED);
+  CHECK_EQ(pwm.setDutyCycleBuffered(range / 3), ERR_SUCCESS);
+  CHECK(!pwm.isDmaRampActive());
+  CHECK_EQ(DMAC->Channel[PWM_DMA_CHANNEL].CHCTRLA.reg & DMAC_CHCTRLA_ENABLE, 0);
+  CHECK_EQ(pwm.getDutyCycle(), range / 3);
+  CHECK_EQ(TEST_TCC->CCBUF[CHANNEL].reg, pwm.dutyCycleToCount(range / 3));
+}
+
+static void checkInvalidTimer() {
+  PwmTimer pwm(0, 0, 0, NULL, 0, PWM_FREQ, DEFAULT_PWM_PRESCALER);
+  CHECK_EQ(pwm.setDutyCycleBuffered(1), ERR_INVALID_PWM);
+  CHECK(!pwm.isUpdatePending());
+}
+
+int main() {
+  checkBufferedUpdate();
+  checkChannelsApart();
+  checkStopsDmaRamp();
+  checkInvalidTimer();
+
+  return testResult("test_pwmTimer");
+}
@@ -0,0 +1,261 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Sign frames reach the I2C sign banks with at most one write per bank per frame, and none
+// for a bank whose byte didn't change. (More only when a frame switches on enough signs at
+// once that the turn-on is staggered; see TURN_ON_STAGGER_SLOTS.) Dimmed signs don't strobe,
+// and writes outside a frame show them as the modulator does. After a flush, the frame shown
+// right away stays shown.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static I2CParallel bank0;
+static I2CParallel bank1;
+
+static uint8_t shownBank[NUM_SIGN_BANKS];
+static unsigned int shownWrites[NUM_SIGN_BANKS];
+static unsigned long numFrames = 0;
+static unsigned long numStaggeredFrames = 0;
+
+static I2CParallel *const banks[NUM_SIGN_BANKS] = { &bank0, &bank1 };
+
+static void markShown() {
+  for (unsigned int i = 0; i < NUM_SIGN_BANKS; i++) {
+    shownBank[i] = banks[i]->hostOutput;
+    shownWrites[i] = banks[i]->hostWrites;
+  }
+}
+
+/** Check the bank writes since markShown(), for what should be at most one frame. */
+static void checkFrameWrites() {
+  uint32_t prevBankBits = shownBank[0] | (shownBank[1] << 8);
+  uint32_t bankBits = bank0.hostOutput | (bank1.hostOutput << 8);
+  bool isStaggered = turnOnMilliamps(bankBits & ~prevBankBits) > MAX_TURN_ON_SLOT_MA;
+  numFrames++;
+  numStaggeredFrames += isStaggered;
+
+  for (unsigned int i = 0; i < NUM_SIGN_BANKS; i++) {
+    unsigned int writes = banks[i]->hostWrites - shownWrites[i];
+    if (banks[i]->hostOutput == shownBank[i]) {
+      CHECK_EQ(writes, 0);
+    } else if (isStaggered) {
+      CHECK(writes <= TURN_ON_STAGGER_SLOTS);
+    } else {
+      CHECK_EQ(writes, 1);
+    }
+  }
+  markShown();
+}
+
+/** Run an animation to its end, one loop frame at a time. */
+static void runAnimation(unsigned int sentenceId, Effect effect, bool isPlaybackRunning) {
+  activeAnimation->setParameters(sentences[sentenceId], effect,
+      newAnimationFlags(effect, sentences[sentenceId]), 0);
+
+  beginSignFrame();
+  activeAnimation->start();
+  commitSignFrame();
+  checkFrameWrites();
+
+  while (activeAnimation->isRunning()) {
+    advanceMicros(LOOP_MICROS);
+    if (isPlaybackRunning) {
+      // The frame the timer just showed; then the one committed below is only queued.
+      showPlayedFrameSigns();
+      checkFrameWrites();
+    }
+
+    beginSignFrame();
+    activeAnimation->next();
+    commitSignFrame();
+    if (!isPlaybackRunning) {
+      checkFrameWrites(); // Shown as it's committed.
+    }
+  }
+}
+
+static void testDirectWrites() {
+  // Outside of a frame, each change is written through: one write to the bank it changes.
+  markShown();
+  signBoard.enable(S_WHY);
+  checkFrameWrites();
+  signBoard.enable(S_WHY);
+  checkFrameWrites(); // No change; no write.
+  signBoard.setEnabled(S_WHY | S_LIKE);
+  checkFrameWrites();
+  allSignsOff();
+  checkFrameWrites();
+
+  // Within a frame, nothing is written until the commit, which writes each bank once.
+  beginSignFrame();
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    signs[i].enable();
+    signs[(i + 5) % NUM_SIGNS].disable();
+  }
+  CHECK_EQ(bank0.hostWrites, shownWrites[0]);
+  CHECK_EQ(bank1.hostWrites, shownWrites[1]);
+  commitSignFrame();
+  checkFrameWrites();
+}
+
+// The bank bit that lights each sign.
+static uint32_t signBankBit[NUM_SIGNS];
+
+static void findSignBankBits() {
+  signBoard.resetLevels();
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    signBoard.setEnabled(1 << i);
+    signBankBit[i] = bank0.hostOutput | (bank1.hostOutput << 8);
+  }
+  allSignsOff();
+  markShown();
+}
+
+/** Is the sign with the bit 'signBit' lit on the banks? */
+static bool isShown(uint32_t signBit) {
+  uint32_t bankBit = signBankBit[__builtin_ctz(signBit)];
+  return ((bank0.hostOutput | (bank1.hostOutput << 8)) & bankBit) != 0;
+}
+
+static void setLevel(uint32_t signs, uint8_t level) {
+  uint8_t levels[NUM_SIGNS];
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    levels[i] = level;
+  }
+  signBoard.setLevels(levels, signs);
+}
+
+/**
+ * Play 'numFrames' frames of S_WHY dimmed to 'level'; return how many it was on in, and the
+ * longest run of frames it was off for.
+ */
+static unsigned int playDimmed(uint8_t level, unsigned int numFrames, unsigned int &maxOffRun) {
+  allSignsOff();
+  signBoard.resetLevels();
+  setLevel(S_WHY, level);
+  unsigned int onFrames = 0;
+  unsigned int offRun = 0;
+  maxOffRun = 0;
+  for (unsigned int frame = 0; frame < numFrames; frame++) {
+    beginSignFrame();
+    signBoard.enable(S_WHY);
+    commitSignFrame();
+    if (isShown(S_WHY)) {
+      onFrames++;
+      offRun = 0;
+    } else {
+      maxOffRun = max(maxOffRun, ++offRun);
+    }
+  }
+  markShown();
+  return onFrames;
+}
+
+static void testDimmedSigns() {
+  findSignBankBits();
+
+  // Levels from SIGN_LEVEL_MIN_DIMMED up are lit in that fraction of frames, and never off for
+  // two frames running, so they don't strobe.
+  constexpr unsigned int NUM_FRAMES = 10 * SIGN_LEVEL_FULL;
+  unsigned int maxOffRun;
+  for (unsigned int level = SIGN_LEVEL_MIN_DIMMED; level < SIGN_LEVEL_FULL; level++) {
+    unsigned int onFrames = playDimmed(level, NUM_FRAMES, maxOffRun);
+    CHECK(abs((int)onFrames - (int)(level * NUM_FRAMES / SIGN_LEVEL_FULL)) <= 1);
+    CHECK(maxOffRun <= 1);
+  }
+
+  // Lower levels are shown at the nearer of 0 and SIGN_LEVEL_MIN_DIMMED.
+  unsigned int minDimmedFrames = playDimmed(SIGN_LEVEL_MIN_DIMMED, NUM_FRAMES, maxOffRun);
+  for (unsigned int level = 1; level < SIGN_LEVEL_MIN_DIMMED; level++) {
+    unsigned int onFrames = playDimmed(level, NUM_FRAMES, maxOffRun);
+    CHECK_EQ(onFrames, level < SIGN_LEVEL_MIN_DIMMED / 2 ? 0 : minDimmedFrames);
+  }
+
+  // A change written outside a frame leaves the dimmed signs as the last frame had them...
+  playDimmed(SIGN_LEVEL_MIN_DIMMED, 1, maxOffRun);
+  bool isWhyOn = isShown(S_WHY);
+  signBoard.enable(S_LIKE);
+  CHECK_EQ(isShown(S_WHY), isWhyOn);
+  CHECK(isShown(S_LIKE));
+  signBoard.disable(S_LIKE);
+  CHECK_EQ(isShown(S_WHY), isWhyOn);
+
+  // ... and shows a newly lit dimmed sign as its first frame would.
+  setLevel(S_YOU | S_DO, 200);
+  setLevel(S_LIKE, SIGN_LEVEL_MIN_DIMMED / 2 - 1);
+  signBoard.setEnabled(S_WHY | S_DO | S_YOU | S_LIKE);
+  CHECK_EQ(isShown(S_WHY), isWhyOn);
+  CHECK(isShown(S_DO));
+  CHECK(!isShown(S_LIKE));
+  beginSignFrame();
+  commitSignFrame();
+  CHECK(isShown(S_DO));
+  CHECK(!isShown(S_LIKE));
+
+  allSignsOff();
+  signBoard.resetLevels();
+  markShown();
+}
+
+/**
+ * A frame shown right away after a flush isn't overwritten by an older one that the playback
+ * timer showed before the flush, but that the loop hadn't written to the banks yet.
+ */
+static void testFlushedFrames() {
+  beginSignFrame();
+  signBoard.setEnabled(S_WHY);
+  commitSignFrame();
+  for (unsigned int i = 0; i <= FRAME_LEAD_TICKS; i++) {
+    advanceMicros(LOOP_MICROS); // Played, but not written yet.
+  }
+
+  flushOutputFrames();
+  beginSignFrame();
+  signBoard.setEnabled(S_LIKE);
+  commitSignFrame();
+  CHECK(isShown(S_LIKE));
+  showPlayedFrameSigns();
+  CHECK(isShown(S_LIKE));
+  CHECK(!isShown(S_WHY));
+
+  for (unsigned int i = 0; i <= FRAME_LEAD_TICKS; i++) {
+    advanceMicros(LOOP_MICROS);
+    showPlayedFrameSigns();
+  }
+  CHECK(isShown(S_LIKE));
+  CHECK(!isShown(S_WHY));
+  allSignsOff();
+  markShown();
+}
+
+int main() {
+  bank0.init(0 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  bank1.init(1 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  setupFadeCurves();
+  setupEffectProgram();
+  setupSigns(bank0, bank1);
+  setupSentences();
+
+  testDirectWrites();
+  testDimmedSigns();
+
+  // Every effect on every sentence: first with each frame shown as it's committed, then from
+  // the playback timer.
+  for (bool isPlaybackRunning : { false, true }) {
+    if (isPlaybackRunning) {
+      setupFramePlayback();
+    }
+    for (unsigned int sentenceId = 0; sentenceId < sentences.size(); sentenceId++) {
+      for (unsigned int e = 0; e < (unsigned int)Effect::EF_NO_EFFECT; e++) {
+        runAnimation(sentenceId, (Effect)e, isPlaybackRunning);
+      }
+    }
+  }
+
+  testFlushedFrames();
+
+  printf("%lu frames, %lu with staggered turn-ons, %lu I2C transactions\n",
+      numFrames, numStaggeredFrames, hostI2CTransactions());
+  CHECK(numFrames > 10000);
+  return testResult("test_signFrames");
+}
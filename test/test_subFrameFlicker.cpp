@@ -0,0 +1,121 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// The sub-frame flicker interrupt plays the plan each frame was committed with, even after the
+// plan it was set from has been replanned or overwritten: frames, and the interrupt, hold
+// their own copies. A frame armed with the same dropouts as the interrupt already has changes
+// nothing, so it isn't queued.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static I2CParallel bank0;
+static I2CParallel bank1;
+
+// The pin config of zone 0's PWM output: the pin that setupTcc() connected to its TCC.
+static HostReg *pwmPinConfig = NULL;
+
+static void findPwmPin() {
+  for (auto &group : PORT->Group) {
+    for (auto &pinConfig : group.PINCFG) {
+      if (pinConfig.bit.PMUXEN && pwmPinConfig == NULL) {
+        pwmPinConfig = &pinConfig;
+      }
+    }
+  }
+}
+
+static bool isPwmForcedOff() {
+  return !pwmPinConfig->bit.PMUXEN;
+}
+
+static bool isDropout(const SubFrameFlickerPlan &plan, unsigned int tick) {
+  tick %= SUBFRAME_FLICKER_PLAN_TICKS;
+  return plan.dropouts[tick / 32] & (1 << (tick % 32));
+}
+
+/** Play the frames queued so far, up to the one committed last. */
+static void playQueuedFrames() {
+  for (unsigned int i = 0; i <= FRAME_LEAD_TICKS; i++) {
+    advanceMicros(LOOP_MICROS);
+    showPlayedFrameSigns();
+  }
+}
+
+/** Over a whole plan's worth of ticks, the PWM output drops out as 'plan' says, from some tick. */
+static void checkPlayingPlan(const SubFrameFlickerPlan &plan) {
+  bool isOff[SUBFRAME_FLICKER_PLAN_TICKS];
+  for (unsigned int tick = 0; tick < SUBFRAME_FLICKER_PLAN_TICKS; tick++) {
+    advanceMicros(1000000 / SUBFRAME_FLICKER_HZ);
+    isOff[tick] = isPwmForcedOff();
+  }
+
+  bool isMatched = false;
+  for (unsigned int start = 0; start < SUBFRAME_FLICKER_PLAN_TICKS && !isMatched; start++) {
+    isMatched = true;
+    for (unsigned int tick = 0; tick < SUBFRAME_FLICKER_PLAN_TICKS && isMatched; tick++) {
+      isMatched = isOff[tick] == isDropout(plan, start + tick);
+    }
+  }
+  CHECK(isMatched);
+}
+
+int main() {
+  bank0.init(0 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  bank1.init(1 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  for (PwmTimer *zoneTimer : pwmZoneTimers) {
+    zoneTimer->setupTcc();
+  }
+  findPwmPin();
+  CHECK(pwmPinConfig != NULL);
+  setupSubFrameFlicker();
+  setupSigns(bank0, bank1);
+  setupFramePlayback();
+  randomSeed(1);
+
+  // Arm a frame from a plan, then replan it before the frame is shown, as an animation would.
+  SubFrameFlickerPlan plan;
+  makeSubFrameFlickerPlan(plan, FLICKER_RANGE_MAX / 2);
+  const SubFrameFlickerPlan committedPlan = plan;
+  beginSignFrame();
+  signBoard.enable(S_WHY);
+  setFrameSubFrameFlicker(plan);
+  commitSignFrame();
+  memset(plan.dropouts, 0xFF, sizeof(plan.dropouts));
+
+  playQueuedFrames();
+  CHECK(isHostTcRunning(TC3));
+  CHECK(isSubFrameFlickerArmedWith(&committedPlan));
+  checkPlayingPlan(committedPlan);
+
+  // Replanned while it's playing: the interrupt carries on with its own copy.
+  makeSubFrameFlickerPlan(plan, FLICKER_RANGE_MAX);
+  checkPlayingPlan(committedPlan);
+
+  // A frame with the same dropouts, from another plan, changes nothing and isn't queued.
+  plan = committedPlan;
+  beginSignFrame();
+  signBoard.enable(S_WHY);
+  setFrameSubFrameFlicker(plan);
+  commitSignFrame();
+  CHECK(!isHostTcRunning(TC4));
+
+  // A frame with other dropouts is.
+  makeSubFrameFlickerPlan(plan, FLICKER_RANGE_MAX);
+  const SubFrameFlickerPlan nextPlan = plan;
+  beginSignFrame();
+  setFrameSubFrameFlicker(plan);
+  commitSignFrame();
+  CHECK(isHostTcRunning(TC4));
+  playQueuedFrames();
+  checkPlayingPlan(nextPlan);
+
+  // Frames are disarmed unless told otherwise.
+  beginSignFrame();
+  commitSignFrame();
+  playQueuedFrames();
+  CHECK(!isHostTcRunning(TC3));
+  CHECK(isSubFrameFlickerArmedWith(NULL));
+  CHECK(!isPwmForcedOff());
+
+  return testResult("test_subFrameFlicker");
+}
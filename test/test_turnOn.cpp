@@ -0,0 +1,141 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Staggered sign turn-on: turnOnMilliamps() estimates each sign's surge from its letters, and
+// turnOnStage() switches on, in each slot, as many signs as fit under MAX_TURN_ON_SLOT_MA (but
+// at least one), leaving everything else as it should end up. SignBoard::showBankBits() gets
+// any set of signs on within TURN_ON_STAGGER_SLOTS slots.
+
+#include "hostFakes.h"
+#include "testing.h"
+
+static I2CParallel bank0;
+static I2CParallel bank1;
+
+// Letters of neon in each sign, by sign id.
+static constexpr unsigned int SIGN_LETTERS[NUM_SIGNS] = {
+  3, 2, 3, 1, 4, 4, 2, 4, // WHY DO YOU I DON'T HAVE TO LOVE
+  4, 4, 3, 3, 3, 3, 1, 1, // LIKE HATE )'( ALL THE ART ! ?
+};
+static constexpr unsigned int MA_PER_LETTER = 50;
+
+// Every bank bit, and the one that lights each sign.
+static constexpr uint32_t BANK_BITS_MASK = (1 << (8 * NUM_SIGN_BANKS)) - 1;
+static uint32_t signBankBit[NUM_SIGNS];
+static uint32_t allBankBits = 0;
+
+static uint32_t shownBankBits() {
+  return bank0.hostOutput | (bank1.hostOutput << 8);
+}
+
+static void findSignBankBits() {
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    signBoard.setEnabled(1 << i);
+    signBankBit[i] = shownBankBits();
+    CHECK_EQ(__builtin_popcount(signBankBit[i]), 1);
+    allBankBits |= signBankBit[i];
+  }
+  allSignsOff();
+}
+
+static void checkMilliamps() {
+  CHECK_EQ(turnOnMilliamps(0), 0);
+  CHECK_EQ(turnOnMilliamps(BANK_BITS_MASK & ~allBankBits), 0); // Pins with no sign.
+
+  unsigned int totalMilliamps = 0;
+  for (unsigned int i = 0; i < NUM_SIGNS; i++) {
+    CHECK_EQ(turnOnMilliamps(signBankBit[i]), SIGN_LETTERS[i] * MA_PER_LETTER);
+    totalMilliamps += SIGN_LETTERS[i] * MA_PER_LETTER;
+  }
+  CHECK_EQ(turnOnMilliamps(allBankBits), totalMilliamps);
+  CHECK_EQ(turnOnMilliamps(BANK_BITS_MASK), totalMilliamps);
+}
+
+/** Check one stage on the way from 'shown' to 'target'; return it. */
+static uint32_t checkStage(uint32_t shown, uint32_t target) {
+  uint32_t stage = turnOnStage(shown, target);
+  uint32_t turningOn = target & ~shown;
+  uint32_t turnedOn = stage & ~shown;
+
+  // Signs turning off, and those staying as they are, go straight to the target; only signs
+  // turning on may wait.
+  CHECK_EQ(stage & ~turningOn, target & ~turningOn);
+  CHECK_EQ(turnedOn & ~turningOn, 0);
+
+  if (turningOn != 0) {
+    // At least one sign, and as many more as fit under the limit.
+    CHECK(turnedOn != 0);
+    unsigned int milliamps = turnOnMilliamps(turnedOn);
+    CHECK(milliamps <= MAX_TURN_ON_SLOT_MA || __builtin_popcount(turnedOn) == 1);
+    for (uint32_t waiting = turningOn & ~turnedOn; waiting != 0; waiting &= waiting - 1) {
+      uint32_t bit = waiting & -waiting;
+      CHECK(milliamps + turnOnMilliamps(bit) > MAX_TURN_ON_SLOT_MA);
+    }
+  }
+  return stage;
+}
+
+static void checkStages() {
+  CHECK_EQ(turnOnStage(allBankBits, allBankBits), allBankBits);
+  CHECK_EQ(turnOnStage(allBankBits, 0), 0);
+  CHECK_EQ(turnOnStage(0, 0), 0);
+
+  randomSeed(1);
+  for (unsigned int i = 0; i < 100000; i++) {
+    uint32_t shown = random(1 << NUM_SIGNS);
+    uint32_t target = random(1 << NUM_SIGNS);
+    uint32_t shownBits = 0;
+    uint32_t targetBits = 0;
+    for (unsigned int signId = 0; signId < NUM_SIGNS; signId++) {
+      shownBits |= (shown & (1 << signId)) ? signBankBit[signId] : 0;
+      targetBits |= (target & (1 << signId)) ? signBankBit[signId] : 0;
+    }
+
+    // Each stage makes progress, so the target is reached in as many stages as there are signs
+    // turning on, at most. (Or one, if signs only turn off.)
+    uint32_t stage = shownBits;
+    unsigned int numStages = 0;
+    while (stage != targetBits && numStages <= NUM_SIGNS) {
+      stage = checkStage(stage, targetBits);
+      numStages++;
+    }
+    CHECK_EQ(stage, targetBits);
+    CHECK(numStages <= max(1U, (unsigned int)__builtin_popcount(targetBits & ~shownBits)));
+  }
+}
+
+/** Switching on every sign at once: staggered over the slots, and done within them. */
+static void checkShowStaggered() {
+  allSignsOff();
+  unsigned int startWrites = bank0.hostWrites + bank1.hostWrites;
+  unsigned long startMicros = hostMicros();
+  signBoard.showBankBits(allBankBits);
+  CHECK_EQ(shownBankBits(), allBankBits);
+
+  unsigned int numWrites = bank0.hostWrites + bank1.hostWrites - startWrites;
+  unsigned long micros = hostMicros() - startMicros;
+  CHECK(numWrites > NUM_SIGN_BANKS);
+  CHECK(numWrites <= NUM_SIGN_BANKS * TURN_ON_STAGGER_SLOTS);
+  CHECK(micros >= TURN_ON_SLOT_MICROS);
+  CHECK(micros <= (TURN_ON_STAGGER_SLOTS - 1) * TURN_ON_SLOT_MICROS);
+
+  // Signs turning off, or a set that fits in one slot, go in one write per bank, at once.
+  startWrites = bank0.hostWrites + bank1.hostWrites;
+  startMicros = hostMicros();
+  signBoard.showBankBits(0);
+  signBoard.showBankBits(signBankBit[0] | signBankBit[NUM_SIGNS - 1]);
+  CHECK_EQ(bank0.hostWrites + bank1.hostWrites - startWrites, 2 * NUM_SIGN_BANKS);
+  CHECK_EQ(hostMicros(), startMicros);
+}
+
+int main() {
+  bank0.init(0 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  bank1.init(1 + I2C_PCF8574_MIN_ADDR, I2C_SPEED_STANDARD);
+  setupSigns(bank0, bank1);
+
+  findSignBankBits();
+  checkMilliamps();
+  checkStages();
+  checkShowStaggered();
+
+  return testResult("test_turnOn");
+}
@@ -0,0 +1,39 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Checks for the host tests. A failed check prints where and why, and the test carries on; its
+// main() returns testResult(), which is nonzero if anything failed.
+
+#ifndef _TESTING_H
+#define _TESTING_H
+
+#include <stdio.h>
+
+inline unsigned int testFailures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      testFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long long _actual = (long long)(actual); \
+    long long _expected = (long long)(expected); \
+    if (_actual != _expected) { \
+      printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, \
+          #actual, #expected, _actual, _expected); \
+      testFailures++; \
+    } \
+  } while (0)
+
+inline int testResult(const char *testName) {
+  if (testFailures == 0) {
+    printf("%s: OK\n", testName);
+    return 0;
+  }
+  printf("%s: %u check(s) failed\n", testName, testFailures);
+  return 1;
+}
+
+#endif // _TESTING_H
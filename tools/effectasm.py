@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+# (c) Copyright 2022 Aaron Kimball
+#
+# Assembler for effect programs; see effectProgram.h for the instruction set.
+#
+# Usage: effectasm.py program.txt [--c NAME]
+#
+# Prints the "program <hex>" line that installs the program when sent to the sign's USB serial
+# port in admin mode; or with --c, a C array definition to build into the firmware.
+#
+# Source is one instruction per line; '#' starts a comment:
+#
+#   show WHY DO YOU     # Light these signs (by word, or as a number: 0x7).
+#   hide ALL            # Turn off these signs. (ALL is the word 'ALL'; use 0xFFFF for every sign.)
+#   show words          # Light / turn off the words of the sentence.
+#   hide words
+#   pick                # Pick a random word of the sentence...
+#   show pick           # ... and light it / turn it off.
+#   hide pick
+#   level 50%           # Set brightness, as a percentage or 0..1024.
+#   wait 250            # Show the current state for 250 ms.
+#   ramp 100% 1000      # Show the current state while ramping brightness to 100% over 1000 ms.
+#   loop 3              # Repeat the block up to 'next' three times.
+#   next
+#   end                 # Added automatically if missing.
+#
+# The sign verifies every program before installing it, and reports the error code if it's
+# rejected (e.g. VERIFY_OVER_BUDGET if too many instructions would run in a single frame).
+
+import argparse
+import sys
+
+OPCODES = {
+    'end': 0x00,
+    'show': 0x01,
+    'hide': 0x02,
+    'show words': 0x03,
+    'hide words': 0x04,
+    'pick': 0x05,
+    'show pick': 0x06,
+    'hide pick': 0x07,
+    'level': 0x08,
+    'wait': 0x09,
+    'ramp': 0x0A,
+    'loop': 0x0B,
+    'next': 0x0C,
+}
+
+# Sign ids, in the order of the `signs` array in sign.cpp.
+WORDS = ['WHY', 'DO', 'YOU', 'I', 'DONT', 'HAVE', 'TO', 'LOVE', 'LIKE', 'HATE', 'BM', 'ALL',
+         'THE', 'ART', 'BANG', 'QUESTION']
+
+LEVEL_FULL = 1024
+MAX_PROGRAM_SIZE = 256
+
+
+class AsmError(Exception):
+    pass
+
+
+def u16(value):
+    if value < 0 or value > 0xFFFF:
+        raise AsmError(f'Value out of range: {value}')
+    return [value & 0xFF, value >> 8]
+
+
+def parse_int(token):
+    try:
+        return int(token, 0)
+    except ValueError:
+        raise AsmError(f'Expected a number: {token}')
+
+
+def parse_mask(tokens):
+    mask = 0
+    for token in tokens:
+        if token.upper() in WORDS:
+            mask |= 1 << WORDS.index(token.upper())
+        else:
+            mask |= parse_int(token)
+    return mask
+
+
+def parse_level(token):
+    if token.endswith('%'):
+        return round(parse_int(token[:-1]) * LEVEL_FULL / 100)
+    return parse_int(token)
+
+
+def assemble_line(tokens):
+    op = tokens[0].lower()
+    args = tokens[1:]
+    if op in ('show', 'hide') and len(args) == 1 and args[0].lower() in ('words', 'pick'):
+        return [OPCODES[f'{op} {args[0].lower()}']]
+    elif op in ('show', 'hide'):
+        return [OPCODES[op]] + u16(parse_mask(args))
+    elif op not in OPCODES:
+        raise AsmError(f'Unknown instruction: {op}')
+
+    expected_args = {'level': 1, 'wait': 1, 'ramp': 2, 'loop': 1}.get(op, 0)
+    if len(args) != expected_args:
+        raise AsmError(f'{op} takes {expected_args} argument(s)')
+
+    if op == 'level':
+        return [OPCODES[op]] + u16(parse_level(args[0]))
+    elif op == 'wait':
+        return [OPCODES[op]] + u16(parse_int(args[0]))
+    elif op == 'ramp':
+        return [OPCODES[op]] + u16(parse_level(args[0])) + u16(parse_int(args[1]))
+    elif op == 'loop':
+        count = parse_int(args[0])
+        if count < 1 or count > 255:
+            raise AsmError(f'Loop count out of range: {count}')
+        return [OPCODES[op], count]
+    return [OPCODES[op]]
+
+
+def assemble(lines):
+    code = []
+    last_op = None
+    for line_num, line in enumerate(lines, 1):
+        tokens = line.split('#', 1)[0].split()
+        if not tokens:
+            continue
+        try:
+            code += assemble_line(tokens)
+        except AsmError as e:
+            raise AsmError(f'line {line_num}: {e}')
+        last_op = tokens[0].lower()
+
+    if last_op != 'end':
+        code.append(OPCODES['end'])
+    if len(code) > MAX_PROGRAM_SIZE:
+        raise AsmError(f'Program is {len(code)} bytes; the limit is {MAX_PROGRAM_SIZE}')
+    return code
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Assemble an effect program.')
+    parser.add_argument('source')
+    parser.add_argument('--c', metavar='NAME', help='Print a C array with this name')
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        try:
+            code = assemble(f.readlines())
+        except AsmError as e:
+            print(f'{args.source}: {e}', file=sys.stderr)
+            return 1
+
+    if args.c:
+        body = ', '.join(f'0x{b:02X}' for b in code)
+        print(f'static const uint8_t {args.c}[] = {{ {body} }};')
+    else:
+        print('program ' + ''.join(f'{b:02x}' for b in code))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())